@@ -0,0 +1,69 @@
+// a numeric script loop, with operands the quickened instructions specialize to (int/int, real/real)
+// and with mixed int/real operands that keep them on the generic path every operation took before
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/arithmetic.cpp src/*.cpp -o arithmetic
+#include "CryptScript.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+constexpr crypt::int_type Iterations = 2000000;
+constexpr int Rounds = 5;
+
+static const char Source[] =
+	"i = 0\n"
+	"while i < n do\n"
+	"	acc += step\n"
+	"	acc -= half\n"
+	"	acc *= one\n"
+	"	acc /= one\n"
+	"	i += 1\n"
+	"end\n"
+	"return acc\n";
+
+// compiles the loop for each case: deoptimized instructions stay generic, a shared script would
+// run every case after the first with the forms the first one left behind
+static void Measure(const char *name, crypt::Variable start, crypt::Variable step, crypt::Variable half,
+	crypt::Variable one) {
+	const crypt::Script script = crypt::Script::Compile(Source);
+	crypt::ScriptContext context{};
+	double best = 1e30;
+	double result = 0.0;
+
+	for (int round = 0; round < Rounds; round++)
+	{
+		crypt::table_type globals{};
+		globals["n"] = crypt::Variable(Iterations);
+		globals["acc"] = start;
+		globals["step"] = step;
+		globals["half"] = half;
+		globals["one"] = one;
+
+		const auto begin = std::chrono::steady_clock::now();
+		result = context.run(script, globals).get_real();
+		const auto end = std::chrono::steady_clock::now();
+
+		best = std::min(best, std::chrono::duration<double>(end - begin).count());
+	}
+
+	printf("%-22s %8.2f ms  %6.2f ns per iteration  (result %.0f)\n",
+		name, best * 1e3, best * 1e9 / double(Iterations), result);
+}
+
+int main() {
+	Measure("int (specialized)",
+		crypt::Variable(crypt::int_type(0)), crypt::Variable(crypt::int_type(3)),
+		crypt::Variable(crypt::int_type(1)), crypt::Variable(crypt::int_type(1)));
+
+	Measure("real (specialized)",
+		crypt::Variable(crypt::real_type(0)), crypt::Variable(crypt::real_type(3)),
+		crypt::Variable(crypt::real_type(1)), crypt::Variable(crypt::real_type(1)));
+
+	// real accumulator, int operands: the arithmetic quickens to the generic forms
+	Measure("real op int (generic)",
+		crypt::Variable(crypt::real_type(0)), crypt::Variable(crypt::int_type(3)),
+		crypt::Variable(crypt::int_type(1)), crypt::Variable(crypt::int_type(1)));
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+// decoding a document into structs: `Bind()` straight from the reader vs `Load()` then copying out of the tree
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/bind.cpp src/*.cpp -o bind
+#include "CryptBind.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct Server
+{
+	crypt::string_type name;
+	int port = 0;
+	double weight = 0.0;
+	bool enabled = false;
+	std::vector<crypt::string_type> tags;
+	std::vector<int> ports;
+};
+CRYPT_BIND(Server, name, port, weight, enabled, tags, ports);
+
+struct Config
+{
+	crypt::string_type title;
+	std::vector<Server> servers;
+};
+CRYPT_BIND(Config, title, servers);
+
+constexpr size_t Servers = 20000;
+constexpr int Rounds = 10;
+
+static std::string Document() {
+	std::string document = "title = \"benchmark\"\nservers = {\n";
+	for (size_t i = 0; i < Servers; i++)
+	{
+		const std::string n = std::to_string(i);
+		document += "\t{ name = \"server-" + n + "\", port = " + std::to_string(8000 + i % 1000) +
+			", weight = " + std::to_string(i % 100) + ".25, enabled = " + (i % 3 ? "true" : "false") +
+			", tags = { \"edge\", \"zone-" + std::to_string(i % 8) + "\" }, ports = { 80, 443, " + n + " } },\n";
+	}
+	return document + "}\n";
+}
+
+// what a caller without the binding layer writes
+static Config CopyOut(const crypt::Variable &document) {
+	const crypt::table_type &root = document.get_table();
+
+	Config config{};
+	config.title = root.at("title").get_string();
+
+	for (const crypt::Variable &entry : root.at("servers").get_list())
+	{
+		const crypt::table_type &table = entry.get_table();
+		Server &server = config.servers.emplace_back();
+		server.name = table.at("name").get_string();
+		server.port = int(table.at("port").get_int());
+		server.weight = table.at("weight").get_real();
+		server.enabled = table.at("enabled").get_bool();
+
+		for (const crypt::Variable &tag : table.at("tags").get_list())
+		{
+			server.tags.push_back(tag.get_string());
+		}
+		for (const crypt::int_type port : table.at("ports").get_int_array())
+		{
+			server.ports.push_back(int(port));
+		}
+	}
+	return config;
+}
+
+template <typename _Decode>
+static void Measure(const char *name, const std::string &document, _Decode &&decode) {
+	double best = 1e30;
+	size_t checksum = 0;
+
+	for (int round = 0; round < Rounds; round++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const Config config = decode();
+		const auto end = std::chrono::steady_clock::now();
+
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+		checksum += config.servers.size() + config.servers.back().ports.back();
+	}
+
+	printf("%-16s %8.2f ms  %7.1f MB/s  (checksum %zu)\n",
+		name, best * 1e3, double(document.size()) / best / 1e6, checksum);
+}
+
+int main() {
+	const std::string document = Document();
+	printf("%zu servers, %zu bytes\n", Servers, document.size());
+
+	Measure("Load + copy", document, [&]() {
+		return CopyOut(crypt::Load(document.c_str(), document.size()));
+	});
+
+	Measure("Bind", document, [&]() {
+		return crypt::Bind<Config>(document.c_str(), document.size());
+	});
+
+	return EXIT_SUCCESS;
+}
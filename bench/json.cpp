@@ -0,0 +1,92 @@
+// json read and write throughput of `LoadJson()`/`SerializeJson()`, against jsoncpp when it's installed
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/json.cpp src/*.cpp -o json
+// with jsoncpp: add -I/usr/include/jsoncpp -ljsoncpp
+#include "CryptJson.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#if __has_include(<json/json.h>)
+#include <json/json.h>
+#define CRYPT_BENCH_JSONCPP 1
+#else
+#define CRYPT_BENCH_JSONCPP 0
+#endif
+
+constexpr size_t Records = 20000;
+constexpr int Rounds = 10;
+
+// records shaped like typical api payloads: nested objects, short arrays, escaped strings
+static std::string Corpus() {
+	std::string corpus = "{\"records\": [\n";
+	for (size_t i = 0; i < Records; i++)
+	{
+		const std::string n = std::to_string(i);
+		corpus += std::string(i ? ",\n" : "") + "  {\"id\": " + n + ", \"name\": \"user \\\"" + n +
+			"\\\"\", \"score\": " + std::to_string(i % 1000) + ".0625, \"active\": " + (i % 2 ? "true" : "false") +
+			", \"tags\": [\"a\", \"b\\u00e9\", null], \"point\": {\"x\": -" + n + ", \"y\": 1.5e3}, \"ids\": [1, 2, " + n + "]}";
+	}
+	return corpus + "\n]}\n";
+}
+
+template <typename _Run>
+static void Measure(const char *name, size_t bytes, _Run &&run) {
+	double best = 1e30;
+	size_t checksum = 0;
+
+	for (int round = 0; round < Rounds; round++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		checksum += run();
+		const auto end = std::chrono::steady_clock::now();
+
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+
+	printf("%-16s %8.2f ms  %7.1f MB/s  (checksum %zu)\n", name, best * 1e3, double(bytes) / best / 1e6, checksum);
+}
+
+int main() {
+	const std::string corpus = Corpus();
+	printf("%zu records, %zu bytes\n", Records, corpus.size());
+
+	Measure("crypt read", corpus.size(), [&]() {
+		return crypt::LoadJson(corpus.c_str(), corpus.size()).get_table().at("records").get_list().size();
+	});
+
+	const crypt::Variable document = crypt::LoadJson(corpus.c_str(), corpus.size());
+	const size_t written = crypt::SerializeJson(document).size();
+	Measure("crypt write", written, [&]() {
+		return crypt::SerializeJson(document).size();
+	});
+
+#if CRYPT_BENCH_JSONCPP
+	Json::CharReaderBuilder builder{};
+	Measure("jsoncpp read", corpus.size(), [&]() {
+		const std::unique_ptr<Json::CharReader> reader{builder.newCharReader()};
+		Json::Value value{};
+		reader->parse(corpus.c_str(), corpus.c_str() + corpus.size(), &value, nullptr);
+		return size_t(value["records"].size());
+	});
+
+	Json::Value value{};
+	{
+		const std::unique_ptr<Json::CharReader> reader{builder.newCharReader()};
+		reader->parse(corpus.c_str(), corpus.c_str() + corpus.size(), &value, nullptr);
+	}
+	Json::StreamWriterBuilder writer{};
+	writer["indentation"] = "";
+	const size_t jsoncpp_written = Json::writeString(writer, value).size();
+	Measure("jsoncpp write", jsoncpp_written, [&]() {
+		return Json::writeString(writer, value).size();
+	});
+#else
+	printf("jsoncpp not found, built without the comparison\n");
+#endif
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+// the cost of a script calling C++: natives bound at compile time, bound callables, a generic
+// `std::function` bridge over a vector of arguments and a script function, over an empty loop
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/natives.cpp src/*.cpp -o natives
+#include "CryptNative.hpp"
+#include "CryptScript.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+constexpr crypt::int_type Iterations = 2000000;
+constexpr int Rounds = 5;
+
+static crypt::int_type Mix(crypt::int_type a, crypt::int_type b) {
+	return (a + b) & 1023;
+}
+
+// the loop calling `call`, with `prelude` ahead of it
+static std::string Source(const std::string &call, const std::string &prelude = "") {
+	return prelude +
+		"i = 0\n"
+		"total = 0\n"
+		"while i < n do\n"
+		"	total += " + call + "\n"
+		"	i += 1\n"
+		"end\n"
+		"return total\n";
+}
+
+// ns per iteration (best of `Rounds`), the calls are what the iterations take over `base`'s
+static double Measure(const char *name, const std::string &source, const crypt::NativeRegistry &natives, double base = 0.0) {
+	crypt::ScriptOptions options{};
+	options.natives = &natives;
+	const crypt::Script script = crypt::Script::Compile(source.c_str(), source.size(), options);
+
+	crypt::ScriptContext context{};
+	double best = 1e30;
+	crypt::int_type total = 0;
+
+	for (int round = 0; round < Rounds; round++)
+	{
+		crypt::table_type globals{};
+		globals["n"] = crypt::Variable(Iterations);
+
+		const auto start = std::chrono::steady_clock::now();
+		total = context.run(script, globals).get_int();
+		const auto end = std::chrono::steady_clock::now();
+
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+
+	const double ns = best * 1e9 / double(Iterations);
+	printf("%-26s %7.2f ns per iteration", name, ns);
+	if (base > 0.0)
+	{
+		printf("  %7.2f ns per call", ns - base);
+	}
+	printf("  (total %lld)\n", static_cast<long long>(total));
+	return ns;
+}
+
+int main() {
+	// the bridge a registry without signature-derived conversions needs
+	const std::function<crypt::Variable(const std::vector<crypt::Variable> &)> generic =
+		[](const std::vector<crypt::Variable> &args) {
+			return crypt::Variable(Mix(args.at(0).get_int(), args.at(1).get_int()));
+		};
+
+	crypt::NativeRegistry natives{};
+	natives.add<&Mix>("mix");
+	natives.add_pure<&Mix>("mix_pure");
+	natives.add("mix_lambda", [](crypt::int_type a, crypt::int_type b) { return Mix(a, b); });
+	natives.add("mix_generic", [&generic](const crypt::Variable &a, const crypt::Variable &b) {
+		return generic(std::vector<crypt::Variable>{a, b});
+	});
+
+	// the loop without a call, its time is subtracted from the others
+	const double base = Measure("no call", Source("(i + 3) & 1023"), natives);
+
+	Measure("add<&F>", Source("mix(i, 3)"), natives, base);
+	Measure("add(callable)", Source("mix_lambda(i, 3)"), natives, base);
+	Measure("std::function + vector", Source("mix_generic(i, 3)"), natives, base);
+	Measure("script function", Source("script_mix(i, 3)",
+		"function script_mix(a, b) do return (a + b) & 1023 end\n"), natives, base);
+	// constant arguments: folded when compiling, the loop runs like one adding the result
+	Measure("no call, constant", Source("8"), natives);
+	Measure("add_pure<&F>, constants", Source("mix_pure(5, 3)"), natives);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+// startup over a corpus of files: `Load()` without a cache, with a cold cache and with a warm one
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/parse_cache.cpp src/*.cpp -o parse_cache
+#include "Crypt.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+constexpr size_t Files = 200;
+constexpr size_t EntriesPerFile = 500;
+
+static void WriteCorpus(const fs::path &directory) {
+	fs::create_directories(directory);
+	for (size_t f = 0; f < Files; f++)
+	{
+		std::ofstream file{directory / ("config_" + std::to_string(f) + ".txt")};
+		for (size_t i = 0; i < EntriesPerFile; i++)
+		{
+			const std::string n = std::to_string(f * EntriesPerFile + i);
+			file << "key_" << i << " = { name = \"value " << n << "\", id = " << n <<
+				", scale = " << i % 13 << ".5, flags = { true, false }, ids = { 1, 2, " << n << " } }\n";
+		}
+	}
+}
+
+// loads every file of the corpus the way an application starting up would
+static void Startup(const char *name, const fs::path &corpus, const crypt::LoadOptions &options) {
+	const auto start = std::chrono::steady_clock::now();
+
+	size_t bytes = 0;
+	size_t hits = 0;
+	for (const fs::directory_entry &entry : fs::directory_iterator{corpus})
+	{
+		std::ifstream file{entry.path()};
+		std::stringstream ss{};
+		ss << file.rdbuf();
+		const std::string source = ss.str();
+
+		crypt::LoadStats stats{};
+		crypt::LoadOptions file_options = options;
+		file_options.stats = &stats;
+
+		const crypt::Variable document = crypt::Load(source.c_str(), source.size(), file_options);
+		bytes += source.size();
+		hits += stats.from_cache;
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	printf("%-10s %8.2f ms  %7.1f MB/s  (%zu of %zu files from the cache)\n",
+		name, seconds * 1e3, double(bytes) / seconds / 1e6, hits, Files);
+}
+
+int main() {
+	const fs::path root = fs::temp_directory_path() / "crypt_bench_parse_cache";
+	const fs::path corpus = root / "corpus";
+	const fs::path cache = root / "cache";
+
+	fs::remove_all(root);
+	WriteCorpus(corpus);
+
+	crypt::LoadOptions cached{};
+	cached.cache_dir = cache.string();
+
+	Startup("no cache", corpus, {});
+	// parses and writes every entry
+	Startup("cold", corpus, cached);
+	Startup("warm", corpus, cached);
+
+	fs::remove_all(root);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+// update cost and memory of 1,000 versions derived from one base table, `PersistentTable` vs copying `table_type`
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/persistent_table.cpp src/*.cpp -o persistent_table
+#include "CryptPersistentTable.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+static size_t AllocatedBytes = 0;
+
+void *operator new(size_t size) {
+	AllocatedBytes += size;
+	if (void *block = malloc(size ? size : 1))
+	{
+		return block;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *block) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+
+constexpr size_t BaseEntries = 5000;
+constexpr size_t Versions = 1000;
+// the per-tenant overrides each version makes on top of the base
+constexpr size_t Overrides = 4;
+
+static std::string Key(size_t i) {
+	return "setting_" + std::to_string(i);
+}
+
+static crypt::string_type OverrideKey(size_t version, size_t i) {
+	return Key((version * 7919 + i * 104729) % BaseEntries);
+}
+
+template <typename _Derive>
+static void Measure(const char *name, _Derive &&derive) {
+	const size_t bytes = AllocatedBytes;
+	const auto start = std::chrono::steady_clock::now();
+	const size_t kept = derive();
+	const auto end = std::chrono::steady_clock::now();
+
+	const double micros = std::chrono::duration<double, std::micro>(end - start).count();
+	printf("%-16s %8.2f us per version, %9.1f KiB allocated per version (%zu versions)\n",
+		name, micros / Versions, double(AllocatedBytes - bytes) / 1024.0 / Versions, kept);
+}
+
+int main() {
+	crypt::table_type base{};
+	for (size_t i = 0; i < BaseEntries; i++)
+	{
+		base.emplace(Key(i), crypt::Variable(crypt::int_type(i)));
+	}
+	const crypt::PersistentTable persistent_base{base};
+
+	Measure("table_type copy", [&]() {
+		std::vector<crypt::table_type> versions{};
+		versions.reserve(Versions);
+		for (size_t v = 0; v < Versions; v++)
+		{
+			crypt::table_type version = base;
+			for (size_t i = 0; i < Overrides; i++)
+			{
+				version[OverrideKey(v, i)] = crypt::Variable(crypt::int_type(-1));
+			}
+			versions.push_back(std::move(version));
+		}
+		return versions.size();
+	});
+
+	Measure("PersistentTable", [&]() {
+		std::vector<crypt::PersistentTable> versions{};
+		versions.reserve(Versions);
+		for (size_t v = 0; v < Versions; v++)
+		{
+			crypt::PersistentTable version = persistent_base;
+			for (size_t i = 0; i < Overrides; i++)
+			{
+				version = version.set(OverrideKey(v, i), crypt::Variable(crypt::int_type(-1)));
+			}
+			versions.push_back(std::move(version));
+		}
+		return versions.size();
+	});
+
+	return EXIT_SUCCESS;
+}
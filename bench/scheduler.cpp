@@ -0,0 +1,102 @@
+// latency of short scripts sharing a worker pool with long ones, run to completion vs time-sliced by `ScriptScheduler`
+// build: g++ -std=c++17 -O2 -pthread -Iinclude -Isrc bench/scheduler.cpp src/*.cpp -o scheduler
+#include "CryptScheduler.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t Workers = 2;
+constexpr size_t ShortRuns = 2000;
+// one long run among every `LongEvery` submitted
+constexpr size_t LongEvery = 100;
+
+static const char Source[] =
+	"i = 0\n"
+	"total = 0\n"
+	"while i < n do\n"
+	"	total += i * 2\n"
+	"	i += 1\n"
+	"end\n"
+	"return total\n";
+
+static crypt::table_type Globals(crypt::int_type iterations) {
+	crypt::table_type globals{};
+	globals["n"] = crypt::Variable(iterations);
+	return globals;
+}
+
+static double Percentile(std::vector<double> &values, double p) {
+	std::sort(values.begin(), values.end());
+	return values[std::min(values.size() - 1, size_t(p * double(values.size())))];
+}
+
+static void Measure(const char *name, const crypt::Script &script, size_t quantum) {
+	struct Pending
+	{
+		std::future<crypt::ScriptResult> result;
+		bool is_short;
+	};
+
+	crypt::ScriptScheduler scheduler{Workers, quantum};
+	std::vector<Pending> pending{};
+
+	// all submitted at once, the long runs spread among the short ones
+	const Clock::time_point submitted = Clock::now();
+	for (size_t i = 0; i < ShortRuns; i++)
+	{
+		if (i % LongEvery == 0)
+		{
+			pending.push_back({ scheduler.submit(script, Globals(2000000)), false });
+		}
+		pending.push_back({ scheduler.submit(script, Globals(200)), true });
+	}
+
+	// completion times are sampled by polling, so they're late by at most one sweep
+	std::vector<double> latencies{};
+	std::vector<bool> done(pending.size(), false);
+	size_t remaining = pending.size();
+	double makespan = 0.0;
+
+	while (remaining != 0)
+	{
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			if (done[i] || pending[i].result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				continue;
+			}
+
+			const double ms = std::chrono::duration<double, std::milli>(Clock::now() - submitted).count();
+			pending[i].result.get();
+			done[i] = true;
+			remaining--;
+			makespan = std::max(makespan, ms);
+
+			if (pending[i].is_short)
+			{
+				latencies.push_back(ms);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	printf("%-18s short runs p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms  (all done in %.0f ms)\n",
+		name, Percentile(latencies, 0.50), Percentile(latencies, 0.99), Percentile(latencies, 1.0), makespan);
+}
+
+int main() {
+	const crypt::Script script = crypt::Script::Compile(Source);
+	printf("%zu workers, %zu short runs, %zu long ones\n", Workers, ShortRuns, ShortRuns / LongEvery);
+
+	Measure("run to completion", script, std::numeric_limits<size_t>::max());
+	Measure("quantum 10000", script, 10000);
+	Measure("quantum 1000", script, 1000);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+// write throughput of `Serialize()` (compact and pretty) against a plain `std::ostream` writer
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc bench/serialize.cpp src/*.cpp -o serialize
+#include "CryptSerialize.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+constexpr size_t Entries = 20000;
+constexpr int Rounds = 10;
+
+static std::string Source() {
+	std::string source{};
+	for (size_t i = 0; i < Entries; i++)
+	{
+		const std::string n = std::to_string(i);
+		source += "entry_" + n + " = { name = \"item \\\"" + n + "\\\"\", count = " + n +
+			", ratio = " + std::to_string(i % 97) + ".125, live = true, ids = { 1, 2, " + n +
+			" }, weights = { 0.5, 1.75 }, notes = { \"a\", 3, false } }\n";
+	}
+	return source;
+}
+
+// the kind of writer `Serialize()` replaces: compact, through iostreams
+static void StreamWrite(std::ostream &out, const crypt::Variable &value) {
+	switch (value.get_type())
+	{
+	case crypt::VariableType::Null:
+		out << "null";
+		break;
+	case crypt::VariableType::Bool:
+		out << (value.get_bool() ? "true" : "false");
+		break;
+	case crypt::VariableType::Int:
+		out << value.get_int();
+		break;
+	case crypt::VariableType::Real:
+		out << value.get_real();
+		break;
+	case crypt::VariableType::Str:
+		out << '"';
+		for (const char c : value.get_string())
+		{
+			if (c == '"' || c == '\\')
+			{
+				out << '\\';
+			}
+			out << c;
+		}
+		out << '"';
+		break;
+	case crypt::VariableType::Table:
+		{
+			out << "{ ";
+			for (const auto &entry : value.get_table())
+			{
+				out << entry.first << " = ";
+				StreamWrite(out, entry.second);
+				out << ", ";
+			}
+			out << '}';
+		}
+		break;
+	default:
+		{
+			out << "{ ";
+			for (const crypt::Variable &element : value.get_list())
+			{
+				StreamWrite(out, element);
+				out << ", ";
+			}
+			out << '}';
+		}
+		break;
+	}
+}
+
+template <typename _Write>
+static void Measure(const char *name, _Write &&write) {
+	double best = 1e30;
+	size_t written = 0;
+
+	for (int round = 0; round < Rounds; round++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		written = write();
+		const auto end = std::chrono::steady_clock::now();
+
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+
+	printf("%-16s %8.2f ms  %7.1f MB/s  (%zu bytes)\n", name, best * 1e3, double(written) / best / 1e6, written);
+}
+
+int main() {
+	const std::string source = Source();
+	const crypt::Variable document = crypt::Load(source.c_str(), source.size());
+
+	Measure("std::ostream", [&]() {
+		std::ostringstream out{};
+		StreamWrite(out, document);
+		return out.str().size();
+	});
+
+	Measure("compact", [&]() {
+		return crypt::Serialize(document).size();
+	});
+
+	Measure("pretty", [&]() {
+		crypt::SerializeOptions options{};
+		options.pretty = true;
+		return crypt::Serialize(document, options).size();
+	});
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+// throughput of one compiled script run at once from 1, 2, 4... threads, each with its own context
+// build: g++ -std=c++17 -O2 -pthread -Iinclude -Isrc bench/threads.cpp src/*.cpp -o threads
+// usage: threads [max threads], the hardware's thread count by default
+#include "CryptScript.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+constexpr size_t RunsPerThread = 20000;
+
+// a small rule evaluation, like what each request runs
+static const char Source[] =
+	"function clamp(value, low, high) do\n"
+	"	if value < low then return low elif value > high then return high end\n"
+	"	return value\n"
+	"end\n"
+	"score = 0\n"
+	"i = 0\n"
+	"while i < 20 do\n"
+	"	score += clamp(request.weight * i - request.penalty, 0, 100)\n"
+	"	i += 1\n"
+	"end\n"
+	"return score >= request.threshold\n";
+
+static crypt::table_type Globals(size_t i) {
+	crypt::table_type request{};
+	request["weight"] = crypt::Variable(crypt::int_type(3 + i % 5));
+	request["penalty"] = crypt::Variable(crypt::int_type(i % 7));
+	request["threshold"] = crypt::Variable(crypt::int_type(500));
+
+	crypt::table_type globals{};
+	globals["request"] = crypt::Variable(std::move(request));
+	return globals;
+}
+
+// runs per second with `threads` threads sharing `script`
+static double Throughput(const crypt::Script &script, size_t threads) {
+	std::atomic<size_t> passed{0};
+	std::vector<std::thread> workers{};
+
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&script, &passed, t]() {
+			crypt::ScriptContext context{};
+			size_t local = 0;
+
+			for (size_t i = 0; i < RunsPerThread; i++)
+			{
+				crypt::table_type globals = Globals(t + i);
+				local += context.run(script, globals).get_bool();
+			}
+			passed.fetch_add(local, std::memory_order_relaxed);
+		});
+	}
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	return double(threads * RunsPerThread) / seconds;
+}
+
+int main(int argc, char **argv) {
+	const crypt::Script script = crypt::Script::Compile(Source);
+	const size_t cores = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+
+	// warms the quickened forms up so every measurement runs the same code
+	Throughput(script, 1);
+
+	double single = 0.0;
+	for (size_t threads = 1; threads <= cores; threads *= 2)
+	{
+		const double runs = Throughput(script, threads);
+		if (threads == 1)
+		{
+			single = runs;
+		}
+
+		printf("%3zu threads  %10.0f runs/s  %5.2fx  (%.0f%% of linear)\n",
+			threads, runs, runs / single, 100.0 * runs / single / double(threads));
+	}
+
+	return EXIT_SUCCESS;
+}
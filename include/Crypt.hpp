@@ -2,6 +2,7 @@
 #define _CRYPT_H_
 #include <inttypes.h>
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <string>
@@ -11,6 +12,9 @@
 #define EOK 0
 #endif
 
+// bumped whenever the parsed result or the cached formats change
+#define CRYPT_VERSION "0.2.0"
+
 namespace crypt
 {
 	class Variable;
@@ -25,6 +29,9 @@ namespace crypt
 	typedef std::vector<Variable> list_type;
 	typedef std::map<string_type, Variable> table_type;
 
+	typedef std::vector<int_type> int_array_type;
+	typedef std::vector<real_type> real_array_type;
+
 	enum class VariableType : uint8_t
 	{
 		Null,
@@ -33,7 +40,58 @@ namespace crypt
 		Real,
 		Str,
 		List, // array
-		Table // dict/map
+		Table, // dict/map
+
+		// homogeneous lists of numbers, stored contiguously
+		IntArray,
+		RealArray
+	};
+
+	// read-only view over contiguous values
+	template <typename T>
+	struct Span
+	{
+		inline const T *begin() const noexcept { return data; }
+		inline const T *end() const noexcept { return data + size; }
+		inline const T &operator[](size_t index) const noexcept { return data[index]; }
+		inline bool empty() const noexcept { return size == 0; }
+
+		const T *data = nullptr;
+		size_t size = 0;
+	};
+
+	// reference counted payload of the heap allocated variable types (string/list/table),
+	// copies of a variable share the same payload until one of them is mutated
+	template <typename T>
+	struct SharedPayload
+	{
+		template <typename... Args>
+		inline SharedPayload(Args &&...args) : value(std::forward<Args>(args)...) {}
+
+		std::atomic<uint32_t> refs{1};
+		// see `Variable::get_stamp()`, zero until requested
+		mutable std::atomic<uint64_t> stamp{0};
+		// see `Variable::get_hash()`, zero until computed
+		mutable std::atomic<uint64_t> hash{0};
+		// a mutable reference to `value` was handed out, which can change it at any time without
+		// going through a variable: the payload then never gets a stamp or a memoized hash
+		std::atomic<bool> exposed{false};
+		T value;
+	};
+
+	// packed numbers of an IntArray/RealArray variable,
+	// `boxed` caches the generic list view built on the first (const) `get_list()`
+	template <typename T>
+	struct PackedArray
+	{
+		inline PackedArray() = default;
+		inline PackedArray(const PackedArray &copy) : values{copy.values} {}
+		inline PackedArray(const std::vector<T> &_values) : values{_values} {}
+		inline PackedArray(std::vector<T> &&_values) : values{std::move(_values)} {}
+		inline ~PackedArray() { delete boxed.load(std::memory_order_acquire); }
+
+		std::vector<T> values;
+		mutable std::atomic<list_type *> boxed{nullptr};
 	};
 
 	class VariableAccessError : std::runtime_error
@@ -56,6 +114,15 @@ namespace crypt
 		Variable(const list_type &value);
 		Variable(const table_type &value);
 
+		Variable(string_type &&value);
+		Variable(list_type &&value);
+		Variable(table_type &&value);
+
+		Variable(const int_array_type &value);
+		Variable(const real_array_type &value);
+		Variable(int_array_type &&value);
+		Variable(real_array_type &&value);
+
 		Variable(const Variable &copy);
 		Variable(Variable &&move) noexcept;
 
@@ -64,12 +131,29 @@ namespace crypt
 
 		~Variable();
 
+		inline VariableType get_type() const noexcept { return m_type; }
+
 		inline bool is_null() const noexcept { return m_type == _null; }
+		inline bool is_list() const noexcept {
+			return m_type == VariableType::List || m_type == VariableType::IntArray || m_type == VariableType::RealArray;
+		}
 
 		boolean_type get_bool() const;
 		int_type get_int() const;
 		real_type get_real() const;
 
+		// unchecked reads, for callers that already checked `get_type()`
+		inline boolean_type get_bool_unchecked() const noexcept { return m_boolean; }
+		inline int_type get_int_unchecked() const noexcept { return m_integer; }
+		inline real_type get_real_unchecked() const noexcept { return m_real; }
+
+		// overwrite the value with a scalar in place, only going through the
+		// payload release when the current value has a payload
+		inline void set_null() { _make_scalar(_null); }
+		inline void set_bool(boolean_type value) { _make_scalar(VariableType::Bool); m_boolean = value; }
+		inline void set_int(int_type value) { _make_scalar(VariableType::Int); m_integer = value; }
+		inline void set_real(real_type value) { _make_scalar(VariableType::Real); m_real = value; }
+
 		string_type &get_string();
 		list_type &get_list();
 		table_type &get_table();
@@ -78,10 +162,138 @@ namespace crypt
 		const list_type &get_list() const;
 		const table_type &get_table() const;
 
+		// identifies the current contents of a string/list/table/array payload: while the stamp
+		// doesn't change, neither does the payload (it is cleared by any mutable access);
+		// stamps are never reused, zero for the other types and for payloads a mutable reference
+		// was handed out for (by the non-const getters or `emplace_*()`), as writes through such
+		// a reference can't clear it
+		uint64_t get_stamp() const;
+
+		// structural hash of the type and contents, memoized in the payloads of the
+		// strings/lists/tables when nothing in them had a mutable reference handed out
+		// (and cleared by any mutable access like the stamps);
+		// packed arrays hash (and compare) the same as the lists they box to
+		uint64_t get_hash() const;
+
+		// both hold the same string/list/table/array payload
+		inline bool shares_payload(const Variable &other) const noexcept {
+			return m_type == other.m_type && m_type > VariableType::Real && m_string == other.m_string;
+		}
+
+		// deep equality, types must match (except for lists and packed arrays) and reals compare by value;
+		// payloads shared by both sides compare equal right away and mismatching hashes fail right away
+		bool operator==(const Variable &other) const;
+		inline bool operator!=(const Variable &other) const { return !(*this == other); }
+
+		// views of the packed numeric arrays, only valid for the IntArray/RealArray types
+		Span<int_type> get_int_array() const;
+		Span<real_type> get_real_array() const;
+
+		// `get_list()` also accepts the packed arrays: the const version boxes the numbers
+		// into a cached list, the non-const one converts the variable into a regular list
+
+		// replaces the value with a string/list/table constructed in-place from `args`
+		template <typename... Args>
+		inline string_type &emplace_string(Args &&...args) {
+			string_type &value = this->_build_string(std::forward<Args>(args)...);
+			m_string->exposed.store(true, std::memory_order_release);
+			return value;
+		}
+
+		template <typename... Args>
+		inline list_type &emplace_list(Args &&...args) {
+			list_type &value = this->_build_list(std::forward<Args>(args)...);
+			m_list->exposed.store(true, std::memory_order_release);
+			return value;
+		}
+
+		template <typename... Args>
+		inline table_type &emplace_table(Args &&...args) {
+			table_type &value = this->_build_table(std::forward<Args>(args)...);
+			m_table->exposed.store(true, std::memory_order_release);
+			return value;
+		}
+
+		template <typename... Args>
+		inline int_array_type &emplace_int_array(Args &&...args) {
+			int_array_type &value = this->_build_int_array(std::forward<Args>(args)...);
+			m_int_array->exposed.store(true, std::memory_order_release);
+			return value;
+		}
+
+		template <typename... Args>
+		inline real_array_type &emplace_real_array(Args &&...args) {
+			real_array_type &value = this->_build_real_array(std::forward<Args>(args)...);
+			m_real_array->exposed.store(true, std::memory_order_release);
+			return value;
+		}
+
+		// the non-const getters above detach (copy) a payload shared with other variables
+		// before returning it; references returned from them stay valid while the variable holds
+		// the value, and copies made while one is out get a payload of their own (a deep copy),
+		// so later writes through the reference don't show in them
+
+		// for the library's own code: the non-const getters and `emplace_*()` for callers that are
+		// done with the reference before anything else sees the value, which keeps the payload
+		// stamped (see `get_stamp()`)
+		string_type &_edit_string();
+		list_type &_edit_list();
+		table_type &_edit_table();
+
+		template <typename... Args>
+		inline string_type &_build_string(Args &&...args) {
+			return _emplace(m_string, VariableType::Str, std::forward<Args>(args)...);
+		}
+
+		template <typename... Args>
+		inline list_type &_build_list(Args &&...args) {
+			return _emplace(m_list, VariableType::List, std::forward<Args>(args)...);
+		}
+
+		template <typename... Args>
+		inline table_type &_build_table(Args &&...args) {
+			return _emplace(m_table, VariableType::Table, std::forward<Args>(args)...);
+		}
+
+		template <typename... Args>
+		inline int_array_type &_build_int_array(Args &&...args) {
+			return _emplace(m_int_array, VariableType::IntArray, int_array_type(std::forward<Args>(args)...)).values;
+		}
+
+		template <typename... Args>
+		inline real_array_type &_build_real_array(Args &&...args) {
+			return _emplace(m_real_array, VariableType::RealArray, real_array_type(std::forward<Args>(args)...)).values;
+		}
+
 	private:
 		template <typename _Proc>
 		decltype(auto) __apply(_Proc &&proc);
 
+		// destroys the current value, leaving the variable null
+		void _release();
+		// `get_hash()`, clears `current` if the hash can't be memoized by the payloads holding this
+		uint64_t _hash(bool &current) const;
+
+		inline void _make_scalar(VariableType type) {
+			// the scalar types come first in `VariableType`, the rest have payloads
+			if (m_type > VariableType::Real)
+			{
+				this->_release();
+			}
+
+			m_type = type;
+		}
+
+		template <typename T, typename... Args>
+		inline T &_emplace(SharedPayload<T> *&member, VariableType type, Args &&...args) {
+			// construct first, the args might reference our current value
+			SharedPayload<T> *payload = new SharedPayload<T>(std::forward<Args>(args)...);
+			this->_release();
+			m_type = type;
+			member = payload;
+			return payload->value;
+		}
+
 	private:
 		VariableType m_type;
 		union
@@ -89,12 +301,54 @@ namespace crypt
 			boolean_type m_boolean;
 			int_type m_integer;
 			real_type m_real;
-			string_type m_string;
-			list_type m_list;
-			table_type m_table;
+			SharedPayload<string_type> *m_string;
+			SharedPayload<list_type> *m_list;
+			SharedPayload<table_type> *m_table;
+			SharedPayload<PackedArray<int_type>> *m_int_array;
+			SharedPayload<PackedArray<real_type>> *m_real_array;
 		};
 	};
 
+	struct LoadStats
+	{
+		// values replaced by an equal value's payload
+		size_t shared_values = 0;
+		// estimated heap bytes freed by the sharing
+		size_t saved_bytes = 0;
+		// the document was restored from `LoadOptions::cache_dir` instead of being parsed
+		bool from_cache = false;
+	};
+
+	struct LoadOptions
+	{
+		// equal strings/lists/tables/arrays share a single payload (see `Deduplicate()`)
+		bool deduplicate = false;
+		// filled when not null
+		LoadStats *stats = nullptr;
+		// when not empty, documents are cached here as binary snapshots keyed by a hash of
+		// the source and `CRYPT_VERSION`, unchanged sources are then restored without parsing;
+		// the directory is created on demand and cache io errors never fail the load
+		string_type cache_dir;
+	};
+
+	// parses a crypt document (`key = value` entries) into a table variable,
+	// a `length` of zero reads `source` up to its null terminator;
+	// syntax errors throw std::runtime_error naming where they are, like `Reader`'s
+	Variable Load(const char_type *source, size_t length = 0);
+	Variable Load(const char_type *source, size_t length, const LoadOptions &options);
+
+	// hash-conses the tree: structurally equal subtrees end up sharing one payload,
+	// which copy-on-write keeps safe to mutate afterwards
+	void Deduplicate(Variable &root, LoadStats *stats = nullptr);
+
 }
 
+template <>
+struct std::hash<crypt::Variable>
+{
+	inline size_t operator()(const crypt::Variable &value) const {
+		return static_cast<size_t>(value.get_hash());
+	}
+};
+
 #endif
\ No newline at end of file
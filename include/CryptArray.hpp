@@ -0,0 +1,27 @@
+#ifndef _CRYPT_ARRAY_H_
+#define _CRYPT_ARRAY_H_
+#include "Crypt.hpp"
+
+// vectorized helpers over the packed numeric arrays (`Variable::get_int_array()`/`get_real_array()`)
+
+namespace crypt
+{
+	int_type ArraySum(Span<int_type> values);
+	real_type ArraySum(Span<real_type> values);
+
+	// throws std::out_of_range on empty arrays
+	int_type ArrayMin(Span<int_type> values);
+	real_type ArrayMin(Span<real_type> values);
+	int_type ArrayMax(Span<int_type> values);
+	real_type ArrayMax(Span<real_type> values);
+
+	// throws std::invalid_argument if the sizes mismatch
+	int_type ArrayDot(Span<int_type> left, Span<int_type> right);
+	real_type ArrayDot(Span<real_type> left, Span<real_type> right);
+
+	// writes `values[i] * factor` to `out[i]`, `out` must hold `values.size` elements
+	void ArrayScale(Span<int_type> values, int_type factor, int_type *out);
+	void ArrayScale(Span<real_type> values, real_type factor, real_type *out);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _CRYPT_BATCH_H_
+#define _CRYPT_BATCH_H_
+#include "CryptScript.hpp"
+
+#include <memory>
+
+// the compiled form of a batch expression, see `crypt::BatchExpression`
+struct BatchProgram;
+
+namespace crypt
+{
+	// the values of one field for every record of a batch, borrowed from the caller
+	class BatchColumn
+	{
+	public:
+		BatchColumn() = default;
+		inline BatchColumn(const int_type *values, size_t size) : m_type{VariableType::Int}, m_data{values}, m_size{size} {}
+		inline BatchColumn(const real_type *values, size_t size) : m_type{VariableType::Real}, m_data{values}, m_size{size} {}
+		inline BatchColumn(const boolean_type *values, size_t size) : m_type{VariableType::Bool}, m_data{values}, m_size{size} {}
+		inline BatchColumn(Span<int_type> values) : BatchColumn(values.data, values.size) {}
+		inline BatchColumn(Span<real_type> values) : BatchColumn(values.data, values.size) {}
+
+		// `Int`, `Real` or `Bool`, `Null` for an empty column
+		inline VariableType get_type() const noexcept { return m_type; }
+		inline const void *data() const noexcept { return m_data; }
+		inline size_t size() const noexcept { return m_size; }
+
+	private:
+		VariableType m_type = VariableType::Null;
+		const void *m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+	typedef std::map<string_type, BatchColumn> batch_columns_type;
+
+	// one bit per record, set for the records an expression selected
+	class Selection
+	{
+	public:
+		inline size_t size() const noexcept { return m_size; }
+		inline bool test(size_t index) const noexcept { return (m_words[index / 64] >> (index % 64)) & 1; }
+
+		// how many records are selected
+		size_t count() const noexcept;
+
+		// bit `i % 64` of word `i / 64` is record `i`, the bits past `size()` are clear
+		inline const std::vector<uint64_t> &words() const noexcept { return m_words; }
+
+	private:
+		friend class BatchExpression;
+
+		std::vector<uint64_t> m_words;
+		size_t m_size = 0;
+	};
+
+	// an expression compiled once and evaluated over whole columns of records at a time, for example:
+	//
+	//	level > 30 and health < 50
+	//
+	// names are columns (see `select()`), the operators are those of scripts and mix ints, reals and
+	// bools the same way (ints mixed with reals become reals), except that `and`/`or`/`not` only
+	// yield whether the operands are truthy; strings, fields and calls aren't supported;
+	// a compiled expression is immutable and can be shared by any number of threads
+	class BatchExpression
+	{
+	public:
+		BatchExpression() = default;
+
+		// throws ScriptError on syntax errors and on what batches don't support
+		static BatchExpression Compile(const char_type *source, size_t length = 0);
+
+		// the names of the columns the expression reads
+		const std::vector<string_type> &get_columns() const;
+
+		// evaluates the expression for the `count` records of `columns` (which may hold more columns
+		// than it reads), selecting the records it's truthy for;
+		// throws ScriptError on unknown columns, operand type errors and int division by zero,
+		// std::invalid_argument if a column it reads holds fewer than `count` values
+		void select(const batch_columns_type &columns, size_t count, Selection &out) const;
+		Selection select(const batch_columns_type &columns, size_t count) const;
+
+	private:
+		std::shared_ptr<const BatchProgram> m_program;
+	};
+}
+
+#endif
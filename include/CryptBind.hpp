@@ -0,0 +1,274 @@
+#ifndef _CRYPT_BIND_H_
+#define _CRYPT_BIND_H_
+#include "CryptReader.hpp"
+
+#include <tuple>
+#include <optional>
+#include <type_traits>
+
+// decodes documents straight into C++ structs, without building `Variable` trees
+//
+// the fields of a struct are declared once, either with the macro (at global scope):
+//   CRYPT_BIND(Stats, level, health, effects);
+// or with an explicit field list, for keys that aren't valid member names:
+//   template <> struct crypt::Binding<Stats>
+//   {
+//     static constexpr auto fields = crypt::Fields(
+//       crypt::Field("level", &Stats::level),
+//       crypt::Field("fourth elm", &Stats::fourth)
+//     );
+//   };
+//
+// supported members are bools, numbers, strings, `crypt::Variable` (any value),
+// other bound structs and `std::vector`/`std::optional` of those;
+// unknown keys are skipped and missing keys leave their members untouched
+
+namespace crypt
+{
+	class BindError : public std::runtime_error
+	{
+	public:
+		inline BindError(const std::string &msg) : std::runtime_error(msg) {}
+	};
+
+	template <typename _Class, typename _Member>
+	struct Field
+	{
+		constexpr Field(const char_type *_name, _Member _Class:: *_member)
+			: name{_name}, length{_Length(_name)}, member{_member} {
+		}
+
+		const char_type *name;
+		size_t length;
+		_Member _Class:: *member;
+
+	private:
+		static constexpr size_t _Length(const char_type *str) {
+			size_t length = 0;
+			while (str[length] != char_type())
+			{
+				length++;
+			}
+			return length;
+		}
+	};
+
+	template <typename... _Fields>
+	constexpr std::tuple<_Fields...> Fields(_Fields... fields) {
+		return {fields...};
+	}
+
+	// specialized for each bound struct, with a static constexpr `fields` tuple
+	template <typename T>
+	struct Binding
+	{
+	};
+
+	// decodes a single value (consuming all its events) into `out`
+	template <typename T, typename = void>
+	struct Decoder;
+
+	template <typename T>
+	void Decode(Reader &reader, T &out) {
+		Decoder<T>::Decode(reader, out);
+	}
+
+	// decodes a whole document into a bound struct
+	template <typename T>
+	T Bind(const char_type *source, size_t length = 0) {
+		Reader reader{source, length};
+		T result{};
+		Decode(reader, result);
+		return result;
+	}
+
+	[[noreturn]] inline void _FailExpecting(const Reader &reader, const char *what) {
+		throw BindError(
+			std::string("expected ") + what + " at " +
+			std::to_string(reader.get_line()) + ":" + std::to_string(reader.get_column())
+		);
+	}
+
+	inline void _ExpectEvent(Reader &reader, ReadEvent expected, const char *what) {
+		if (reader.next() != expected)
+		{
+			_FailExpecting(reader, what);
+		}
+	}
+
+	// `get()` (one of the reader's value getters), values of the wrong type fail like `_ExpectEvent()`
+	template <typename _Get>
+	inline decltype(auto) _GetValue(const Reader &reader, const char *what, _Get &&get) {
+		try
+		{
+			return get();
+		}
+		catch (const VariableAccessError &)
+		{
+			_FailExpecting(reader, what);
+		}
+	}
+
+	template <>
+	struct Decoder<bool>
+	{
+		static inline void Decode(Reader &reader, bool &out) {
+			_ExpectEvent(reader, ReadEvent::Value, "a boolean");
+			out = _GetValue(reader, "a boolean", [&]() { return reader.get_bool(); });
+		}
+	};
+
+	template <typename T>
+	struct Decoder<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+	{
+		static inline void Decode(Reader &reader, T &out) {
+			_ExpectEvent(reader, ReadEvent::Value, "an int");
+			out = static_cast<T>(_GetValue(reader, "an int", [&]() { return reader.get_int(); }));
+		}
+	};
+
+	template <typename T>
+	struct Decoder<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		static inline void Decode(Reader &reader, T &out) {
+			_ExpectEvent(reader, ReadEvent::Value, "a real");
+			out = static_cast<T>(_GetValue(reader, "a real", [&]() { return reader.get_real(); }));
+		}
+	};
+
+	template <>
+	struct Decoder<string_type>
+	{
+		static inline void Decode(Reader &reader, string_type &out) {
+			_ExpectEvent(reader, ReadEvent::Value, "a string");
+			out = _GetValue(reader, "a string", [&]() -> const string_type & { return reader.get_string(); });
+		}
+	};
+
+	template <>
+	struct Decoder<Variable>
+	{
+		static inline void Decode(Reader &reader, Variable &out) {
+			out = reader.read_value();
+		}
+	};
+
+	template <typename T>
+	struct Decoder<std::vector<T>>
+	{
+		static void Decode(Reader &reader, std::vector<T> &out) {
+			_ExpectEvent(reader, ReadEvent::ListBegin, "a list");
+			out.clear();
+
+			while (reader.peek() != ReadEvent::ListEnd)
+			{
+				// std::vector<bool> hands out proxies, not references
+				if constexpr (std::is_same_v<T, bool>)
+				{
+					bool value = false;
+					Decoder<bool>::Decode(reader, value);
+					out.push_back(value);
+				}
+				else
+				{
+					Decoder<T>::Decode(reader, out.emplace_back());
+				}
+			}
+
+			reader.next();
+		}
+	};
+
+	template <typename T>
+	struct Decoder<std::optional<T>>
+	{
+		static void Decode(Reader &reader, std::optional<T> &out) {
+			// null leaves the optional empty
+			if (reader.peek() == ReadEvent::Value && reader.get_value_type() == VariableType::Null)
+			{
+				reader.next();
+				out.reset();
+				return;
+			}
+
+			Decoder<T>::Decode(reader, out.emplace());
+		}
+	};
+
+	template <typename T>
+	struct Decoder<T, std::void_t<decltype(Binding<T>::fields)>>
+	{
+		static void Decode(Reader &reader, T &out) {
+			_ExpectEvent(reader, ReadEvent::TableBegin, "a table");
+
+			while (reader.next() == ReadEvent::Key)
+			{
+				const string_type &key = reader.get_key();
+
+				// unrolled over the fields, the lengths are constants so most comparisons end there
+				const bool matched = std::apply(
+					[&](const auto &...fields) {
+						return (_DecodeField(reader, out, key, fields) || ...);
+					},
+					Binding<T>::fields
+				);
+
+				if (!matched)
+				{
+					reader.skip_value();
+				}
+			}
+		}
+
+	private:
+		template <typename _Member>
+		static inline bool _DecodeField(Reader &reader, T &out, const string_type &key, const Field<T, _Member> &field) {
+			if (key.size() != field.length || key.compare(0, field.length, field.name, field.length) != 0)
+			{
+				return false;
+			}
+
+			Decoder<_Member>::Decode(reader, out.*field.member);
+			return true;
+		}
+	};
+}
+
+#define _CRYPT_EXPAND(x) x
+#define _CRYPT_FIELD(type, member) crypt::Field(#member, &type::member)
+
+#define _CRYPT_FIELDS_1(type, m) _CRYPT_FIELD(type, m)
+#define _CRYPT_FIELDS_2(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_1(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_3(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_2(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_4(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_3(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_5(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_4(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_6(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_5(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_7(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_6(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_8(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_7(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_9(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_8(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_10(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_9(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_11(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_10(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_12(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_11(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_13(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_12(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_14(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_13(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_15(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_14(type, __VA_ARGS__))
+#define _CRYPT_FIELDS_16(type, m, ...) _CRYPT_FIELD(type, m), _CRYPT_EXPAND(_CRYPT_FIELDS_15(type, __VA_ARGS__))
+
+#define _CRYPT_FIELDS_SELECT( \
+	_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, name, ...) name
+
+// binds up to 16 members of `type`, each read from the key of the same name
+#define CRYPT_BIND(type, ...) \
+	template <> \
+	struct crypt::Binding<type> \
+	{ \
+		static constexpr auto fields = crypt::Fields( \
+			_CRYPT_EXPAND(_CRYPT_FIELDS_SELECT(__VA_ARGS__, \
+				_CRYPT_FIELDS_16, _CRYPT_FIELDS_15, _CRYPT_FIELDS_14, _CRYPT_FIELDS_13, \
+				_CRYPT_FIELDS_12, _CRYPT_FIELDS_11, _CRYPT_FIELDS_10, _CRYPT_FIELDS_9, \
+				_CRYPT_FIELDS_8, _CRYPT_FIELDS_7, _CRYPT_FIELDS_6, _CRYPT_FIELDS_5, \
+				_CRYPT_FIELDS_4, _CRYPT_FIELDS_3, _CRYPT_FIELDS_2, _CRYPT_FIELDS_1)(type, __VA_ARGS__)) \
+		); \
+	}
+
+#endif
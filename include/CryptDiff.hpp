@@ -0,0 +1,32 @@
+#ifndef _CRYPT_DIFF_H_
+#define _CRYPT_DIFF_H_
+#include "CryptPath.hpp"
+
+namespace crypt
+{
+	enum class ChangeKind : uint8_t
+	{
+		Added,
+		Removed,
+		Modified,
+	};
+
+	struct Change
+	{
+		ChangeKind kind;
+		Path path;
+		// the new value, null for removals
+		Variable value;
+	};
+
+	// the changes turning `from` into `to`, down to the deepest differing table keys/list indices;
+	// equal subtrees are skipped through `Variable::operator==` (shared payloads and memoized hashes),
+	// so the cost follows the changed parts once the hashes are known
+	std::vector<Change> Diff(const Variable &from, const Variable &to);
+
+	// applies `changes` (as returned by `Diff`) in order,
+	// throws VariableAccessError if a change's path doesn't fit `target`
+	void Patch(Variable &target, const std::vector<Change> &changes);
+}
+
+#endif
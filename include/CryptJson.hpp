@@ -0,0 +1,36 @@
+#ifndef _CRYPT_JSON_H_
+#define _CRYPT_JSON_H_
+#include "CryptSerialize.hpp"
+
+namespace crypt
+{
+	// malformed json, with the position (1-based) of the offending char
+	class JsonError : public std::runtime_error
+	{
+	public:
+		inline JsonError(const std::string &msg, size_t line, size_t column)
+			: std::runtime_error(msg), m_line{line}, m_column{column} {
+		}
+
+		inline size_t get_line() const noexcept { return m_line; }
+		inline size_t get_column() const noexcept { return m_column; }
+
+	private:
+		size_t m_line;
+		size_t m_column;
+	};
+
+	// parses a json value (of any type, not just objects): objects become tables, arrays lists,
+	// integral numbers ints (reals when they overflow) and the rest reals; later duplicate keys win;
+	// a `length` of zero reads `source` up to its null terminator, throws JsonError
+	Variable LoadJson(const char_type *source, size_t length = 0);
+
+	// writes `value` as json, packed arrays as plain arrays; strings are written as utf-8
+	// with only the required escapes, `options.document` is ignored;
+	// throws std::domain_error for infinite/nan reals
+	void SerializeJson(const Variable &value, Sink &sink, const SerializeOptions &options = {});
+	void SerializeJson(const Variable &value, string_type &out, const SerializeOptions &options = {});
+	string_type SerializeJson(const Variable &value, const SerializeOptions &options = {});
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef _CRYPT_NATIVE_H_
+#define _CRYPT_NATIVE_H_
+#include "Crypt.hpp"
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// C++ functions callable from scripts, for example:
+//
+//	static crypt::int_type Clamp(crypt::int_type value, crypt::int_type low, crypt::int_type high) { ... }
+//
+//	crypt::NativeRegistry natives{};
+//	natives.add_pure<&Clamp>("clamp");
+//	natives.add("log", [&](const crypt::string_type &message) { lines.push_back(message); });
+//
+//	crypt::ScriptOptions options{};
+//	options.natives = &natives;
+//	crypt::Script script = crypt::Script::Compile(source, 0, options);
+//
+// the conversions of the arguments and the result are derived from the C++ signature,
+// the arguments are converted straight from the vm stack; supported types are bools, numbers,
+// strings, lists, tables and `crypt::Variable` (any value), by value or const reference,
+// `void` results are null; an argument of the wrong type fails the call with a ScriptError
+// (as do the exceptions the function throws);
+// script functions of the same name take precedence over natives
+
+namespace crypt
+{
+	// how a C++ type crosses into (`From()`) and out of (`To()`) scripts
+	template <typename T, typename = void>
+	struct NativeValue;
+
+	[[noreturn]] void _NativeTypeError(const char *expected, const Variable &value);
+
+	template <>
+	struct NativeValue<bool>
+	{
+		static inline bool From(const Variable &value) {
+			if (value.get_type() != VariableType::Bool)
+			{
+				_NativeTypeError("a bool", value);
+			}
+			return value.get_bool();
+		}
+
+		static inline Variable To(bool value) { return Variable(value); }
+	};
+
+	template <typename T>
+	struct NativeValue<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+	{
+		static inline T From(const Variable &value) {
+			if (value.get_type() != VariableType::Int)
+			{
+				_NativeTypeError("an int", value);
+			}
+			return static_cast<T>(value.get_int());
+		}
+
+		static inline Variable To(T value) { return Variable(static_cast<int_type>(value)); }
+	};
+
+	// ints are accepted like in script arithmetic
+	template <typename T>
+	struct NativeValue<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		static inline T From(const Variable &value) {
+			if (value.get_type() != VariableType::Real && value.get_type() != VariableType::Int)
+			{
+				_NativeTypeError("a real", value);
+			}
+			return static_cast<T>(value.get_real());
+		}
+
+		static inline Variable To(T value) { return Variable(static_cast<real_type>(value)); }
+	};
+
+	template <>
+	struct NativeValue<string_type>
+	{
+		static inline const string_type &From(const Variable &value) {
+			if (value.get_type() != VariableType::Str)
+			{
+				_NativeTypeError("a string", value);
+			}
+			return value.get_string();
+		}
+
+		static inline Variable To(string_type value) { return Variable(std::move(value)); }
+	};
+
+	// packed arrays are accepted, boxed like by `Variable::get_list()`
+	template <>
+	struct NativeValue<list_type>
+	{
+		static inline const list_type &From(const Variable &value) {
+			if (value.get_type() != VariableType::List && value.get_type() != VariableType::IntArray &&
+					value.get_type() != VariableType::RealArray)
+			{
+				_NativeTypeError("a list", value);
+			}
+			return value.get_list();
+		}
+
+		static inline Variable To(list_type value) { return Variable(std::move(value)); }
+	};
+
+	template <>
+	struct NativeValue<table_type>
+	{
+		static inline const table_type &From(const Variable &value) {
+			if (value.get_type() != VariableType::Table)
+			{
+				_NativeTypeError("a table", value);
+			}
+			return value.get_table();
+		}
+
+		static inline Variable To(table_type value) { return Variable(std::move(value)); }
+	};
+
+	template <>
+	struct NativeValue<Variable>
+	{
+		static inline const Variable &From(const Variable &value) { return value; }
+		static inline Variable To(Variable value) { return value; }
+	};
+
+	// the result and parameters of functions, function pointers and callables
+	template <typename F>
+	struct NativeSignature : NativeSignature<decltype(&F::operator())>
+	{
+	};
+
+	template <typename R, typename... Args>
+	struct NativeSignature<R (*)(Args...)>
+	{
+		typedef R result_type;
+		typedef std::tuple<Args...> params_type;
+		static constexpr size_t param_count = sizeof...(Args);
+	};
+
+	template <typename R, typename... Args>
+	struct NativeSignature<R (*)(Args...) noexcept> : NativeSignature<R (*)(Args...)>
+	{
+	};
+
+	template <typename C, typename R, typename... Args>
+	struct NativeSignature<R (C:: *)(Args...)> : NativeSignature<R (*)(Args...)>
+	{
+	};
+
+	template <typename C, typename R, typename... Args>
+	struct NativeSignature<R (C:: *)(Args...) const> : NativeSignature<R (*)(Args...)>
+	{
+	};
+
+	template <typename C, typename R, typename... Args>
+	struct NativeSignature<R (C:: *)(Args...) noexcept> : NativeSignature<R (*)(Args...)>
+	{
+	};
+
+	template <typename C, typename R, typename... Args>
+	struct NativeSignature<R (C:: *)(Args...) const noexcept> : NativeSignature<R (*)(Args...)>
+	{
+	};
+
+	// a bound function, called by the vm with its `param_count` arguments (on the vm stack)
+	struct NativeFunction
+	{
+		string_type name;
+		size_t param_count = 0;
+		// always returns the same result for the same arguments and has no side effects,
+		// calls with constant arguments are then evaluated when compiling
+		bool pure = false;
+
+		// converts the arguments, calls the function and converts its result
+		Variable (*invoke)(void *target, const Variable *args) = nullptr;
+		// the callable of `NativeRegistry::add(name, callable)`, null for functions bound at compile time
+		std::shared_ptr<void> target;
+	};
+
+	// the natives scripts can call, see `ScriptOptions::natives`;
+	// only read while compiling, the compiled scripts keep what they call
+	class NativeRegistry
+	{
+	public:
+		// binds the function `F`, which the vm then calls directly (it can be inlined into its thunk)
+		template <auto F>
+		inline NativeRegistry &add(const string_type &name) {
+			return this->_add<decltype(F)>(name, &_InvokeStatic<F>, nullptr, false);
+		}
+
+		template <auto F>
+		inline NativeRegistry &add_pure(const string_type &name) {
+			return this->_add<decltype(F)>(name, &_InvokeStatic<F>, nullptr, true);
+		}
+
+		// binds a copy of `callable` (a lambda, a functor or a function pointer)
+		template <typename F>
+		inline NativeRegistry &add(const string_type &name, F &&callable) {
+			return this->_add_callable(name, std::forward<F>(callable), false);
+		}
+
+		template <typename F>
+		inline NativeRegistry &add_pure(const string_type &name, F &&callable) {
+			return this->_add_callable(name, std::forward<F>(callable), true);
+		}
+
+		// nullptr when there is none
+		const NativeFunction *find(const string_type &name) const;
+
+	private:
+		template <typename Signature, typename Call, size_t... Indices>
+		static inline Variable _Invoke(Call &&call, const Variable *args, std::index_sequence<Indices...>) {
+			typedef typename Signature::result_type R;
+			typedef typename Signature::params_type Params;
+
+			if constexpr (std::is_void_v<R>)
+			{
+				call(NativeValue<std::decay_t<std::tuple_element_t<Indices, Params>>>::From(args[Indices])...);
+				return Variable();
+			}
+			else
+			{
+				return NativeValue<std::decay_t<R>>::To(
+					call(NativeValue<std::decay_t<std::tuple_element_t<Indices, Params>>>::From(args[Indices])...)
+				);
+			}
+		}
+
+		template <auto F>
+		static Variable _InvokeStatic(void *, const Variable *args) {
+			typedef NativeSignature<decltype(F)> Signature;
+			return _Invoke<Signature>(F, args, std::make_index_sequence<Signature::param_count>());
+		}
+
+		template <typename Callable>
+		static Variable _InvokeCallable(void *target, const Variable *args) {
+			typedef NativeSignature<Callable> Signature;
+			return _Invoke<Signature>(*static_cast<Callable *>(target), args, std::make_index_sequence<Signature::param_count>());
+		}
+
+		template <typename F>
+		inline NativeRegistry &_add_callable(const string_type &name, F &&callable, bool pure) {
+			typedef std::decay_t<F> Callable;
+			std::shared_ptr<void> target = std::make_shared<Callable>(std::forward<F>(callable));
+			return this->_add<Callable>(name, &_InvokeCallable<Callable>, std::move(target), pure);
+		}
+
+		template <typename F>
+		inline NativeRegistry &_add(
+			const string_type &name, Variable (*invoke)(void *, const Variable *), std::shared_ptr<void> target, bool pure
+		) {
+			NativeFunction &function = m_functions[name];
+			function.name = name;
+			function.param_count = NativeSignature<F>::param_count;
+			function.pure = pure;
+			function.invoke = invoke;
+			function.target = std::move(target);
+			return *this;
+		}
+
+	private:
+		std::map<string_type, NativeFunction> m_functions;
+	};
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _CRYPT_PATH_H_
+#define _CRYPT_PATH_H_
+#include "Crypt.hpp"
+
+namespace crypt
+{
+	// a lookup into a document compiled once from an expression like `dict_val.first`,
+	// `effects[2]` or `dict_val["fourth elm"]`;
+	// each table step caches the entry it found for the table's stamp (see `Variable::get_stamp()`),
+	// so repeated lookups on an unchanged document skip the key comparisons (tables a mutable
+	// reference was taken to have no stamp and are always looked up)
+	// note: the caches make resolving mutate the path, copy it per thread instead of sharing it
+	class Path
+	{
+	public:
+		struct Segment
+		{
+			string_type key;
+			size_t index = 0;
+			// indexes a list, otherwise looks `key` up in a table
+			bool is_index = false;
+		};
+
+		Path() = default;
+		// throws std::invalid_argument on malformed expressions
+		explicit Path(const string_type &expression);
+		explicit Path(std::vector<Segment> &&segments);
+
+		// nullptr if any step is missing or has the wrong type
+		const Variable *resolve(const Variable &root) const;
+		// throws VariableAccessError if any step is missing or has the wrong type
+		const Variable &at(const Variable &root) const;
+
+		// resolves `count` paths against the same root, writing each result to `out`
+		static void ResolveMany(const Path *paths, size_t count, const Variable &root, const Variable **out);
+
+		inline const std::vector<Segment> &get_segments() const noexcept { return m_segments; }
+		string_type to_string() const;
+
+	private:
+		struct SlotCache
+		{
+			uint64_t stamp = 0;
+			const Variable *value = nullptr;
+		};
+
+		std::vector<Segment> m_segments;
+		mutable std::vector<SlotCache> m_caches;
+	};
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _CRYPT_PERSISTENT_TABLE_H_
+#define _CRYPT_PERSISTENT_TABLE_H_
+#include "Crypt.hpp"
+
+#include <memory>
+#include <iterator>
+
+namespace crypt
+{
+	struct PersistentTableNode;
+
+	// immutable `key = value` table stored as a hash array mapped trie,
+	// updates return a new version sharing every untouched node with the previous one
+	class PersistentTable
+	{
+	public:
+		typedef table_type::value_type value_type;
+
+		// iterates the entries in hash order (not sorted like `table_type`)
+		class const_iterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef PersistentTable::value_type value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const value_type *pointer;
+			typedef const value_type &reference;
+
+			inline reference operator*() const noexcept { return *m_current; }
+			inline pointer operator->() const noexcept { return m_current; }
+
+			const_iterator &operator++();
+
+			inline bool operator==(const const_iterator &other) const noexcept { return m_current == other.m_current; }
+			inline bool operator!=(const const_iterator &other) const noexcept { return m_current != other.m_current; }
+
+		private:
+			friend class PersistentTable;
+
+			// moves to the next entry, or to the end if there's none
+			void _advance();
+
+			std::vector<std::pair<const PersistentTableNode *, size_t>> m_stack;
+			const value_type *m_current = nullptr;
+		};
+
+		PersistentTable() = default;
+		explicit PersistentTable(const table_type &table);
+
+		// throws std::out_of_range if `key` is missing, like `table_type::at()`
+		const Variable &at(const string_type &key) const;
+		// nullptr if `key` is missing
+		const Variable *find(const string_type &key) const;
+		inline size_t count(const string_type &key) const { return this->find(key) != nullptr; }
+
+		inline size_t size() const noexcept { return m_size; }
+		inline bool empty() const noexcept { return m_size == 0; }
+
+		// new versions, this one is left untouched
+		PersistentTable set(const string_type &key, const Variable &value) const;
+		PersistentTable erase(const string_type &key) const;
+
+		table_type to_table() const;
+
+		const_iterator begin() const;
+		inline const_iterator end() const { return {}; }
+
+	private:
+		std::shared_ptr<const PersistentTableNode> m_root;
+		size_t m_size = 0;
+	};
+}
+
+#endif
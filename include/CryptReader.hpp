@@ -0,0 +1,67 @@
+#ifndef _CRYPT_READER_H_
+#define _CRYPT_READER_H_
+#include "Crypt.hpp"
+
+#include <memory>
+
+namespace crypt
+{
+	enum class ReadEvent : uint8_t
+	{
+		// no more events, after the document's table ended
+		End,
+
+		// a table key, see `get_key()`; the next event starts its value
+		Key,
+		// a scalar (null/bool/int/real/string), see `get_value_type()` and the getters
+		Value,
+
+		ListBegin,
+		ListEnd,
+		// the document itself is reported as a table too
+		TableBegin,
+		TableEnd,
+	};
+
+	struct ReaderState;
+
+	// pull parser reading a crypt document as a stream of events,
+	// for consumers that don't need (or want) a `Variable` tree;
+	// syntax errors throw std::runtime_error
+	class Reader
+	{
+	public:
+		// a `length` of zero reads `source` up to its null terminator,
+		// `source` must outlive the reader
+		Reader(const char_type *source, size_t length = 0);
+		~Reader();
+
+		ReadEvent next();
+		// the event the next call to `next()` will return
+		ReadEvent peek();
+
+		// skips the next value entirely, be it a scalar or a whole list/table
+		void skip_value();
+		// reads the next value entirely into a variable
+		Variable read_value();
+
+		const string_type &get_key() const;
+
+		// the last `Value` event's scalar (peeked ones included), converted the same way as `Variable`'s getters
+		VariableType get_value_type() const;
+		boolean_type get_bool() const;
+		int_type get_int() const;
+		real_type get_real() const;
+		// throws VariableAccessError if the value isn't a string
+		const string_type &get_string() const;
+
+		// position (1-based) of the last event, for error messages
+		size_t get_line() const;
+		size_t get_column() const;
+
+	private:
+		std::unique_ptr<ReaderState> m_state;
+	};
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _CRYPT_SCHEDULER_H_
+#define _CRYPT_SCHEDULER_H_
+#include "CryptScript.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace crypt
+{
+	struct ScriptResult
+	{
+		// the value of the top-level `return`
+		Variable value;
+		// the globals the run was submitted with, with the assigned ones written back
+		table_type globals;
+	};
+
+	// multiplexes script runs (see `ScriptTask`) over a fixed pool of worker threads:
+	// a run gets `quantum` instructions at a time and then goes to the back of the queue,
+	// so long running scripts share the workers with short ones instead of holding them up
+	class ScriptScheduler
+	{
+	public:
+		// zero `workers` is one per hardware thread
+		explicit ScriptScheduler(size_t workers = 0, size_t quantum = 10000);
+		// finishes the queued runs, then joins the workers
+		~ScriptScheduler();
+
+		ScriptScheduler(const ScriptScheduler &) = delete;
+		ScriptScheduler &operator=(const ScriptScheduler &) = delete;
+
+		// queues a run of `script` against `globals`,
+		// the future throws the run's ScriptError if it fails
+		std::future<ScriptResult> submit(const Script &script, table_type globals);
+
+		// runs queued or in progress
+		size_t get_pending() const;
+		inline size_t get_worker_count() const noexcept { return m_workers.size(); }
+		inline size_t get_quantum() const noexcept { return m_quantum; }
+
+	private:
+		struct Job
+		{
+			ScriptTask task;
+			std::promise<ScriptResult> promise;
+		};
+
+		void _work();
+
+	private:
+		const size_t m_quantum;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_ready;
+		std::deque<std::unique_ptr<Job>> m_queue;
+		// queued plus the ones being resumed
+		size_t m_pending = 0;
+		bool m_stopping = false;
+
+		std::vector<std::thread> m_workers;
+	};
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _CRYPT_SCHEMA_H_
+#define _CRYPT_SCHEMA_H_
+#include "Crypt.hpp"
+
+#include <memory>
+
+namespace crypt
+{
+	enum class SchemaIssueKind : uint8_t
+	{
+		UnknownKey,
+		TypeMismatch,
+	};
+
+	struct SchemaIssue
+	{
+		SchemaIssueKind kind;
+		// dotted path of the key
+		string_type path;
+		// 1-based
+		size_t line;
+		size_t column;
+	};
+
+	class SlotDocument;
+	struct SchemaLevel;
+
+	// the expected shape of a document, written in crypt itself:
+	//   name = "string"
+	//   level = "int"
+	//   dict_val = { first = "int", second = "string" }
+	// type names are "null", "bool", "int", "real", "string", "list", "table" and "any",
+	// nested tables get their keys flattened, each key of the schema having a fixed slot
+	class Schema
+	{
+	public:
+		static constexpr size_t npos = size_t(-1);
+		// the slot type of "any", matching every value (past the last `VariableType`)
+		static constexpr VariableType any_type = static_cast<VariableType>(0xFF);
+
+		// throws std::invalid_argument on unknown type names
+		static Schema Compile(const Variable &definition);
+		static Schema Compile(const char_type *source, size_t length = 0);
+
+		inline size_t slot_count() const noexcept { return m_paths.size(); }
+
+		// slot of a dotted key path (like "dict_val.first"), `npos` if the schema doesn't have it
+		size_t find_slot(const string_type &path) const;
+		inline const string_type &get_slot_path(size_t slot) const { return m_paths[slot]; }
+		// `any_type` for "any"
+		inline VariableType get_slot_type(size_t slot) const { return m_types[slot]; }
+
+		// reads a document straight into the slots, type checking the values as they're read;
+		// unknown and mistyped keys are skipped and reported in the document's issues
+		SlotDocument parse(const char_type *source, size_t length = 0) const;
+
+	private:
+		// the root table's keys
+		std::shared_ptr<const SchemaLevel> m_root;
+
+		std::vector<string_type> m_paths;
+		std::vector<VariableType> m_types;
+	};
+
+	class SlotDocument
+	{
+	public:
+		inline const Variable &operator[](size_t slot) const { return m_slots[slot]; }
+		inline Variable &operator[](size_t slot) { return m_slots[slot]; }
+
+		// whether the slot's key was in the document
+		inline bool has(size_t slot) const { return m_present[slot]; }
+		inline size_t size() const noexcept { return m_slots.size(); }
+
+		inline bool ok() const noexcept { return m_issues.empty(); }
+		inline const std::vector<SchemaIssue> &get_issues() const noexcept { return m_issues; }
+
+	private:
+		friend class Schema;
+
+		std::vector<Variable> m_slots;
+		std::vector<bool> m_present;
+		std::vector<SchemaIssue> m_issues;
+	};
+}
+
+#endif
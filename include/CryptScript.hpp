@@ -0,0 +1,225 @@
+#ifndef _CRYPT_SCRIPT_H_
+#define _CRYPT_SCRIPT_H_
+#include "Crypt.hpp"
+
+#include <memory>
+
+// the vm state of an execution context, see `crypt::ScriptContext`
+struct ExecutionState;
+// the counts of a `crypt::OpcodeProfile`
+struct OpcodeCounts;
+
+namespace crypt
+{
+	struct Program;
+	class ScriptContext;
+	class NativeRegistry;
+
+	// syntax, compile and runtime errors of scripts, with the position (1-based) they happened at
+	class ScriptError : public std::runtime_error
+	{
+	public:
+		inline ScriptError(const std::string &msg, size_t line, size_t column)
+			: std::runtime_error(msg + " (" + std::to_string(line) + ":" + std::to_string(column) + ")"),
+				m_line{line}, m_column{column} {
+		}
+
+		inline size_t get_line() const noexcept { return m_line; }
+		inline size_t get_column() const noexcept { return m_column; }
+
+	private:
+		size_t m_line;
+		size_t m_column;
+	};
+
+	struct ScriptStats
+	{
+		// bytecode instructions emitted
+		size_t instructions = 0;
+		// operations on constants (and calls of pure natives with constant arguments) evaluated at compile time
+		size_t folded_expressions = 0;
+		// `if`/`elif`/`else` arms and `while` loops dropped for constant conditions
+		size_t removed_branches = 0;
+		// reads of top-level constants replaced by their values
+		size_t propagated_constants = 0;
+		// instruction sequences turned into superinstructions, redundant load/store pairs included
+		size_t fused_sequences = 0;
+		// the bytecode was restored from `ScriptOptions::cache_dir` instead of being compiled,
+		// only `instructions` is counted then
+		bool from_cache = false;
+	};
+
+	struct ScriptOptions
+	{
+		// fold constant expressions, propagate top-level constants (globals assigned once,
+		// to a constant, outside of any branch) into the code after them and drop dead branches
+		bool optimize = true;
+		// run frequent instruction sequences (like a comparison and the branch on it, or `x += 1`)
+		// as superinstructions and skip redundant loads and stores;
+		// turned off to profile the plain instruction set, see `OpcodeProfile`
+		bool fuse = true;
+		// filled when not null
+		ScriptStats *stats = nullptr;
+		// the C++ functions the script can call (see `NativeRegistry`), only used while compiling
+		const NativeRegistry *natives = nullptr;
+		// when not empty, compiled scripts are cached here as bytecode files keyed by a hash of
+		// the source, `CRYPT_VERSION` and the options above; unchanged sources are then loaded
+		// by mapping the file instead of being compiled, files written by another build are ignored;
+		// scripts that call natives aren't cached, their code depends on the host's functions;
+		// the directory is created on demand and cache io errors never fail the compile
+		string_type cache_dir;
+	};
+
+	// a script compiled to bytecode, for example:
+	//
+	//	function clamp(value, low, high) do
+	//		if value < low then return low elif value > high then return high end
+	//		return value
+	//	end
+	//
+	//	score = clamp(base * 2 + bonus, 0, 100)
+	//	while score > 100 do score -= 10 end
+	//	return score >= 50
+	//
+	// top-level names are globals, bound to the entries of the table the script runs against;
+	// names assigned inside a function (and its parameters) are locals of that function;
+	// `entity.health` reads a table field (null when missing), assigning one modifies the table
+	// in place (copying it first when shared, tables are values like the rest);
+	// `null`, `false`, zeros and empty strings/lists/tables are falsy, `and`/`or` short-circuit
+	// and yield the deciding operand;
+	// a compiled script is an immutable module that any number of threads can share and run at
+	// once without locking (it only keeps the arithmetic it specialized to the operand types
+	// seen so far, updated lock-free), the per-run state lives in a `ScriptContext`
+	class Script
+	{
+	public:
+		Script() = default;
+
+		// throws ScriptError on syntax/compile errors
+		static Script Compile(const char_type *source, size_t length = 0);
+		static Script Compile(const char_type *source, size_t length, const ScriptOptions &options);
+
+		// runs the script with its globals read from `globals` (missing ones are null),
+		// the globals it assigns are written back; returns the value of the top-level `return`
+		// (null without one), throws ScriptError on runtime errors;
+		// runs with a context private to the calling thread, see `ScriptContext::run()`
+		Variable run(table_type &globals) const;
+		Variable run() const;
+
+		size_t get_instruction_count() const;
+		// one instruction per line, for debugging
+		string_type disassemble() const;
+
+	private:
+		// compiles without the bytecode cache
+		static Script _compile(const char_type *source, size_t length, const ScriptOptions &options);
+
+	private:
+		friend class ScriptContext;
+		friend class ScriptTask;
+
+		std::shared_ptr<const Program> m_program;
+	};
+
+	// how often each pair and triple of instructions ran one right after the other (across jumps,
+	// calls and returns too) in the runs profiled with it (see `ScriptContext::run()`), for finding
+	// the sequences of a representative workload still worth fusing into superinstructions;
+	// instructions are counted as compiled, a superinstruction counts as one
+	class OpcodeProfile
+	{
+	public:
+		struct Sequence
+		{
+			// the opcode names, in order
+			std::vector<string_type> names;
+			uint64_t count = 0;
+		};
+
+		OpcodeProfile();
+		OpcodeProfile(const OpcodeProfile &copy);
+		OpcodeProfile(OpcodeProfile &&move) noexcept;
+		OpcodeProfile &operator=(const OpcodeProfile &copy);
+		OpcodeProfile &operator=(OpcodeProfile &&move) noexcept;
+		~OpcodeProfile();
+
+		// instructions run while profiling
+		uint64_t get_executed() const noexcept;
+
+		// the `count` most frequent sequences, most frequent first
+		std::vector<Sequence> get_pairs(size_t count) const;
+		std::vector<Sequence> get_triples(size_t count) const;
+
+		// adds the counts of `other`, like another thread's profile of the same workload
+		void merge(const OpcodeProfile &other);
+		void clear();
+
+		// the `count` most frequent pairs and triples, one per line with their share of the instructions run
+		string_type report(size_t count = 16) const;
+
+	private:
+		friend class ScriptContext;
+
+		std::unique_ptr<OpcodeCounts> m_counts;
+	};
+
+	// what runs need besides the script: the vm stack, call frames and the inline caches of the
+	// scripts it ran, all kept between runs so warm runs don't allocate;
+	// a context is used by one thread at a time, typically one per worker thread
+	class ScriptContext
+	{
+	public:
+		ScriptContext();
+		ScriptContext(ScriptContext &&move) noexcept;
+		ScriptContext &operator=(ScriptContext &&move) noexcept;
+		~ScriptContext();
+
+		// see `Script::run()`
+		Variable run(const Script &script, table_type &globals);
+		// runs like the above while counting the instructions run into `profile`, several times slower
+		Variable run(const Script &script, table_type &globals, OpcodeProfile &profile);
+
+	private:
+		Variable _run(const Script &script, table_type &globals, OpcodeCounts *counts);
+
+	private:
+		std::unique_ptr<ExecutionState> m_state;
+	};
+
+	// a run of a script that hands control back after a number of instructions (its budget)
+	// and continues where it left off on the next `resume()`, a coroutine;
+	// a task can be resumed from any thread, by one thread at a time
+	class ScriptTask
+	{
+	public:
+		// `globals` are read like in `Script::run()`, the task keeps them until it finishes
+		ScriptTask(const Script &script, table_type globals);
+		ScriptTask(ScriptTask &&move) noexcept;
+		ScriptTask &operator=(ScriptTask &&move) noexcept;
+		~ScriptTask();
+
+		// runs about `budget` more instructions, returns whether the script finished;
+		// the budget is checked at jumps, calls and returns, so a straight stretch of code can overshoot it;
+		// throws ScriptError on runtime errors, the task is then finished (without a result)
+		bool resume(size_t budget);
+
+		inline bool is_finished() const noexcept { return m_finished; }
+		// instructions run so far
+		inline size_t get_executed() const noexcept { return m_executed; }
+
+		// the value of the top-level `return` once finished
+		inline const Variable &get_result() const noexcept { return m_result; }
+		// the assigned globals are written back once finished
+		inline table_type &get_globals() noexcept { return m_globals; }
+
+	private:
+		std::shared_ptr<const Program> m_program;
+		std::unique_ptr<ExecutionState> m_state;
+
+		table_type m_globals;
+		Variable m_result;
+		size_t m_executed = 0;
+		bool m_finished = false;
+	};
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _CRYPT_SERIALIZE_H_
+#define _CRYPT_SERIALIZE_H_
+#include "Crypt.hpp"
+
+namespace crypt
+{
+	// receives serialized text in chunks
+	class Sink
+	{
+	public:
+		virtual ~Sink() = default;
+		virtual void write(const char_type *data, size_t length) = 0;
+	};
+
+	// appends to a growable string
+	class StringSink : public Sink
+	{
+	public:
+		inline StringSink(string_type &out) : m_out{out} {}
+
+		inline void write(const char_type *data, size_t length) override {
+			m_out.append(data, length);
+		}
+
+	private:
+		string_type &m_out;
+	};
+
+	struct SerializeOptions
+	{
+		// indented multi-line layout, otherwise everything nested is kept on one line
+		bool pretty = false;
+		// with `pretty`, the indent of each level is `indent_width` times `indent_char`
+		char_type indent_char = '\t';
+		size_t indent_width = 1;
+		// a table at the root is written as a document (`key = value` lines without braces)
+		bool document = true;
+	};
+
+	// writes `value` as crypt text that `Load()` reads back to an equal value,
+	// except for empty tables: both empty objects are written as `{}`, which reads back as a list;
+	// throws std::domain_error for infinite/nan reals
+	void Serialize(const Variable &value, Sink &sink, const SerializeOptions &options = {});
+	void Serialize(const Variable &value, string_type &out, const SerializeOptions &options = {});
+	string_type Serialize(const Variable &value, const SerializeOptions &options = {});
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _CRYPT_SHARED_H_
+#define _CRYPT_SHARED_H_
+#include "CryptSnapshot.hpp"
+
+namespace crypt
+{
+	// a document published into POSIX shared memory as a snapshot (see `EncodeSnapshot()`),
+	// so every process on the host reads the same single copy in place;
+	// each publish writes a new generation segment (`/<name>.<generation>`) and only then
+	// advances the generation counter of `/<name>`, readers never see a partially written document,
+	// and attached readers keep their generation mapped until they refresh
+	class SharedDocument
+	{
+	public:
+		SharedDocument() = default;
+
+		// writes `document` as the next generation of `name` and returns that generation,
+		// the previous generation is unlinked (its attached readers keep their mapping);
+		// `name` must be a plain name without slashes, throws std::runtime_error on shm errors
+		static uint64_t Publish(const string_type &name, const Variable &document);
+		// maps the latest generation of `name` read-only,
+		// throws std::runtime_error if nothing was published under `name`
+		static SharedDocument Attach(const string_type &name);
+		// unlinks the counter and the latest generation, attached readers are unaffected
+		static void Remove(const string_type &name);
+
+		// latest generation published under `name`, zero if none
+		static uint64_t LatestGeneration(const string_type &name);
+
+		inline uint64_t get_generation() const noexcept { return m_generation; }
+		// a newer generation was published since this one was attached
+		inline bool is_stale() const { return LatestGeneration(m_name) != m_generation; }
+		// re-attaches if stale, returns whether the document changed
+		bool refresh();
+
+		inline const Snapshot &get_snapshot() const noexcept { return m_snapshot; }
+		inline SnapshotView root() const { return m_snapshot.root(); }
+
+	private:
+		string_type m_name;
+		uint64_t m_generation = 0;
+		Snapshot m_snapshot;
+	};
+}
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef _CRYPT_SNAPSHOT_H_
+#define _CRYPT_SNAPSHOT_H_
+#include "Crypt.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace crypt
+{
+	typedef std::basic_string_view<char_type> string_view_type;
+
+	// thrown when a snapshot's header doesn't match this build or an offset points outside of it
+	class SnapshotError : public std::runtime_error
+	{
+	public:
+		inline SnapshotError(const std::string &msg) : std::runtime_error(msg) {}
+		inline SnapshotError(const char *msg) : std::runtime_error(msg) {}
+	};
+
+	// one encoded value: scalars are stored in `payload`, everything else
+	// is an offset (from the start of the snapshot) to `count` elements/chars
+	struct SnapshotSlot
+	{
+		uint32_t type = 0; // VariableType
+		uint32_t count = 0;
+		uint64_t payload = 0;
+	};
+
+	class SnapshotList;
+	class SnapshotTable;
+
+	// read-only view of a value inside a snapshot, mirrors the getters of `Variable`
+	// without copying anything out of the snapshot; only valid while the snapshot is alive,
+	// getters throw VariableAccessError on type mismatches and SnapshotError on corrupt offsets
+	class SnapshotView
+	{
+	public:
+		SnapshotView() = default;
+		inline SnapshotView(const uint8_t *base, size_t size, const SnapshotSlot &slot)
+			: m_base{base}, m_size{size}, m_slot{slot} {
+		}
+
+		inline VariableType get_type() const noexcept { return static_cast<VariableType>(m_slot.type); }
+
+		inline bool is_null() const noexcept { return get_type() == VariableType::Null; }
+		inline bool is_list() const noexcept {
+			return get_type() == VariableType::List || get_type() == VariableType::IntArray ||
+				get_type() == VariableType::RealArray;
+		}
+
+		// convert between the scalar types (and null) like `Variable`'s getters
+		boolean_type get_bool() const;
+		int_type get_int() const;
+		real_type get_real() const;
+
+		string_view_type get_string() const;
+		// also accepts the packed arrays, yielding their numbers as int/real views
+		SnapshotList get_list() const;
+		SnapshotTable get_table() const;
+
+		Span<int_type> get_int_array() const;
+		Span<real_type> get_real_array() const;
+
+		// decodes the value (and everything under it) back into the DOM;
+		// offsets are bounds checked but not checked for cycles, only decode trusted snapshots
+		Variable to_variable() const;
+
+	private:
+		int_type _int_payload() const;
+		real_type _real_payload() const;
+
+	private:
+		const uint8_t *m_base = nullptr;
+		size_t m_size = 0;
+		SnapshotSlot m_slot;
+	};
+
+	class SnapshotList
+	{
+	public:
+		class iterator
+		{
+		public:
+			inline iterator(const SnapshotList *list, size_t index) : m_list{list}, m_index{index} {}
+
+			inline SnapshotView operator*() const { return (*m_list)[m_index]; }
+			inline iterator &operator++() noexcept { m_index++; return *this; }
+			inline bool operator==(const iterator &other) const noexcept { return m_index == other.m_index; }
+			inline bool operator!=(const iterator &other) const noexcept { return m_index != other.m_index; }
+
+		private:
+			const SnapshotList *m_list;
+			size_t m_index;
+		};
+
+		SnapshotList() = default;
+		inline SnapshotList(const uint8_t *base, size_t size, const SnapshotSlot &slot, const void *elements)
+			: m_base{base}, m_size{size}, m_type{static_cast<VariableType>(slot.type)},
+				m_count{slot.count}, m_elements{elements} {
+		}
+
+		inline size_t size() const noexcept { return m_count; }
+		inline bool empty() const noexcept { return m_count == 0; }
+
+		// unchecked like `list_type::operator[]`
+		SnapshotView operator[](size_t index) const;
+
+		inline iterator begin() const noexcept { return iterator{this, 0}; }
+		inline iterator end() const noexcept { return iterator{this, m_count}; }
+
+	private:
+		const uint8_t *m_base = nullptr;
+		size_t m_size = 0;
+		VariableType m_type = VariableType::List;
+		size_t m_count = 0;
+		const void *m_elements = nullptr;
+	};
+
+	// entries are sorted by key like `table_type`, lookups are binary searches
+	class SnapshotTable
+	{
+	public:
+		struct Entry
+		{
+			uint32_t key = 0; // index into the snapshot's key table
+			uint32_t reserved = 0;
+			SnapshotSlot value;
+		};
+
+		class iterator
+		{
+		public:
+			inline iterator(const SnapshotTable *table, size_t index) : m_table{table}, m_index{index} {}
+
+			inline string_view_type key() const { return m_table->_key(m_index); }
+			inline SnapshotView value() const { return m_table->_value(m_index); }
+
+			inline iterator &operator++() noexcept { m_index++; return *this; }
+			inline bool operator==(const iterator &other) const noexcept { return m_index == other.m_index; }
+			inline bool operator!=(const iterator &other) const noexcept { return m_index != other.m_index; }
+
+		private:
+			const SnapshotTable *m_table;
+			size_t m_index;
+		};
+
+		SnapshotTable() = default;
+		inline SnapshotTable(const uint8_t *base, size_t size, size_t count, const Entry *entries)
+			: m_base{base}, m_size{size}, m_count{count}, m_entries{entries} {
+		}
+
+		inline size_t size() const noexcept { return m_count; }
+		inline bool empty() const noexcept { return m_count == 0; }
+
+		// `end()` when missing
+		iterator find(string_view_type key) const;
+		inline size_t count(string_view_type key) const { return find(key) != end() ? 1 : 0; }
+		// throws VariableAccessError when missing
+		SnapshotView at(string_view_type key) const;
+
+		inline iterator begin() const noexcept { return iterator{this, 0}; }
+		inline iterator end() const noexcept { return iterator{this, m_count}; }
+
+	private:
+		string_view_type _key(size_t index) const;
+		inline SnapshotView _value(size_t index) const {
+			return SnapshotView{m_base, m_size, m_entries[index].value};
+		}
+
+	private:
+		const uint8_t *m_base = nullptr;
+		size_t m_size = 0;
+		size_t m_count = 0;
+		const Entry *m_entries = nullptr;
+	};
+
+	// a whole encoded document, either borrowed from a buffer or owning a file mapping;
+	// the layout is native (byte order, int/real widths), snapshots from a build
+	// that differs in these are rejected instead of converted
+	class Snapshot
+	{
+	public:
+		Snapshot() = default;
+
+		// the buffer must be 8-byte aligned and outlive the snapshot, or be owned by `owner`
+		// which is kept alive with the snapshot (and its copies);
+		// throws SnapshotError if the header is invalid
+		static Snapshot FromBuffer(const void *data, size_t size, std::shared_ptr<const void> owner = nullptr);
+		// memory maps the file, throws std::runtime_error if it can't be mapped
+		// and SnapshotError if it isn't a valid snapshot
+		static Snapshot Open(const char *path);
+
+		// null view for an empty snapshot
+		SnapshotView root() const;
+
+		inline const uint8_t *data() const noexcept { return m_data; }
+		inline size_t size() const noexcept { return m_size; }
+
+	private:
+		// keeps the memory of `m_data` alive (a file mapping, a shared memory segment...)
+		std::shared_ptr<const void> m_owner;
+		const uint8_t *m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+	// encodes `value` into a snapshot image; equal strings (keys included) are stored once
+	std::vector<uint8_t> EncodeSnapshot(const Variable &value);
+	// writes `EncodeSnapshot(value)` to `path`, throws std::runtime_error on io errors
+	void SaveSnapshot(const Variable &value, const char *path);
+}
+
+#endif
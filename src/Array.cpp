@@ -0,0 +1,212 @@
+#include "CryptArray.hpp"
+#include "Simd.hpp"
+
+#include <stdexcept>
+
+using crypt::int_type;
+using crypt::real_type;
+using crypt::Span;
+
+template <typename T>
+static inline void EnsureNotEmpty(Span<T> values) {
+	if (values.empty())
+	{
+		throw std::out_of_range("empty array");
+	}
+}
+
+template <typename T>
+static inline void EnsureSameSize(Span<T> left, Span<T> right) {
+	if (left.size != right.size)
+	{
+		throw std::invalid_argument("array sizes mismatch");
+	}
+}
+
+namespace crypt
+{
+	int_type ArraySum(Span<int_type> values) {
+		size_t i = 0;
+		int_type result = 0;
+
+#if CRYPT_SIMD_SSE2
+		if constexpr (sizeof(int_type) == sizeof(int64_t))
+		{
+			__m128i acc = _mm_setzero_si128();
+			for (; i + 2 <= values.size; i += 2)
+			{
+				acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i *)&values.data[i]));
+			}
+
+			int64_t lanes[2];
+			_mm_storeu_si128((__m128i *)lanes, acc);
+			result = static_cast<int_type>(lanes[0] + lanes[1]);
+		}
+#endif
+
+		for (; i < values.size; i++)
+		{
+			result += values.data[i];
+		}
+
+		return result;
+	}
+
+	real_type ArraySum(Span<real_type> values) {
+		size_t i = 0;
+		real_type result = 0;
+
+#if CRYPT_SIMD_SSE2
+		__m128 acc = _mm_setzero_ps();
+		for (; i + 4 <= values.size; i += 4)
+		{
+			acc = _mm_add_ps(acc, _mm_loadu_ps(&values.data[i]));
+		}
+		result = simd::HorizontalSum(acc);
+#endif
+
+		for (; i < values.size; i++)
+		{
+			result += values.data[i];
+		}
+
+		return result;
+	}
+
+	int_type ArrayMin(Span<int_type> values) {
+		EnsureNotEmpty(values);
+
+		// no 64-bit min/max before SSE4.2, left for the compiler to vectorize
+		int_type result = values.data[0];
+		for (size_t i = 1; i < values.size; i++)
+		{
+			result = values.data[i] < result ? values.data[i] : result;
+		}
+
+		return result;
+	}
+
+	real_type ArrayMin(Span<real_type> values) {
+		EnsureNotEmpty(values);
+
+		size_t i = 1;
+		real_type result = values.data[0];
+
+#if CRYPT_SIMD_SSE2
+		if (values.size >= 4)
+		{
+			__m128 acc = _mm_loadu_ps(values.data);
+			for (i = 4; i + 4 <= values.size; i += 4)
+			{
+				acc = _mm_min_ps(acc, _mm_loadu_ps(&values.data[i]));
+			}
+			result = simd::HorizontalMin(acc);
+		}
+#endif
+
+		for (; i < values.size; i++)
+		{
+			result = values.data[i] < result ? values.data[i] : result;
+		}
+
+		return result;
+	}
+
+	int_type ArrayMax(Span<int_type> values) {
+		EnsureNotEmpty(values);
+
+		int_type result = values.data[0];
+		for (size_t i = 1; i < values.size; i++)
+		{
+			result = values.data[i] > result ? values.data[i] : result;
+		}
+
+		return result;
+	}
+
+	real_type ArrayMax(Span<real_type> values) {
+		EnsureNotEmpty(values);
+
+		size_t i = 1;
+		real_type result = values.data[0];
+
+#if CRYPT_SIMD_SSE2
+		if (values.size >= 4)
+		{
+			__m128 acc = _mm_loadu_ps(values.data);
+			for (i = 4; i + 4 <= values.size; i += 4)
+			{
+				acc = _mm_max_ps(acc, _mm_loadu_ps(&values.data[i]));
+			}
+			result = simd::HorizontalMax(acc);
+		}
+#endif
+
+		for (; i < values.size; i++)
+		{
+			result = values.data[i] > result ? values.data[i] : result;
+		}
+
+		return result;
+	}
+
+	int_type ArrayDot(Span<int_type> left, Span<int_type> right) {
+		EnsureSameSize(left, right);
+
+		// no 64-bit multiply in SSE2
+		int_type result = 0;
+		for (size_t i = 0; i < left.size; i++)
+		{
+			result += left.data[i] * right.data[i];
+		}
+
+		return result;
+	}
+
+	real_type ArrayDot(Span<real_type> left, Span<real_type> right) {
+		EnsureSameSize(left, right);
+
+		size_t i = 0;
+		real_type result = 0;
+
+#if CRYPT_SIMD_SSE2
+		__m128 acc = _mm_setzero_ps();
+		for (; i + 4 <= left.size; i += 4)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&left.data[i]), _mm_loadu_ps(&right.data[i])));
+		}
+		result = simd::HorizontalSum(acc);
+#endif
+
+		for (; i < left.size; i++)
+		{
+			result += left.data[i] * right.data[i];
+		}
+
+		return result;
+	}
+
+	void ArrayScale(Span<int_type> values, int_type factor, int_type *out) {
+		for (size_t i = 0; i < values.size; i++)
+		{
+			out[i] = values.data[i] * factor;
+		}
+	}
+
+	void ArrayScale(Span<real_type> values, real_type factor, real_type *out) {
+		size_t i = 0;
+
+#if CRYPT_SIMD_SSE2
+		const __m128 factor4 = _mm_set1_ps(factor);
+		for (; i + 4 <= values.size; i += 4)
+		{
+			_mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&values.data[i]), factor4));
+		}
+#endif
+
+		for (; i < values.size; i++)
+		{
+			out[i] = values.data[i] * factor;
+		}
+	}
+}
@@ -0,0 +1,913 @@
+#include "CryptBatch.hpp"
+#include "Operators.hpp"
+#include "Optimizer.hpp"
+#include "Simd.hpp"
+
+#include <string.h>
+#include <algorithm>
+#include <bitset>
+
+using crypt::BatchColumn;
+using crypt::ScriptError;
+using crypt::Variable;
+using crypt::VariableType;
+using crypt::boolean_type;
+using crypt::int_type;
+using crypt::real_type;
+
+// records evaluated at a time, small enough for the buffers of a chunk to stay in the cache
+static constexpr size_t BatchChunk = 1024;
+static constexpr size_t BatchChunkWords = BatchChunk / 64;
+
+enum class BatchNodeKind : uint8_t
+{
+	Column,
+	Constant,
+	Unary,
+	Binary,
+	And,
+	Or,
+};
+
+// one operation of a batch expression, nodes come after their operands
+struct BatchNode
+{
+	BatchNodeKind kind = BatchNodeKind::Constant;
+	// of `Unary` and `Binary` nodes
+	OpCode op = OpCode::Nop;
+	// node indices, `left` is the operand of unary nodes
+	uint32_t left = 0;
+	uint32_t right = 0;
+	// index into `BatchProgram::columns`
+	uint32_t column = 0;
+	Variable constant;
+	TextPosition pos = {};
+};
+
+struct BatchProgram
+{
+	// the last node is the whole expression
+	std::vector<BatchNode> nodes;
+	std::vector<CryptString> columns;
+};
+
+static void CompileNode(const Symbol &symbol, BatchProgram &program);
+
+[[noreturn]] static inline void Fail(const std::string &msg, const TextPosition &pos) {
+	throw ScriptError(msg, pos.line + 1, pos.column + 1);
+}
+
+static inline const char *TypeName(VariableType type) {
+	switch (type)
+	{
+	case VariableType::Bool:
+		return "bool";
+	case VariableType::Int:
+		return "int";
+	default:
+		return "real";
+	}
+}
+
+// `count` bits from bools stored one per byte
+static void PackBools(const boolean_type *values, size_t count, uint64_t *out);
+
+// integer `Add` through `BitOr`, throws std::domain_error on division by zero
+static void IntArithmetic(OpCode op, const int_type *left, const int_type *right, size_t count, int_type *out);
+// real `Add` through `Div`
+static void RealArithmetic(OpCode op, const real_type *left, const real_type *right, size_t count, real_type *out);
+// `Equal` through `GreaterEqual` into bits
+static void CompareInts(OpCode op, const int_type *left, const int_type *right, size_t count, uint64_t *out);
+static void CompareReals(OpCode op, const real_type *left, const real_type *right, size_t count, uint64_t *out);
+// bits of the non-zero ints/reals
+static void Truthy(VariableType type, const void *values, size_t count, uint64_t *out);
+
+namespace crypt
+{
+	size_t Selection::count() const noexcept {
+		size_t selected = 0;
+		for (const uint64_t word : m_words)
+		{
+			selected += std::bitset<64>(word).count();
+		}
+
+		return selected;
+	}
+
+	BatchExpression BatchExpression::Compile(const char_type *source, size_t length) {
+		// parsed as the script `return <expression>`, which also gets it constant folded
+		std::vector<Token> tokens{};
+		tokens.push_back(Token{TokenType::KW_Return, "return", 6, {}});
+		try
+		{
+			Token::Parse(source, length, tokens);
+		}
+		catch (const TokenError &error)
+		{
+			Fail(error.what(), error.pos);
+		}
+
+		Symbol root = Symbol::Parse(tokens.data(), tokens.size());
+		if (root.children.size() != 1 || root.children[0].children.empty())
+		{
+			const TextPosition pos = root.children.size() > 1 ? root.children[1].pos : TextPosition{};
+			Fail("expected a single expression", pos);
+		}
+
+		ScriptStats stats{};
+		OptimizeScript(root, stats, nullptr);
+
+		auto program = std::make_shared<BatchProgram>();
+		CompileNode(root.children[0].children[0], *program);
+
+		BatchExpression expression{};
+		expression.m_program = std::move(program);
+		return expression;
+	}
+
+	const std::vector<string_type> &BatchExpression::get_columns() const {
+		static const std::vector<string_type> none{};
+		return m_program ? m_program->columns : none;
+	}
+
+	Selection BatchExpression::select(const batch_columns_type &columns, size_t count) const {
+		Selection selection{};
+		this->select(columns, count, selection);
+		return selection;
+	}
+
+	void BatchExpression::select(const batch_columns_type &columns, size_t count, Selection &out) const {
+		out.m_size = count;
+		out.m_words.assign((count + 63) / 64, 0);
+
+		if (!m_program || count == 0)
+		{
+			return;
+		}
+
+		const std::vector<BatchNode> &nodes = m_program->nodes;
+
+		std::vector<const BatchColumn *> bound{};
+		for (const CryptString &name : m_program->columns)
+		{
+			const auto found = columns.find(name);
+			if (found == columns.end())
+			{
+				const auto reader = std::find_if(nodes.begin(), nodes.end(), [&](const BatchNode &node) {
+					return node.kind == BatchNodeKind::Column && m_program->columns[node.column] == name;
+				});
+				Fail("unknown column '" + name + "'", reader->pos);
+			}
+
+			if (found->second.size() < count)
+			{
+				throw std::invalid_argument("batch column '" + name + "' holds fewer values than the batch");
+			}
+
+			bound.push_back(&found->second);
+		}
+
+		// the type of each node and where its values go: `words` words of the arena at `offset`,
+		// plus as many again for each operand converted to another type
+		struct Plan
+		{
+			VariableType type;
+			VariableType operands;
+			size_t offset;
+			size_t words;
+		};
+
+		const auto words_of = [](VariableType type) {
+			switch (type)
+			{
+			case VariableType::Int:
+				return (BatchChunk * sizeof(int_type) + 7) / 8;
+			case VariableType::Real:
+				return (BatchChunk * sizeof(real_type) + 7) / 8;
+			default:
+				return BatchChunkWords;
+			}
+		};
+
+		std::vector<Plan> plans(nodes.size());
+		size_t arena_words = 0;
+
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			const BatchNode &node = nodes[i];
+			Plan &plan = plans[i];
+
+			VariableType left = VariableType::Null;
+			VariableType right = VariableType::Null;
+			if (node.kind != BatchNodeKind::Column && node.kind != BatchNodeKind::Constant)
+			{
+				left = plans[node.left].type;
+				right = node.kind == BatchNodeKind::Unary ? left : plans[node.right].type;
+			}
+
+			const bool numbers = left != VariableType::Bool && right != VariableType::Bool;
+			const bool ints = left == VariableType::Int && right == VariableType::Int;
+
+			switch (node.kind)
+			{
+			case BatchNodeKind::Column:
+				plan.type = bound[node.column]->get_type();
+				plan.operands = plan.type;
+				break;
+			case BatchNodeKind::Constant:
+				plan.type = node.constant.get_type();
+				plan.operands = plan.type;
+				break;
+			case BatchNodeKind::And:
+			case BatchNodeKind::Or:
+				plan.type = VariableType::Bool;
+				plan.operands = VariableType::Bool;
+				break;
+			case BatchNodeKind::Unary:
+				if (node.op == OpCode::Not)
+				{
+					plan.type = VariableType::Bool;
+				}
+				else if ((node.op == OpCode::Negate && numbers) || (node.op == OpCode::BitNot && ints))
+				{
+					plan.type = left;
+				}
+				else
+				{
+					Fail(std::string("unsupported operand type for ") + GetOpCodeName(node.op) + ": " + TypeName(left), node.pos);
+				}
+
+				plan.operands = plan.type == VariableType::Bool ? VariableType::Bool : left;
+				break;
+			case BatchNodeKind::Binary:
+				if (ints && node.op <= OpCode::BitOr)
+				{
+					plan.type = VariableType::Int;
+					plan.operands = VariableType::Int;
+				}
+				else if (numbers && node.op <= OpCode::Div)
+				{
+					plan.type = VariableType::Real;
+					plan.operands = VariableType::Real;
+				}
+				else if (numbers && node.op >= OpCode::Equal)
+				{
+					plan.type = VariableType::Bool;
+					plan.operands = ints ? VariableType::Int : VariableType::Real;
+				}
+				else if (node.op == OpCode::Equal || node.op == OpCode::NotEqual)
+				{
+					// bools only equal bools, a bool and a number are never equal
+					plan.type = VariableType::Bool;
+					plan.operands = left == right ? VariableType::Bool : VariableType::Null;
+				}
+				else
+				{
+					Fail(
+						std::string("unsupported operand types for ") + GetOpCodeName(node.op) + ": " +
+						TypeName(left) + " and " + TypeName(right),
+						node.pos
+					);
+				}
+				break;
+			}
+
+			plan.offset = arena_words;
+			plan.words = words_of(plan.type);
+			arena_words += plan.words;
+
+			// scratch for operands of another type
+			if (left != VariableType::Null && left != plan.operands && plan.operands != VariableType::Null)
+			{
+				arena_words += words_of(plan.operands);
+			}
+
+			if (right != VariableType::Null && right != plan.operands && plan.operands != VariableType::Null)
+			{
+				arena_words += words_of(plan.operands);
+			}
+		}
+
+		// the truthiness of an expression that isn't a bool
+		const size_t truthy_offset = arena_words;
+		arena_words += BatchChunkWords;
+
+		std::vector<uint64_t> arena(arena_words, 0);
+		// where the values of each node are for the current chunk
+		std::vector<const void *> values(nodes.size(), nullptr);
+
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (nodes[i].kind != BatchNodeKind::Constant)
+			{
+				continue;
+			}
+
+			uint64_t *storage = arena.data() + plans[i].offset;
+			switch (plans[i].type)
+			{
+			case VariableType::Int:
+				std::fill_n(reinterpret_cast<int_type *>(storage), BatchChunk, nodes[i].constant.get_int());
+				break;
+			case VariableType::Real:
+				std::fill_n(reinterpret_cast<real_type *>(storage), BatchChunk, nodes[i].constant.get_real());
+				break;
+			default:
+				std::fill_n(storage, BatchChunkWords, nodes[i].constant.get_bool() ? ~uint64_t(0) : 0);
+				break;
+			}
+
+			values[i] = storage;
+		}
+
+		size_t current = 0;
+		try
+		{
+			for (size_t begin = 0; begin < count; begin += BatchChunk)
+			{
+				const size_t rows = std::min(BatchChunk, count - begin);
+				const size_t words = (rows + 63) / 64;
+
+				for (current = 0; current < nodes.size(); current++)
+				{
+					const BatchNode &node = nodes[current];
+					const Plan &plan = plans[current];
+					uint64_t *storage = arena.data() + plan.offset;
+					uint64_t *scratch = storage + plan.words;
+
+					// the values of `operand` as `type`, converted into the scratch when needed
+					const auto operand = [&](uint32_t index, VariableType type) -> const void * {
+						const VariableType from = plans[index].type;
+						if (from == type)
+						{
+							return values[index];
+						}
+
+						uint64_t *into = scratch;
+						scratch += words_of(type);
+
+						if (type == VariableType::Real)
+						{
+							const int_type *ints = static_cast<const int_type *>(values[index]);
+							real_type *reals = reinterpret_cast<real_type *>(into);
+							for (size_t r = 0; r < rows; r++)
+							{
+								reals[r] = static_cast<real_type>(ints[r]);
+							}
+						}
+						else
+						{
+							Truthy(from, values[index], rows, into);
+						}
+
+						return into;
+					};
+
+					switch (node.kind)
+					{
+					case BatchNodeKind::Column:
+						{
+							const BatchColumn &column = *bound[node.column];
+							switch (plan.type)
+							{
+							case VariableType::Int:
+								values[current] = static_cast<const int_type *>(column.data()) + begin;
+								break;
+							case VariableType::Real:
+								values[current] = static_cast<const real_type *>(column.data()) + begin;
+								break;
+							default:
+								PackBools(static_cast<const boolean_type *>(column.data()) + begin, rows, storage);
+								values[current] = storage;
+								break;
+							}
+						}
+						break;
+					case BatchNodeKind::Constant:
+						break;
+					case BatchNodeKind::And:
+					case BatchNodeKind::Or:
+						{
+							const uint64_t *left = static_cast<const uint64_t *>(operand(node.left, VariableType::Bool));
+							const uint64_t *right = static_cast<const uint64_t *>(operand(node.right, VariableType::Bool));
+							for (size_t w = 0; w < words; w++)
+							{
+								storage[w] = node.kind == BatchNodeKind::And ? left[w] & right[w] : left[w] | right[w];
+							}
+
+							values[current] = storage;
+						}
+						break;
+					case BatchNodeKind::Unary:
+						{
+							const void *value = operand(node.left, plan.operands);
+							if (plan.type == VariableType::Bool)
+							{
+								const uint64_t *bits = static_cast<const uint64_t *>(value);
+								for (size_t w = 0; w < words; w++)
+								{
+									storage[w] = ~bits[w];
+								}
+							}
+							else if (plan.type == VariableType::Int)
+							{
+								const int_type *ints = static_cast<const int_type *>(value);
+								int_type *result = reinterpret_cast<int_type *>(storage);
+								for (size_t r = 0; r < rows; r++)
+								{
+									result[r] = node.op == OpCode::Negate ? WrapSub(0, ints[r]) : ~ints[r];
+								}
+							}
+							else
+							{
+								const real_type *reals = static_cast<const real_type *>(value);
+								real_type *result = reinterpret_cast<real_type *>(storage);
+								for (size_t r = 0; r < rows; r++)
+								{
+									result[r] = -reals[r];
+								}
+							}
+
+							values[current] = storage;
+						}
+						break;
+					case BatchNodeKind::Binary:
+						if (plan.operands == VariableType::Null)
+						{
+							// a bool against a number
+							std::fill_n(storage, words, node.op == OpCode::NotEqual ? ~uint64_t(0) : 0);
+						}
+						else if (plan.operands == VariableType::Bool)
+						{
+							const uint64_t *left = static_cast<const uint64_t *>(values[node.left]);
+							const uint64_t *right = static_cast<const uint64_t *>(values[node.right]);
+							for (size_t w = 0; w < words; w++)
+							{
+								storage[w] = node.op == OpCode::Equal ? ~(left[w] ^ right[w]) : left[w] ^ right[w];
+							}
+						}
+						else if (plan.operands == VariableType::Int)
+						{
+							const int_type *left = static_cast<const int_type *>(values[node.left]);
+							const int_type *right = static_cast<const int_type *>(values[node.right]);
+							if (plan.type == VariableType::Int)
+							{
+								IntArithmetic(node.op, left, right, rows, reinterpret_cast<int_type *>(storage));
+							}
+							else
+							{
+								CompareInts(node.op, left, right, rows, storage);
+							}
+						}
+						else
+						{
+							const real_type *left = static_cast<const real_type *>(operand(node.left, VariableType::Real));
+							const real_type *right = static_cast<const real_type *>(operand(node.right, VariableType::Real));
+							if (plan.type == VariableType::Real)
+							{
+								RealArithmetic(node.op, left, right, rows, reinterpret_cast<real_type *>(storage));
+							}
+							else
+							{
+								CompareReals(node.op, left, right, rows, storage);
+							}
+						}
+
+						values[current] = storage;
+						break;
+					}
+				}
+
+				// the whole expression, as the chunk's words of the selection
+				const size_t last = nodes.size() - 1;
+				uint64_t *truthy = arena.data() + truthy_offset;
+				const uint64_t *selected = static_cast<const uint64_t *>(values[last]);
+
+				if (plans[last].type != VariableType::Bool)
+				{
+					Truthy(plans[last].type, values[last], rows, truthy);
+					selected = truthy;
+				}
+
+				memcpy(out.m_words.data() + begin / 64, selected, words * sizeof(uint64_t));
+			}
+		}
+		catch (const std::domain_error &error)
+		{
+			Fail(error.what(), nodes[current].pos);
+		}
+
+		// the bits past the last record
+		if (count % 64 != 0)
+		{
+			out.m_words.back() &= (uint64_t(1) << (count % 64)) - 1;
+		}
+	}
+}
+
+void CompileNode(const Symbol &symbol, BatchProgram &program) {
+	BatchNode node{};
+	node.pos = symbol.pos;
+
+	switch (symbol.type)
+	{
+	case SymbolType::Identifier:
+		{
+			node.kind = BatchNodeKind::Column;
+
+			const auto found = std::find(program.columns.begin(), program.columns.end(), symbol.name);
+			node.column = static_cast<uint32_t>(found - program.columns.begin());
+			if (found == program.columns.end())
+			{
+				program.columns.push_back(symbol.name);
+			}
+		}
+		break;
+	case SymbolType::Value:
+		node.kind = BatchNodeKind::Constant;
+		node.constant = symbol.value;
+
+		if (node.constant.get_type() != VariableType::Int && node.constant.get_type() != VariableType::Real &&
+				node.constant.get_type() != VariableType::Bool)
+		{
+			Fail("batch expressions only support int, real and bool values", symbol.pos);
+		}
+		break;
+	case SymbolType::Unary:
+		CompileNode(symbol.children[0], program);
+		node.kind = BatchNodeKind::Unary;
+		node.op = UnaryOpCode(symbol.op);
+		node.left = static_cast<uint32_t>(program.nodes.size() - 1);
+		break;
+	case SymbolType::Binary:
+		CompileNode(symbol.children[0], program);
+		node.left = static_cast<uint32_t>(program.nodes.size() - 1);
+		CompileNode(symbol.children[1], program);
+		node.right = static_cast<uint32_t>(program.nodes.size() - 1);
+
+		if (symbol.op == TokenType::AndOp || symbol.op == TokenType::OrOp)
+		{
+			node.kind = symbol.op == TokenType::AndOp ? BatchNodeKind::And : BatchNodeKind::Or;
+		}
+		else
+		{
+			node.kind = BatchNodeKind::Binary;
+			node.op = BinaryOpCode(symbol.op);
+		}
+		break;
+	case SymbolType::Field:
+		Fail("batch expressions don't support fields", symbol.pos);
+	case SymbolType::Call:
+		Fail("batch expressions don't support calls", symbol.pos);
+	default:
+		Fail("expected an expression", symbol.pos);
+	}
+
+	program.nodes.push_back(std::move(node));
+}
+
+void PackBools(const boolean_type *values, size_t count, uint64_t *out) {
+	for (size_t word = 0; word * 64 < count; word++)
+	{
+		const size_t base = word * 64;
+		const size_t rows = std::min<size_t>(64, count - base);
+		uint64_t bits = 0;
+		size_t i = 0;
+
+#if CRYPT_SIMD_SSE2
+		if constexpr (sizeof(boolean_type) == 1)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= rows; i += 16)
+			{
+				const __m128i bytes = _mm_loadu_si128((const __m128i *)&values[base + i]);
+				const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)) ^ 0xFFFF;
+				bits |= uint64_t(mask) << i;
+			}
+		}
+#endif
+
+		for (; i < rows; i++)
+		{
+			bits |= uint64_t(values[base + i] ? 1 : 0) << i;
+		}
+
+		out[word] = bits;
+	}
+}
+
+void IntArithmetic(OpCode op, const int_type *left, const int_type *right, size_t count, int_type *out) {
+	// plain loops, which compilers vectorize on their own
+	switch (op)
+	{
+	case OpCode::Add:
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = WrapAdd(left[i], right[i]);
+		}
+		break;
+	case OpCode::Sub:
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = WrapSub(left[i], right[i]);
+		}
+		break;
+	case OpCode::Mul:
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = WrapMul(left[i], right[i]);
+		}
+		break;
+	case OpCode::Div:
+		for (size_t i = 0; i < count; i++)
+		{
+			if (right[i] == 0)
+			{
+				throw std::domain_error("int division by zero");
+			}
+
+			// the one overflowing division wraps like the other ops
+			out[i] = right[i] == -1 ? WrapSub(0, left[i]) : left[i] / right[i];
+		}
+		break;
+	case OpCode::BitAnd:
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = left[i] & right[i];
+		}
+		break;
+	default:
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = left[i] | right[i];
+		}
+		break;
+	}
+}
+
+template <OpCode Op>
+static void RealArithmetic(const real_type *left, const real_type *right, size_t count, real_type *out) {
+	size_t i = 0;
+
+#if CRYPT_SIMD_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 l = _mm_loadu_ps(&left[i]);
+		const __m128 r = _mm_loadu_ps(&right[i]);
+
+		if constexpr (Op == OpCode::Add)
+		{
+			_mm_storeu_ps(&out[i], _mm_add_ps(l, r));
+		}
+		else if constexpr (Op == OpCode::Sub)
+		{
+			_mm_storeu_ps(&out[i], _mm_sub_ps(l, r));
+		}
+		else if constexpr (Op == OpCode::Mul)
+		{
+			_mm_storeu_ps(&out[i], _mm_mul_ps(l, r));
+		}
+		else
+		{
+			_mm_storeu_ps(&out[i], _mm_div_ps(l, r));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		if constexpr (Op == OpCode::Add)
+		{
+			out[i] = left[i] + right[i];
+		}
+		else if constexpr (Op == OpCode::Sub)
+		{
+			out[i] = left[i] - right[i];
+		}
+		else if constexpr (Op == OpCode::Mul)
+		{
+			out[i] = left[i] * right[i];
+		}
+		else
+		{
+			out[i] = left[i] / right[i];
+		}
+	}
+}
+
+void RealArithmetic(OpCode op, const real_type *left, const real_type *right, size_t count, real_type *out) {
+	switch (op)
+	{
+	case OpCode::Add:
+		return RealArithmetic<OpCode::Add>(left, right, count, out);
+	case OpCode::Sub:
+		return RealArithmetic<OpCode::Sub>(left, right, count, out);
+	case OpCode::Mul:
+		return RealArithmetic<OpCode::Mul>(left, right, count, out);
+	default:
+		return RealArithmetic<OpCode::Div>(left, right, count, out);
+	}
+}
+
+template <OpCode Op, typename T>
+static inline bool Holds(T left, T right) {
+	if constexpr (Op == OpCode::Equal)
+	{
+		return left == right;
+	}
+	else if constexpr (Op == OpCode::NotEqual)
+	{
+		return left != right;
+	}
+	else if constexpr (Op == OpCode::Less)
+	{
+		return left < right;
+	}
+	else if constexpr (Op == OpCode::LessEqual)
+	{
+		return left <= right;
+	}
+	else if constexpr (Op == OpCode::Greater)
+	{
+		return left > right;
+	}
+	else
+	{
+		return left >= right;
+	}
+}
+
+#if CRYPT_SIMD_SSE2
+// the comparison of 4 real lanes as a 4-bit mask
+template <OpCode Op>
+static inline int CompareLanes(__m128 left, __m128 right) {
+	if constexpr (Op == OpCode::Equal)
+	{
+		return _mm_movemask_ps(_mm_cmpeq_ps(left, right));
+	}
+	else if constexpr (Op == OpCode::NotEqual)
+	{
+		return _mm_movemask_ps(_mm_cmpneq_ps(left, right));
+	}
+	else if constexpr (Op == OpCode::Less)
+	{
+		return _mm_movemask_ps(_mm_cmplt_ps(left, right));
+	}
+	else if constexpr (Op == OpCode::LessEqual)
+	{
+		return _mm_movemask_ps(_mm_cmple_ps(left, right));
+	}
+	else if constexpr (Op == OpCode::Greater)
+	{
+		return _mm_movemask_ps(_mm_cmpgt_ps(left, right));
+	}
+	else
+	{
+		return _mm_movemask_ps(_mm_cmpge_ps(left, right));
+	}
+}
+
+// SSE2 has no 64-bit compares: the high halves decide unless they are equal,
+// then the low halves compared as unsigned do
+static inline __m128i GreaterInt64(__m128i left, __m128i right) {
+	const __m128i flip = _mm_set_epi32(0, INT32_MIN, 0, INT32_MIN);
+	left = _mm_xor_si128(left, flip);
+	right = _mm_xor_si128(right, flip);
+
+	const __m128i greater = _mm_cmpgt_epi32(left, right);
+	const __m128i equal = _mm_cmpeq_epi32(left, right);
+
+	const __m128i high_greater = _mm_shuffle_epi32(greater, _MM_SHUFFLE(3, 3, 1, 1));
+	const __m128i low_greater = _mm_shuffle_epi32(greater, _MM_SHUFFLE(2, 2, 0, 0));
+	const __m128i high_equal = _mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1));
+	return _mm_or_si128(high_greater, _mm_and_si128(high_equal, low_greater));
+}
+
+static inline __m128i EqualInt64(__m128i left, __m128i right) {
+	const __m128i equal = _mm_cmpeq_epi32(left, right);
+	return _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+// the comparison of 2 int lanes as a 2-bit mask
+template <OpCode Op>
+static inline int CompareLanes(__m128i left, __m128i right) {
+	const auto mask = [](__m128i lanes) { return _mm_movemask_pd(_mm_castsi128_pd(lanes)); };
+
+	if constexpr (Op == OpCode::Equal)
+	{
+		return mask(EqualInt64(left, right));
+	}
+	else if constexpr (Op == OpCode::NotEqual)
+	{
+		return mask(EqualInt64(left, right)) ^ 3;
+	}
+	else if constexpr (Op == OpCode::Less)
+	{
+		return mask(GreaterInt64(right, left));
+	}
+	else if constexpr (Op == OpCode::LessEqual)
+	{
+		return mask(GreaterInt64(left, right)) ^ 3;
+	}
+	else if constexpr (Op == OpCode::Greater)
+	{
+		return mask(GreaterInt64(left, right));
+	}
+	else
+	{
+		return mask(GreaterInt64(right, left)) ^ 3;
+	}
+}
+#endif
+
+template <OpCode Op>
+static void CompareReals(const real_type *left, const real_type *right, size_t count, uint64_t *out) {
+	for (size_t word = 0; word * 64 < count; word++)
+	{
+		const size_t base = word * 64;
+		const size_t rows = std::min<size_t>(64, count - base);
+		uint64_t bits = 0;
+		size_t i = 0;
+
+#if CRYPT_SIMD_SSE2
+		for (; i + 4 <= rows; i += 4)
+		{
+			const int mask = CompareLanes<Op>(_mm_loadu_ps(&left[base + i]), _mm_loadu_ps(&right[base + i]));
+			bits |= uint64_t(mask) << i;
+		}
+#endif
+
+		for (; i < rows; i++)
+		{
+			bits |= uint64_t(Holds<Op>(left[base + i], right[base + i])) << i;
+		}
+
+		out[word] = bits;
+	}
+}
+
+template <OpCode Op>
+static void CompareInts(const int_type *left, const int_type *right, size_t count, uint64_t *out) {
+	for (size_t word = 0; word * 64 < count; word++)
+	{
+		const size_t base = word * 64;
+		const size_t rows = std::min<size_t>(64, count - base);
+		uint64_t bits = 0;
+		size_t i = 0;
+
+#if CRYPT_SIMD_SSE2
+		if constexpr (sizeof(int_type) == sizeof(int64_t))
+		{
+			for (; i + 2 <= rows; i += 2)
+			{
+				const int mask = CompareLanes<Op>(
+					_mm_loadu_si128((const __m128i *)&left[base + i]), _mm_loadu_si128((const __m128i *)&right[base + i])
+				);
+				bits |= uint64_t(mask) << i;
+			}
+		}
+#endif
+
+		for (; i < rows; i++)
+		{
+			bits |= uint64_t(Holds<Op>(left[base + i], right[base + i])) << i;
+		}
+
+		out[word] = bits;
+	}
+}
+
+#define BATCH_COMPARE(kernel) \
+	switch (op) \
+	{ \
+	case OpCode::Equal: return kernel<OpCode::Equal>(left, right, count, out); \
+	case OpCode::NotEqual: return kernel<OpCode::NotEqual>(left, right, count, out); \
+	case OpCode::Less: return kernel<OpCode::Less>(left, right, count, out); \
+	case OpCode::LessEqual: return kernel<OpCode::LessEqual>(left, right, count, out); \
+	case OpCode::Greater: return kernel<OpCode::Greater>(left, right, count, out); \
+	default: return kernel<OpCode::GreaterEqual>(left, right, count, out); \
+	}
+
+void CompareInts(OpCode op, const int_type *left, const int_type *right, size_t count, uint64_t *out) {
+	BATCH_COMPARE(CompareInts)
+}
+
+void CompareReals(OpCode op, const real_type *left, const real_type *right, size_t count, uint64_t *out) {
+	BATCH_COMPARE(CompareReals)
+}
+
+#undef BATCH_COMPARE
+
+void Truthy(VariableType type, const void *values, size_t count, uint64_t *out) {
+	static const int_type int_zeros[BatchChunk] = {};
+	static const real_type real_zeros[BatchChunk] = {};
+
+	if (type == VariableType::Int)
+	{
+		CompareInts(OpCode::NotEqual, static_cast<const int_type *>(values), int_zeros, count, out);
+	}
+	else
+	{
+		CompareReals(OpCode::NotEqual, static_cast<const real_type *>(values), real_zeros, count, out);
+	}
+}
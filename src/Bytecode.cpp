@@ -0,0 +1,98 @@
+#include "Bytecode.hpp"
+
+static constexpr const char *OpCodeNames[] = {
+	"Nop",
+
+	"PushConst",
+	"PushNull",
+	"PushTrue",
+	"PushFalse",
+	"PushInt",
+	"Pop",
+
+	"LoadGlobal",
+	"StoreGlobal",
+	"LoadLocal",
+	"StoreLocal",
+
+	"GetField",
+	"StoreField",
+
+	"Add",
+	"Sub",
+	"Mul",
+	"Div",
+	"BitAnd",
+	"BitOr",
+
+	"Equal",
+	"NotEqual",
+	"Less",
+	"LessEqual",
+	"Greater",
+	"GreaterEqual",
+
+	"Negate",
+	"Not",
+	"BitNot",
+
+	"Jump",
+	"JumpIfFalse",
+	"JumpIfFalseOrPop",
+	"JumpIfTrueOrPop",
+
+	"Call",
+	"CallNative",
+	"Return",
+	"ReturnNull",
+
+	"LoadLocal2",
+	"StoreLocalKeep",
+	"StoreGlobalKeep",
+	"AddImmediate",
+	"SubImmediate",
+	"EqualJumpIfFalse",
+	"NotEqualJumpIfFalse",
+	"LessJumpIfFalse",
+	"LessEqualJumpIfFalse",
+	"GreaterJumpIfFalse",
+	"GreaterEqualJumpIfFalse",
+	"IncrementLocal",
+	"DecrementLocal",
+	"IncrementGlobal",
+	"DecrementGlobal",
+
+	"AddInt",
+	"AddReal",
+	"AddString",
+	"AddGeneric",
+	"SubInt",
+	"SubReal",
+	"SubGeneric",
+	"MulInt",
+	"MulReal",
+	"MulGeneric",
+	"DivInt",
+	"DivReal",
+	"DivGeneric",
+
+	"LessInt",
+	"LessReal",
+	"LessGeneric",
+	"LessEqualInt",
+	"LessEqualReal",
+	"LessEqualGeneric",
+	"GreaterInt",
+	"GreaterReal",
+	"GreaterGeneric",
+	"GreaterEqualInt",
+	"GreaterEqualReal",
+	"GreaterEqualGeneric",
+};
+
+static_assert(std::size(OpCodeNames) == static_cast<size_t>(OpCode::_Count), "every opcode needs a name");
+
+const char *GetOpCodeName(OpCode op) {
+	const size_t index = static_cast<size_t>(op);
+	return index < std::size(OpCodeNames) ? OpCodeNames[index] : "?";
+}
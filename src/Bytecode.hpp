@@ -0,0 +1,235 @@
+#pragma once
+#include "Common.hpp"
+#include "CryptNative.hpp"
+#include "Tokenizer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// each instruction is a 32-bit word: the opcode in the low byte, an operand in the upper 24 bits
+enum class OpCode : uint8_t
+{
+	Nop,
+
+	PushConst, // constants[operand]
+	PushNull,
+	PushTrue,
+	PushFalse,
+	PushInt, // the operand as a signed 24-bit int
+	Pop,
+
+	LoadGlobal, // globals[operand]
+	StoreGlobal, // pops into globals[operand]
+	LoadLocal, // the current frame's locals[operand]
+	StoreLocal,
+
+	// replaces the table on top of the stack with its field field_keys[operand] (null when missing)
+	GetField,
+	// pops into the field path field_targets[operand]
+	StoreField,
+
+	// binary ops pop the right then the left operand and push the result
+	Add,
+	Sub,
+	Mul,
+	Div,
+	BitAnd,
+	BitOr,
+
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+
+	// unary ops replace the top of the stack
+	Negate,
+	Not,
+	BitNot,
+
+	Jump, // to operand
+	JumpIfFalse, // pops the condition
+	// `and`/`or`: jumps keeping the deciding value on the stack, pops it otherwise
+	JumpIfFalseOrPop,
+	JumpIfTrueOrPop,
+
+	Call, // functions[operand], the arguments are on the stack
+	CallNative, // natives[operand], replaces the arguments with the result
+	Return, // pops the return value
+	ReturnNull,
+
+	// superinstructions, never emitted by the compiler: the peephole pass (see `FuseInstructions()`)
+	// rewrites the first instruction of a frequent sequence into one, which then runs the whole
+	// sequence in a single dispatch; the rest of the sequence stays in place (and is skipped),
+	// so jumps into its middle and the positions of its instructions keep working
+	LoadLocal2, // LoadLocal, LoadLocal
+	StoreLocalKeep, // StoreLocal x, LoadLocal x
+	StoreGlobalKeep, // StoreGlobal x, LoadGlobal x
+	AddImmediate, // PushInt, Add
+	SubImmediate, // PushInt, Sub
+	// `Equal` through `GreaterEqual`, JumpIfFalse
+	EqualJumpIfFalse,
+	NotEqualJumpIfFalse,
+	LessJumpIfFalse,
+	LessEqualJumpIfFalse,
+	GreaterJumpIfFalse,
+	GreaterEqualJumpIfFalse,
+	// LoadLocal x, PushInt, Add/Sub, StoreLocal x and the global forms
+	IncrementLocal,
+	DecrementLocal,
+	IncrementGlobal,
+	DecrementGlobal,
+
+	// quickened forms, never emitted by the compiler: the first run of an `Add` through `GreaterEqual`
+	// rewrites the instruction into the form specialized for the operand types it sees
+	// (`*Generic` when there is none), a specialized form whose type guard fails
+	// rewrites itself into the generic form for good
+	AddInt,
+	AddReal,
+	AddString,
+	AddGeneric,
+	SubInt,
+	SubReal,
+	SubGeneric,
+	MulInt,
+	MulReal,
+	MulGeneric,
+	DivInt,
+	DivReal,
+	DivGeneric,
+
+	LessInt,
+	LessReal,
+	LessGeneric,
+	LessEqualInt,
+	LessEqualReal,
+	LessEqualGeneric,
+	GreaterInt,
+	GreaterReal,
+	GreaterGeneric,
+	GreaterEqualInt,
+	GreaterEqualReal,
+	GreaterEqualGeneric,
+
+	_Count
+};
+
+typedef uint32_t Instruction;
+
+static constexpr uint32_t MaxOperand = (1u << 24) - 1;
+
+static inline constexpr Instruction MakeInstruction(OpCode op, uint32_t operand = 0) {
+	return static_cast<uint32_t>(op) | (operand << 8);
+}
+
+static inline constexpr OpCode GetOpCode(Instruction instruction) {
+	return static_cast<OpCode>(instruction & 0xFF);
+}
+
+static inline constexpr uint32_t GetOperand(Instruction instruction) {
+	return instruction >> 8;
+}
+
+// `PushInt` operands are signed
+static constexpr int32_t MinIntOperand = -(1 << 23);
+static constexpr int32_t MaxIntOperand = (1 << 23) - 1;
+
+static inline constexpr int32_t SignExtendOperand(uint32_t operand) {
+	// the arithmetic shift copies the 24th bit down
+	return static_cast<int32_t>(operand << 8) >> 8;
+}
+
+const char *GetOpCodeName(OpCode op);
+
+struct FunctionInfo
+{
+	CryptString name;
+	uint32_t entry = 0;
+	uint32_t param_count = 0;
+	// parameters included
+	uint32_t local_count = 0;
+	// deepest the operand stack gets above the locals
+	uint32_t max_stack = 0;
+};
+
+// the inline cache of a `GetField` instruction: where the field was found in the last few tables
+// it read, by their stamps (see `crypt::Variable::get_stamp()`), tables without one aren't cached;
+// caches belong to an execution context (see `ExecutionState`), a single thread
+struct FieldCache
+{
+	static constexpr size_t Ways = 4;
+
+	// nullptr on a miss
+	inline const crypt::Variable *find(uint64_t stamp) const noexcept {
+		for (size_t i = 0; i < Ways; i++)
+		{
+			if (stamps[i] == stamp)
+			{
+				return values[i];
+			}
+		}
+
+		return nullptr;
+	}
+
+	// replaces the entries round-robin
+	inline void remember(uint64_t stamp, const crypt::Variable *value) noexcept {
+		stamps[next] = stamp;
+		values[next] = value;
+		next = (next + 1) % Ways;
+	}
+
+	// zero is never a table's stamp
+	uint64_t stamps[Ways] = {};
+	const crypt::Variable *values[Ways] = {};
+	uint32_t next = 0;
+};
+
+// where a `StoreField` writes: `keys` walked down from a local or global
+struct FieldTarget
+{
+	bool global = false;
+	uint32_t slot = 0;
+	std::vector<CryptString> keys;
+};
+
+// the executable form of an instruction, see `Execute()`:
+// `dispatch` holds the handler address on computed-goto builds and the opcode otherwise,
+// quickening rewrites it while the program runs
+struct ExecutableInstruction
+{
+	std::atomic<uintptr_t> dispatch;
+	uint32_t operand;
+};
+
+namespace crypt
+{
+	struct Program
+	{
+		std::vector<Instruction> code;
+		// where each instruction came from, for errors
+		std::vector<TextPosition> positions;
+
+		std::vector<Variable> constants;
+		std::vector<CryptString> globals;
+		// globals the script assigns, written back after a run
+		std::vector<uint32_t> written_globals;
+
+		// functions[0] is the top-level code
+		std::vector<FunctionInfo> functions;
+		// the natives the script calls, bound when compiling
+		std::vector<NativeFunction> natives;
+
+		// one `FieldCache` per key in each execution context
+		std::vector<CryptString> field_keys;
+		std::vector<FieldTarget> field_targets;
+
+		// built by the first run, shared (quickening included) by every later run;
+		// concurrent runs may race to rewrite an instruction, which is harmless
+		// as every quickened form checks its own operand types
+		mutable std::unique_ptr<ExecutableInstruction[]> executable;
+		mutable std::once_flag executable_once;
+	};
+}
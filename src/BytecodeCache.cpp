@@ -0,0 +1,452 @@
+#include "BytecodeCache.hpp"
+#include "CryptSnapshot.hpp"
+#include "Hash.hpp"
+#include "MappedFile.hpp"
+#include "Peephole.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+using crypt::Program;
+using crypt::SnapshotError;
+using crypt::SnapshotList;
+using crypt::SnapshotView;
+using crypt::Variable;
+
+static constexpr char BytecodeMagic[4] = {'C', 'R', 'Y', 'B'};
+// bump when the layout of bytecode files or the meaning of an instruction changes
+static constexpr uint16_t BytecodeFormat = 4;
+static constexpr uint32_t BytecodeByteOrder = 0x01020304;
+
+// every section starts at a multiple of this
+static constexpr size_t BytecodeAlignment = 8;
+
+struct BytecodeHeader
+{
+	char magic[4];
+	uint16_t format;
+	// `OpCode::_Count` of the build that wrote it
+	uint16_t opcode_count;
+	uint32_t byte_order;
+	uint32_t reserved;
+	// the `CacheKey` it was compiled for
+	uint64_t source_hash;
+	uint64_t source_length;
+	// of the whole file, with this field zeroed (see `BytecodeChecksum()`)
+	uint64_t checksum;
+	uint64_t size;
+	// `code_count` instructions followed by as many positions
+	uint64_t code_offset;
+	uint64_t code_count;
+	uint64_t positions_offset;
+	// a snapshot of the constants, names and functions (see `EncodeTables()`)
+	uint64_t tables_offset;
+	uint64_t tables_size;
+};
+
+static_assert(sizeof(BytecodeHeader) % BytecodeAlignment == 0, "bytecode header must keep the alignment");
+static_assert(sizeof(TextPosition) == 8, "text positions must be packed");
+
+static Variable EncodeTables(const Program &program);
+static void DecodeTables(const SnapshotView &root, Program &program);
+// checks that every operand refers to something that exists, so a decoded program can't
+// make the vm index out of bounds; throws SnapshotError
+static void VerifyProgram(const Program &program);
+
+static inline size_t AlignUp(size_t offset) {
+	return (offset + BytecodeAlignment - 1) & ~(BytecodeAlignment - 1);
+}
+
+// the header (with the checksum zeroed) and everything after it
+static uint64_t BytecodeChecksum(BytecodeHeader header, const uint8_t *data, size_t size) {
+	header.checksum = 0;
+	const uint64_t seed = HashBytes(&header, sizeof(header));
+	return HashBytes(data + sizeof(BytecodeHeader), size - sizeof(BytecodeHeader), seed);
+}
+
+// whether `count` elements of `element_size` bytes at `offset` lie within the file
+static inline bool SectionFits(uint64_t offset, uint64_t count, size_t element_size, size_t size) {
+	return offset >= sizeof(BytecodeHeader) && offset <= size && count <= (size - offset) / element_size;
+}
+
+bool ReadBytecodeCache(const crypt::string_type &directory, const CacheKey &key, std::shared_ptr<Program> &out) {
+	const fs::path path = CacheFilePath(directory, key, "cryb");
+
+	std::error_code error{};
+	if (!fs::is_regular_file(path, error))
+	{
+		return false;
+	}
+
+	try
+	{
+		const MappedFile file{path.string().c_str()};
+		out = DecodeBytecode(file.data(), file.size(), key);
+	}
+	catch (const std::exception &)
+	{
+		// stale or damaged entries are treated as misses, the next write replaces them
+		return false;
+	}
+
+	return true;
+}
+
+void WriteBytecodeCache(const crypt::string_type &directory, const CacheKey &key, const Program &program) {
+	std::vector<uint8_t> image{};
+	try
+	{
+		image = EncodeBytecode(program, key);
+	}
+	catch (const std::exception &)
+	{
+		return;
+	}
+
+	WriteCacheFile(directory, CacheFilePath(directory, key, "cryb"), image);
+}
+
+std::vector<uint8_t> EncodeBytecode(const Program &program, const CacheKey &key) {
+	const std::vector<uint8_t> tables = crypt::EncodeSnapshot(EncodeTables(program));
+
+	BytecodeHeader header{};
+	memcpy(header.magic, BytecodeMagic, sizeof(BytecodeMagic));
+	header.format = BytecodeFormat;
+	header.opcode_count = static_cast<uint16_t>(OpCode::_Count);
+	header.byte_order = BytecodeByteOrder;
+	header.source_hash = key.hash;
+	header.source_length = key.length;
+
+	header.code_offset = sizeof(BytecodeHeader);
+	header.code_count = program.code.size();
+	header.positions_offset = AlignUp(header.code_offset + program.code.size() * sizeof(Instruction));
+	header.tables_offset = AlignUp(header.positions_offset + program.positions.size() * sizeof(TextPosition));
+	header.tables_size = tables.size();
+	header.size = header.tables_offset + tables.size();
+
+	std::vector<uint8_t> image(header.size, 0);
+	memcpy(image.data() + header.code_offset, program.code.data(), program.code.size() * sizeof(Instruction));
+	memcpy(
+		image.data() + header.positions_offset, program.positions.data(), program.positions.size() * sizeof(TextPosition)
+	);
+	memcpy(image.data() + header.tables_offset, tables.data(), tables.size());
+
+	header.checksum = BytecodeChecksum(header, image.data(), image.size());
+	memcpy(image.data(), &header, sizeof(header));
+	return image;
+}
+
+std::shared_ptr<Program> DecodeBytecode(const uint8_t *data, size_t size, const CacheKey &key) {
+	if (data == nullptr || size < sizeof(BytecodeHeader))
+	{
+		throw SnapshotError("bytecode is too small");
+	}
+
+	BytecodeHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, BytecodeMagic, sizeof(BytecodeMagic)) != 0)
+	{
+		throw SnapshotError("not a bytecode file");
+	}
+
+	if (header.format != BytecodeFormat || header.opcode_count != static_cast<uint16_t>(OpCode::_Count) ||
+			header.byte_order != BytecodeByteOrder)
+	{
+		throw SnapshotError("bytecode was written by an incompatible build");
+	}
+
+	if (header.source_hash != key.hash || header.source_length != key.length)
+	{
+		throw SnapshotError("bytecode is stale");
+	}
+
+	if (header.size != size || BytecodeChecksum(header, data, size) != header.checksum)
+	{
+		throw SnapshotError("bytecode is damaged");
+	}
+
+	// a matching checksum only catches accidental damage, the sections are checked before any read
+	if (!SectionFits(header.code_offset, header.code_count, sizeof(Instruction), size) ||
+			!SectionFits(header.positions_offset, header.code_count, sizeof(TextPosition), size) ||
+			!SectionFits(header.tables_offset, header.tables_size, 1, size))
+	{
+		throw SnapshotError("bytecode sections are out of bounds");
+	}
+
+	auto program = std::make_shared<Program>();
+
+	program->code.resize(header.code_count);
+	memcpy(program->code.data(), data + header.code_offset, header.code_count * sizeof(Instruction));
+
+	program->positions.resize(header.code_count);
+	memcpy(program->positions.data(), data + header.positions_offset, header.code_count * sizeof(TextPosition));
+
+	const crypt::Snapshot tables = crypt::Snapshot::FromBuffer(data + header.tables_offset, header.tables_size);
+	DecodeTables(tables.root(), *program);
+
+	VerifyProgram(*program);
+	return program;
+}
+
+static Variable EncodeStrings(const std::vector<CryptString> &strings) {
+	crypt::list_type list{};
+	list.reserve(strings.size());
+
+	for (const CryptString &string : strings)
+	{
+		list.emplace_back(string);
+	}
+
+	return Variable(std::move(list));
+}
+
+static std::vector<CryptString> DecodeStrings(const SnapshotView &view) {
+	std::vector<CryptString> strings{};
+
+	const SnapshotList list = view.get_list();
+	strings.reserve(list.size());
+
+	for (const SnapshotView element : list)
+	{
+		strings.emplace_back(element.get_string());
+	}
+
+	return strings;
+}
+
+static inline uint32_t DecodeIndex(const SnapshotView &view) {
+	const crypt::int_type value = view.get_int();
+	if (value < 0 || static_cast<uint64_t>(value) > UINT32_MAX)
+	{
+		throw SnapshotError("bytecode index out of range");
+	}
+
+	return static_cast<uint32_t>(value);
+}
+
+Variable EncodeTables(const Program &program) {
+	crypt::list_type written_globals{};
+	for (const uint32_t index : program.written_globals)
+	{
+		written_globals.emplace_back(static_cast<crypt::int_type>(index));
+	}
+
+	// name, entry, param count, local count, max stack
+	crypt::list_type functions{};
+	for (const FunctionInfo &function : program.functions)
+	{
+		functions.emplace_back(crypt::list_type{
+			Variable(function.name),
+			Variable(static_cast<crypt::int_type>(function.entry)),
+			Variable(static_cast<crypt::int_type>(function.param_count)),
+			Variable(static_cast<crypt::int_type>(function.local_count)),
+			Variable(static_cast<crypt::int_type>(function.max_stack)),
+		});
+	}
+
+	// global, slot, keys
+	crypt::list_type field_targets{};
+	for (const FieldTarget &target : program.field_targets)
+	{
+		field_targets.emplace_back(crypt::list_type{
+			Variable(target.global),
+			Variable(static_cast<crypt::int_type>(target.slot)),
+			EncodeStrings(target.keys),
+		});
+	}
+
+	crypt::table_type tables{};
+	tables["constants"] = Variable(program.constants);
+	tables["globals"] = EncodeStrings(program.globals);
+	tables["written_globals"] = Variable(std::move(written_globals));
+	tables["functions"] = Variable(std::move(functions));
+	tables["field_keys"] = EncodeStrings(program.field_keys);
+	tables["field_targets"] = Variable(std::move(field_targets));
+	return Variable(std::move(tables));
+}
+
+void DecodeTables(const SnapshotView &root, Program &program) {
+	const crypt::SnapshotTable tables = root.get_table();
+
+	for (const SnapshotView constant : tables.at("constants").get_list())
+	{
+		program.constants.push_back(constant.to_variable());
+	}
+
+	program.globals = DecodeStrings(tables.at("globals"));
+
+	for (const SnapshotView index : tables.at("written_globals").get_list())
+	{
+		program.written_globals.push_back(DecodeIndex(index));
+	}
+
+	for (const SnapshotView entry : tables.at("functions").get_list())
+	{
+		const SnapshotList fields = entry.get_list();
+		if (fields.size() != 5)
+		{
+			throw SnapshotError("bytecode function is malformed");
+		}
+
+		FunctionInfo &function = program.functions.emplace_back();
+		function.name = CryptString(fields[0].get_string());
+		function.entry = DecodeIndex(fields[1]);
+		function.param_count = DecodeIndex(fields[2]);
+		function.local_count = DecodeIndex(fields[3]);
+		function.max_stack = DecodeIndex(fields[4]);
+	}
+
+	program.field_keys = DecodeStrings(tables.at("field_keys"));
+
+	for (const SnapshotView entry : tables.at("field_targets").get_list())
+	{
+		const SnapshotList fields = entry.get_list();
+		if (fields.size() != 3)
+		{
+			throw SnapshotError("bytecode field target is malformed");
+		}
+
+		FieldTarget &target = program.field_targets.emplace_back();
+		target.global = fields[0].get_bool();
+		target.slot = DecodeIndex(fields[1]);
+		target.keys = DecodeStrings(fields[2]);
+	}
+}
+
+void VerifyProgram(const Program &program) {
+	const size_t code_size = program.code.size();
+
+	if (program.functions.empty() || program.functions[0].entry != 0)
+	{
+		throw SnapshotError("bytecode has no top-level code");
+	}
+
+	for (const uint32_t index : program.written_globals)
+	{
+		if (index >= program.globals.size())
+		{
+			throw SnapshotError("bytecode global out of range");
+		}
+	}
+
+	// the compiler lays the functions out one after the other, each one ends with a return
+	std::vector<const FunctionInfo *> layout{};
+	for (const FunctionInfo &function : program.functions)
+	{
+		if (function.entry >= code_size || function.param_count > function.local_count)
+		{
+			throw SnapshotError("bytecode function is malformed");
+		}
+
+		layout.push_back(&function);
+	}
+
+	std::sort(layout.begin(), layout.end(), [](const FunctionInfo *left, const FunctionInfo *right) {
+		return left->entry < right->entry;
+	});
+
+	for (size_t i = 0; i < layout.size(); i++)
+	{
+		const FunctionInfo &function = *layout[i];
+		const size_t end = i + 1 < layout.size() ? layout[i + 1]->entry : code_size;
+
+		if (end <= function.entry)
+		{
+			throw SnapshotError("bytecode functions overlap");
+		}
+
+		for (size_t pc = function.entry; pc < end; pc++)
+		{
+			const OpCode op = GetOpCode(program.code[pc]);
+			const uint32_t operand = GetOperand(program.code[pc]);
+
+			size_t limit = MaxOperand + size_t(1);
+			switch (op)
+			{
+			case OpCode::PushConst:
+				limit = program.constants.size();
+				break;
+			case OpCode::LoadGlobal:
+			case OpCode::StoreGlobal:
+				limit = program.globals.size();
+				break;
+			case OpCode::LoadLocal:
+			case OpCode::StoreLocal:
+				limit = function.local_count;
+				break;
+			case OpCode::GetField:
+				limit = program.field_keys.size();
+				break;
+			case OpCode::StoreField:
+				limit = program.field_targets.size();
+				if (operand < limit)
+				{
+					const FieldTarget &target = program.field_targets[operand];
+					if (target.keys.empty() ||
+							target.slot >= (target.global ? program.globals.size() : function.local_count))
+					{
+						throw SnapshotError("bytecode field target is malformed");
+					}
+				}
+				break;
+			case OpCode::Jump:
+			case OpCode::JumpIfFalse:
+			case OpCode::JumpIfFalseOrPop:
+			case OpCode::JumpIfTrueOrPop:
+				// jumps stay inside their function
+				limit = operand >= function.entry ? end : 0;
+				break;
+			case OpCode::Call:
+				limit = program.functions.size();
+				break;
+			case OpCode::CallNative:
+				// programs calling natives aren't cached
+				limit = program.natives.size();
+				break;
+			case OpCode::LoadLocal2:
+			case OpCode::StoreLocalKeep:
+			case OpCode::IncrementLocal:
+			case OpCode::DecrementLocal:
+				limit = IsFusionIntact(program.code, pc, end) ? function.local_count : 0;
+				break;
+			case OpCode::StoreGlobalKeep:
+			case OpCode::IncrementGlobal:
+			case OpCode::DecrementGlobal:
+				limit = IsFusionIntact(program.code, pc, end) ? program.globals.size() : 0;
+				break;
+			case OpCode::AddImmediate:
+			case OpCode::SubImmediate:
+			case OpCode::EqualJumpIfFalse:
+			case OpCode::NotEqualJumpIfFalse:
+			case OpCode::LessJumpIfFalse:
+			case OpCode::LessEqualJumpIfFalse:
+			case OpCode::GreaterJumpIfFalse:
+			case OpCode::GreaterEqualJumpIfFalse:
+				// superinstructions run the rest of their sequence, which is checked like any other code
+				limit = IsFusionIntact(program.code, pc, end) ? limit : 0;
+				break;
+			default:
+				// quickened forms only exist in the executable form
+				if (op >= OpCode::AddInt)
+				{
+					limit = 0;
+				}
+				break;
+			}
+
+			if (operand >= limit)
+			{
+				throw SnapshotError("bytecode instruction " + std::to_string(pc) + " is malformed");
+			}
+		}
+
+		const OpCode last = GetOpCode(program.code[end - 1]);
+		if (last != OpCode::Return && last != OpCode::ReturnNull)
+		{
+			throw SnapshotError("bytecode function doesn't end with a return");
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Bytecode.hpp"
+#include "ParseCache.hpp"
+
+#include <memory>
+
+// bytecode files: a header, the instruction stream and its positions as raw arrays
+// (copied out of the mapped file as is) and a snapshot of everything else;
+// all references are offsets from the start of the file, so it can be mapped anywhere
+
+// restores the program cached under `key` (the key of the source and the compile options), false on a miss;
+// files from other formats, instruction sets or sources, and damaged ones, are misses
+bool ReadBytecodeCache(const crypt::string_type &directory, const CacheKey &key, std::shared_ptr<crypt::Program> &out);
+// caches `program` under `key` like `WriteParseCache()`, failures are ignored
+void WriteBytecodeCache(const crypt::string_type &directory, const CacheKey &key, const crypt::Program &program);
+
+// the bytecode file image of `program` and the reverse, which throws crypt::SnapshotError
+// when the image isn't a valid one for `key`
+std::vector<uint8_t> EncodeBytecode(const crypt::Program &program, const CacheKey &key);
+std::shared_ptr<crypt::Program> DecodeBytecode(const uint8_t *data, size_t size, const CacheKey &key);
@@ -0,0 +1,612 @@
+#include "Compiler.hpp"
+#include "Operators.hpp"
+#include "CryptScript.hpp"
+
+#include <unordered_map>
+
+using crypt::Program;
+using crypt::ScriptError;
+using crypt::Variable;
+
+class Compiler
+{
+public:
+	inline Compiler(Program &program, const crypt::NativeRegistry *natives)
+		: m_program{program}, m_natives{natives} {
+	}
+
+	void compile(const Symbol &root);
+
+private:
+	void _declare_functions(const Symbol &root);
+	void _compile_function(const Symbol &function, uint32_t index);
+
+	void _compile_block(const Symbol &block);
+	void _compile_statement(const Symbol &statement);
+	void _compile_assign(const Symbol &assign);
+	void _compile_assign_field(const Symbol &assign);
+	void _compile_if(const Symbol &branch);
+	void _compile_while(const Symbol &loop);
+	void _compile_return(const Symbol &statement);
+
+	void _compile_expression(const Symbol &expression);
+	void _compile_binary(const Symbol &binary);
+	void _compile_call(const Symbol &call);
+	void _compile_native_call(const Symbol &call, const crypt::NativeFunction &native);
+	void _compile_value(const Variable &value, const TextPosition &pos);
+	// each `GetField` gets its own inline cache
+	void _get_field(const CryptString &key, const TextPosition &pos);
+
+	void _load(const CryptString &name, const TextPosition &pos);
+	void _store(const CryptString &name, const TextPosition &pos);
+
+	uint32_t _global(const CryptString &name, const TextPosition &pos);
+	uint32_t _constant(const Variable &value, const TextPosition &pos);
+
+	// appends an instruction and returns its index, `stack_effect` is how much it
+	// grows (or shrinks) the operand stack when execution falls through it
+	size_t _emit(OpCode op, uint32_t operand, const TextPosition &pos, int stack_effect);
+	inline size_t _emit(OpCode op, uint32_t operand, const TextPosition &pos) {
+		return this->_emit(op, operand, pos, StackEffect(op));
+	}
+	// points the jump at `at` to the next instruction
+	void _patch(size_t at);
+
+	static int StackEffect(OpCode op);
+	[[noreturn]] static void Fail(const std::string &message, const TextPosition &pos);
+
+private:
+	Program &m_program;
+	const crypt::NativeRegistry *m_natives;
+
+	std::unordered_map<CryptString, uint32_t> m_function_indices;
+	// into `Program::natives`
+	std::unordered_map<CryptString, uint32_t> m_native_indices;
+	std::unordered_map<CryptString, uint32_t> m_global_indices;
+	std::unordered_map<Variable, uint32_t> m_constant_indices;
+	std::vector<bool> m_written_globals;
+
+	// the function being compiled, zero for the top-level code
+	uint32_t m_function = 0;
+	std::unordered_map<CryptString, uint32_t> m_locals;
+	int m_depth = 0;
+};
+
+// adds the names assigned anywhere in `block` to `locals`
+static void CollectAssignedNames(const Symbol &block, std::unordered_map<CryptString, uint32_t> &locals);
+
+std::shared_ptr<Program> CompileProgram(const Symbol &root, const crypt::NativeRegistry *natives) {
+	auto program = std::make_shared<Program>();
+	Compiler(*program, natives).compile(root);
+	return program;
+}
+
+void Compiler::compile(const Symbol &root) {
+	m_program.functions.emplace_back().name = "<main>";
+	this->_declare_functions(root);
+
+	m_function = 0;
+	m_depth = 0;
+	m_program.functions[0].entry = 0;
+
+	for (const Symbol &statement : root.children)
+	{
+		if (statement.type != SymbolType::Function)
+		{
+			this->_compile_statement(statement);
+		}
+	}
+
+	this->_emit(OpCode::ReturnNull, 0, root.pos);
+
+	for (const Symbol &statement : root.children)
+	{
+		if (statement.type == SymbolType::Function)
+		{
+			this->_compile_function(statement, m_function_indices.at(statement.name));
+		}
+	}
+
+	for (uint32_t i = 0; i < m_written_globals.size(); i++)
+	{
+		if (m_written_globals[i])
+		{
+			m_program.written_globals.push_back(i);
+		}
+	}
+}
+
+void Compiler::_declare_functions(const Symbol &root) {
+	// declared up front so functions can call each other regardless of their order
+	for (const Symbol &statement : root.children)
+	{
+		if (statement.type != SymbolType::Function)
+		{
+			continue;
+		}
+
+		const uint32_t index = static_cast<uint32_t>(m_program.functions.size());
+		if (!m_function_indices.emplace(statement.name, index).second)
+		{
+			Fail("function '" + statement.name + "' is already declared", statement.pos);
+		}
+
+		FunctionInfo &info = m_program.functions.emplace_back();
+		info.name = statement.name;
+		info.param_count = static_cast<uint32_t>(statement.children.size() - 1);
+	}
+}
+
+void Compiler::_compile_function(const Symbol &function, uint32_t index) {
+	m_function = index;
+	m_depth = 0;
+	m_locals.clear();
+
+	const Symbol &body = function.children.back();
+	for (size_t i = 0; i + 1 < function.children.size(); i++)
+	{
+		const Symbol &parameter = function.children[i];
+		if (!m_locals.emplace(parameter.name, static_cast<uint32_t>(m_locals.size())).second)
+		{
+			Fail("duplicate parameter '" + parameter.name + "'", parameter.pos);
+		}
+	}
+
+	CollectAssignedNames(body, m_locals);
+
+	FunctionInfo &info = m_program.functions[index];
+	info.entry = static_cast<uint32_t>(m_program.code.size());
+	info.local_count = static_cast<uint32_t>(m_locals.size());
+
+	this->_compile_block(body);
+	this->_emit(OpCode::ReturnNull, 0, function.pos);
+
+	m_locals.clear();
+}
+
+void Compiler::_compile_block(const Symbol &block) {
+	for (const Symbol &statement : block.children)
+	{
+		this->_compile_statement(statement);
+	}
+}
+
+void Compiler::_compile_statement(const Symbol &statement) {
+	switch (statement.type)
+	{
+	case SymbolType::Assign:
+		this->_compile_assign(statement);
+		break;
+	case SymbolType::AssignField:
+		this->_compile_assign_field(statement);
+		break;
+	case SymbolType::If:
+		this->_compile_if(statement);
+		break;
+	case SymbolType::While:
+		this->_compile_while(statement);
+		break;
+	case SymbolType::Return:
+		this->_compile_return(statement);
+		break;
+	case SymbolType::Block:
+		this->_compile_block(statement);
+		break;
+	case SymbolType::Function:
+		Fail("functions can only be declared at the top level", statement.pos);
+	default:
+		// evaluated for its side effects only
+		this->_compile_expression(statement);
+		this->_emit(OpCode::Pop, 0, statement.pos);
+		break;
+	}
+}
+
+void Compiler::_compile_assign(const Symbol &assign) {
+	if (assign.op == TokenType::AssignOp)
+	{
+		this->_compile_expression(assign.children[0]);
+	}
+	else
+	{
+		// `a += b` is `a = a + b`
+		this->_load(assign.name, assign.pos);
+		this->_compile_expression(assign.children[0]);
+		this->_emit(BinaryOpCode(assign.op), 0, assign.pos);
+	}
+
+	this->_store(assign.name, assign.pos);
+}
+
+void Compiler::_compile_assign_field(const Symbol &assign) {
+	const size_t count = assign.children.size();
+
+	if (assign.op == TokenType::AssignOp)
+	{
+		this->_compile_expression(assign.children[0]);
+	}
+	else
+	{
+		// `a.b += c` is `a.b = a.b + c`
+		this->_load(assign.name, assign.pos);
+		for (size_t i = 1; i < count; i++)
+		{
+			this->_get_field(assign.children[i].name, assign.children[i].pos);
+		}
+
+		this->_compile_expression(assign.children[0]);
+		this->_emit(BinaryOpCode(assign.op), 0, assign.pos);
+	}
+
+	FieldTarget target{};
+	const auto local = m_locals.find(assign.name);
+	if (local != m_locals.end())
+	{
+		target.slot = local->second;
+	}
+	else
+	{
+		// the table is modified in place, which writes the global
+		target.global = true;
+		target.slot = this->_global(assign.name, assign.pos);
+		m_written_globals[target.slot] = true;
+	}
+
+	for (size_t i = 1; i < count; i++)
+	{
+		target.keys.push_back(assign.children[i].name);
+	}
+
+	const uint32_t index = static_cast<uint32_t>(m_program.field_targets.size());
+	if (index > MaxOperand)
+	{
+		Fail("too many field assignments", assign.pos);
+	}
+
+	m_program.field_targets.push_back(std::move(target));
+	this->_emit(OpCode::StoreField, index, assign.pos);
+}
+
+void Compiler::_compile_if(const Symbol &branch) {
+	std::vector<size_t> exits{};
+	const size_t count = branch.children.size();
+
+	for (size_t i = 0; i + 1 < count; i += 2)
+	{
+		this->_compile_expression(branch.children[i]);
+		const size_t skip = this->_emit(OpCode::JumpIfFalse, 0, branch.children[i].pos);
+
+		this->_compile_block(branch.children[i + 1]);
+
+		// the last branch falls through to the end
+		if (i + 2 < count)
+		{
+			exits.push_back(this->_emit(OpCode::Jump, 0, branch.pos));
+		}
+
+		this->_patch(skip);
+	}
+
+	if (count % 2 == 1)
+	{
+		this->_compile_block(branch.children.back());
+	}
+
+	for (const size_t exit : exits)
+	{
+		this->_patch(exit);
+	}
+}
+
+void Compiler::_compile_while(const Symbol &loop) {
+	const uint32_t start = static_cast<uint32_t>(m_program.code.size());
+
+	this->_compile_expression(loop.children[0]);
+	const size_t exit = this->_emit(OpCode::JumpIfFalse, 0, loop.children[0].pos);
+
+	this->_compile_block(loop.children[1]);
+	this->_emit(OpCode::Jump, start, loop.pos);
+
+	this->_patch(exit);
+}
+
+void Compiler::_compile_return(const Symbol &statement) {
+	if (statement.children.empty())
+	{
+		this->_emit(OpCode::ReturnNull, 0, statement.pos);
+		return;
+	}
+
+	this->_compile_expression(statement.children[0]);
+	this->_emit(OpCode::Return, 0, statement.pos);
+}
+
+void Compiler::_compile_expression(const Symbol &expression) {
+	switch (expression.type)
+	{
+	case SymbolType::Value:
+		this->_compile_value(expression.value, expression.pos);
+		break;
+	case SymbolType::Identifier:
+		this->_load(expression.name, expression.pos);
+		break;
+	case SymbolType::Unary:
+		{
+			this->_compile_expression(expression.children[0]);
+			this->_emit(UnaryOpCode(expression.op), 0, expression.pos);
+		}
+		break;
+	case SymbolType::Binary:
+		this->_compile_binary(expression);
+		break;
+	case SymbolType::Call:
+		this->_compile_call(expression);
+		break;
+	case SymbolType::Field:
+		this->_compile_expression(expression.children[0]);
+		this->_get_field(expression.name, expression.pos);
+		break;
+	default:
+		Fail("expected an expression", expression.pos);
+	}
+}
+
+void Compiler::_compile_binary(const Symbol &binary) {
+	this->_compile_expression(binary.children[0]);
+
+	if (binary.op == TokenType::AndOp || binary.op == TokenType::OrOp)
+	{
+		// the left operand decides unless it passes the check, then the right one does
+		const OpCode op = binary.op == TokenType::AndOp ? OpCode::JumpIfFalseOrPop : OpCode::JumpIfTrueOrPop;
+		const size_t skip = this->_emit(op, 0, binary.pos);
+
+		this->_compile_expression(binary.children[1]);
+		this->_patch(skip);
+		return;
+	}
+
+	this->_compile_expression(binary.children[1]);
+	this->_emit(BinaryOpCode(binary.op), 0, binary.pos);
+}
+
+void Compiler::_compile_call(const Symbol &call) {
+	const auto found = m_function_indices.find(call.name);
+	if (found == m_function_indices.end())
+	{
+		const crypt::NativeFunction *native = m_natives ? m_natives->find(call.name) : nullptr;
+		if (native == nullptr)
+		{
+			Fail("unknown function '" + call.name + "'", call.pos);
+		}
+
+		this->_compile_native_call(call, *native);
+		return;
+	}
+
+	const FunctionInfo &callee = m_program.functions[found->second];
+	if (callee.param_count != call.children.size())
+	{
+		Fail(
+			"'" + call.name + "' takes " + std::to_string(callee.param_count) + " arguments, got " +
+				std::to_string(call.children.size()),
+			call.pos
+		);
+	}
+
+	for (const Symbol &argument : call.children)
+	{
+		this->_compile_expression(argument);
+	}
+
+	this->_emit(OpCode::Call, found->second, call.pos, 1 - static_cast<int>(call.children.size()));
+}
+
+void Compiler::_compile_native_call(const Symbol &call, const crypt::NativeFunction &native) {
+	if (native.param_count != call.children.size())
+	{
+		Fail(
+			"'" + call.name + "' takes " + std::to_string(native.param_count) + " arguments, got " +
+				std::to_string(call.children.size()),
+			call.pos
+		);
+	}
+
+	const auto found = m_native_indices.find(call.name);
+	uint32_t index = 0;
+
+	if (found != m_native_indices.end())
+	{
+		index = found->second;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_program.natives.size());
+		m_program.natives.push_back(native);
+		m_native_indices.emplace(call.name, index);
+	}
+
+	for (const Symbol &argument : call.children)
+	{
+		this->_compile_expression(argument);
+	}
+
+	this->_emit(OpCode::CallNative, index, call.pos, 1 - static_cast<int>(call.children.size()));
+}
+
+void Compiler::_compile_value(const Variable &value, const TextPosition &pos) {
+	switch (value.get_type())
+	{
+	case crypt::VariableType::Null:
+		this->_emit(OpCode::PushNull, 0, pos);
+		return;
+	case crypt::VariableType::Bool:
+		this->_emit(value.get_bool() ? OpCode::PushTrue : OpCode::PushFalse, 0, pos);
+		return;
+	case crypt::VariableType::Int:
+		if (value.get_int() >= MinIntOperand && value.get_int() <= MaxIntOperand)
+		{
+			this->_emit(OpCode::PushInt, static_cast<uint32_t>(value.get_int()) & MaxOperand, pos);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+
+	this->_emit(OpCode::PushConst, this->_constant(value, pos), pos);
+}
+
+void Compiler::_get_field(const CryptString &key, const TextPosition &pos) {
+	const uint32_t index = static_cast<uint32_t>(m_program.field_keys.size());
+	if (index > MaxOperand)
+	{
+		Fail("too many field accesses", pos);
+	}
+
+	m_program.field_keys.push_back(key);
+	this->_emit(OpCode::GetField, index, pos);
+}
+
+void Compiler::_load(const CryptString &name, const TextPosition &pos) {
+	const auto local = m_locals.find(name);
+	if (local != m_locals.end())
+	{
+		this->_emit(OpCode::LoadLocal, local->second, pos);
+		return;
+	}
+
+	this->_emit(OpCode::LoadGlobal, this->_global(name, pos), pos);
+}
+
+void Compiler::_store(const CryptString &name, const TextPosition &pos) {
+	const auto local = m_locals.find(name);
+	if (local != m_locals.end())
+	{
+		this->_emit(OpCode::StoreLocal, local->second, pos);
+		return;
+	}
+
+	const uint32_t index = this->_global(name, pos);
+	m_written_globals[index] = true;
+	this->_emit(OpCode::StoreGlobal, index, pos);
+}
+
+uint32_t Compiler::_global(const CryptString &name, const TextPosition &pos) {
+	const auto found = m_global_indices.find(name);
+	if (found != m_global_indices.end())
+	{
+		return found->second;
+	}
+
+	const uint32_t index = static_cast<uint32_t>(m_program.globals.size());
+	if (index > MaxOperand)
+	{
+		Fail("too many globals", pos);
+	}
+
+	m_global_indices.emplace(name, index);
+	m_program.globals.push_back(name);
+	m_written_globals.push_back(false);
+	return index;
+}
+
+uint32_t Compiler::_constant(const Variable &value, const TextPosition &pos) {
+	const auto found = m_constant_indices.find(value);
+	if (found != m_constant_indices.end())
+	{
+		return found->second;
+	}
+
+	const uint32_t index = static_cast<uint32_t>(m_program.constants.size());
+	if (index > MaxOperand)
+	{
+		Fail("too many constants", pos);
+	}
+
+	m_constant_indices.emplace(value, index);
+	m_program.constants.push_back(value);
+	return index;
+}
+
+size_t Compiler::_emit(OpCode op, uint32_t operand, const TextPosition &pos, int stack_effect) {
+	const size_t index = m_program.code.size();
+	if (index > MaxOperand)
+	{
+		Fail("script too long", pos);
+	}
+
+	m_program.code.push_back(MakeInstruction(op, operand));
+	m_program.positions.push_back(pos);
+
+	m_depth += stack_effect;
+
+	FunctionInfo &info = m_program.functions[m_function];
+	if (m_depth > static_cast<int>(info.max_stack))
+	{
+		info.max_stack = static_cast<uint32_t>(m_depth);
+	}
+
+	return index;
+}
+
+void Compiler::_patch(size_t at) {
+	const OpCode op = GetOpCode(m_program.code[at]);
+	m_program.code[at] = MakeInstruction(op, static_cast<uint32_t>(m_program.code.size()));
+}
+
+int Compiler::StackEffect(OpCode op) {
+	switch (op)
+	{
+	case OpCode::PushConst:
+	case OpCode::PushNull:
+	case OpCode::PushTrue:
+	case OpCode::PushFalse:
+	case OpCode::PushInt:
+	case OpCode::LoadGlobal:
+	case OpCode::LoadLocal:
+		return 1;
+	case OpCode::Pop:
+	case OpCode::StoreGlobal:
+	case OpCode::StoreLocal:
+	case OpCode::StoreField:
+	case OpCode::Add:
+	case OpCode::Sub:
+	case OpCode::Mul:
+	case OpCode::Div:
+	case OpCode::BitAnd:
+	case OpCode::BitOr:
+	case OpCode::Equal:
+	case OpCode::NotEqual:
+	case OpCode::Less:
+	case OpCode::LessEqual:
+	case OpCode::Greater:
+	case OpCode::GreaterEqual:
+	case OpCode::JumpIfFalse:
+	case OpCode::JumpIfFalseOrPop:
+	case OpCode::JumpIfTrueOrPop:
+	case OpCode::Return:
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+void Compiler::Fail(const std::string &message, const TextPosition &pos) {
+	throw ScriptError(message, pos.line + 1, pos.column + 1);
+}
+
+void CollectAssignedNames(const Symbol &block, std::unordered_map<CryptString, uint32_t> &locals) {
+	for (const Symbol &child : block.children)
+	{
+		if (child.type == SymbolType::Assign)
+		{
+			locals.emplace(child.name, static_cast<uint32_t>(locals.size()));
+		}
+
+		// assignments nested in ifs and loops are locals too
+		if (child.type == SymbolType::If || child.type == SymbolType::While || child.type == SymbolType::Block)
+		{
+			CollectAssignedNames(child, locals);
+		}
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "Bytecode.hpp"
+#include "Parser.hpp"
+
+#include <memory>
+
+// compiles a script's `Block` symbol (see `Symbol::Parse()`), calls of functions the script doesn't
+// declare go to `natives` (when not null); throws crypt::ScriptError
+std::shared_ptr<crypt::Program> CompileProgram(const Symbol &root, const crypt::NativeRegistry *natives);
@@ -1,4 +1,8 @@
 #include "Crypt.hpp"
+#include "Hash.hpp"
+
+using crypt::SharedPayload;
+using crypt::PackedArray;
 
 struct ConstructDefault
 {
@@ -7,6 +11,11 @@ struct ConstructDefault
 		new (&value) T();
 	}
 
+	template <typename T>
+	inline void operator()(SharedPayload<T> *&value) const {
+		value = new SharedPayload<T>();
+	}
+
 	inline void operator()() const {
 	}
 };
@@ -18,6 +27,15 @@ struct Deconstruct
 		value.~T();
 	}
 
+	// releases the reference, deleting the payload if it was the last one
+	template <typename T>
+	inline void operator()(SharedPayload<T> *&value) const {
+		if (value->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete value;
+		}
+	}
+
 	inline void operator()() const {
 	}
 };
@@ -31,12 +49,30 @@ struct CopyConstruct
 		new (&value) T(*((const T *)this->source));
 	}
 
+	// shares the payload instead of copying it, unless a mutable reference to it was handed out:
+	// writes through that would show in the copy
+	template <typename T>
+	inline void operator()(SharedPayload<T> *&value) const {
+		SharedPayload<T> *const shared = *((SharedPayload<T> *const *)this->source);
+
+		if (shared->exposed.load(std::memory_order_acquire))
+		{
+			value = new SharedPayload<T>(shared->value);
+			return;
+		}
+
+		value = shared;
+		value->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	inline void operator()() const {
 	}
 
 	const void *source;
 };
 
+// the source must be nulled by the caller after the move,
+// as the payloads are taken without touching their references
 struct MoveConstruct
 {
 	inline MoveConstruct(void *_source) : source{_source} {}
@@ -52,35 +88,161 @@ struct MoveConstruct
 	void *source;
 };
 
-struct CopyAssign
-{
-	inline CopyAssign(const void *_source) : source{_source} {}
+// makes sure `payload` is not shared with any other variable, copying it if it is;
+// `expose` when the caller keeps the reference (see `Variable::get_stamp()`)
+template <typename T>
+static inline T &DetachPayload(SharedPayload<T> *&payload, bool expose) {
+	if (payload->refs.load(std::memory_order_acquire) != 1)
+	{
+		SharedPayload<T> *copy = new SharedPayload<T>(payload->value);
+		Deconstruct()(payload);
+		payload = copy;
+	}
+
+	// about to be mutated
+	payload->stamp.store(0, std::memory_order_release);
+	payload->hash.store(0, std::memory_order_release);
+	if (expose)
+	{
+		payload->exposed.store(true, std::memory_order_release);
+	}
+	return payload->value;
+}
 
-	template <typename T>
-	inline void operator()(T &value) const {
-		value = *((const T *)this->source);
+static std::atomic<uint64_t> StampCounter{0};
+
+template <typename T>
+static inline uint64_t PayloadStamp(const SharedPayload<T> *payload) {
+	// it can change behind any stamp
+	if (payload->exposed.load(std::memory_order_acquire))
+	{
+		return 0;
 	}
 
-	inline void operator()() const {
+	uint64_t stamp = payload->stamp.load(std::memory_order_acquire);
+
+	if (stamp == 0)
+	{
+		const uint64_t fresh = StampCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		// another reader might have stamped it first, keep theirs
+		if (payload->stamp.compare_exchange_strong(stamp, fresh, std::memory_order_acq_rel))
+		{
+			stamp = fresh;
+		}
 	}
 
-	const void *source;
-};
+	return stamp;
+}
 
-struct MoveAssign
-{
-	inline MoveAssign(void *_source) : source{_source} {}
+template <typename T>
+static inline crypt::list_type BoxValues(const std::vector<T> &values) {
+	return crypt::list_type(values.begin(), values.end());
+}
 
-	template <typename T>
-	inline void operator()(T &value) const {
-		value = std::forward<T>(*((T *)this->source));
+// the generic list view of a packed array, built once and shared by all readers
+template <typename T>
+static const crypt::list_type &BoxedView(const PackedArray<T> &array) {
+	crypt::list_type *boxed = array.boxed.load(std::memory_order_acquire);
+
+	if (boxed == nullptr)
+	{
+		crypt::list_type *fresh = new crypt::list_type(BoxValues(array.values));
+
+		// another reader might have boxed it first, keep theirs
+		if (array.boxed.compare_exchange_strong(boxed, fresh, std::memory_order_acq_rel))
+		{
+			boxed = fresh;
+		}
+		else
+		{
+			delete fresh;
+		}
 	}
 
-	inline void operator()() const {
+	return *boxed;
+}
+
+static inline uint64_t HashScalar(crypt::VariableType type, uint64_t bits) {
+	return HashCombine(uint64_t(type) + 1, bits);
+}
+
+static inline uint64_t RealBits(crypt::real_type value) {
+	// -0 equals 0
+	if (value == 0)
+	{
+		value = 0;
 	}
 
-	void *source;
-};
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// packed arrays hash like the list they box to
+static inline uint64_t ListSeed(size_t size) {
+	return HashScalar(crypt::VariableType::List, size);
+}
+
+// `current` is cleared when the hash can't be memoized: a mutable reference was handed out for
+// the payload or anything in it, which can change it without clearing the memo
+template <typename T, typename _Compute>
+static inline uint64_t MemoizedHash(const SharedPayload<T> *payload, bool &current, _Compute &&compute) {
+	bool stable = !payload->exposed.load(std::memory_order_acquire);
+	uint64_t hash = stable ? payload->hash.load(std::memory_order_acquire) : 0;
+
+	if (hash == 0)
+	{
+		hash = compute(payload->value, stable);
+
+		// zero marks an uncomputed hash
+		if (hash == 0)
+		{
+			hash = 1;
+		}
+
+		if (stable)
+		{
+			payload->hash.store(hash, std::memory_order_release);
+		}
+	}
+
+	current = current && stable;
+	return hash;
+}
+
+template <typename T>
+static inline bool ValuesEqual(const T &left, const T &right) {
+	return left == right;
+}
+
+template <typename T>
+static inline bool ValuesEqual(const PackedArray<T> &left, const PackedArray<T> &right) {
+	return left.values == right.values;
+}
+
+// the shared payload check comes first, it shouldn't have to compute any hash;
+// payloads a mutable reference was handed out for are never memoized, they compare right away
+// instead of hashing both sides first
+template <typename T>
+static inline bool PayloadsEqual(
+	const SharedPayload<T> *left, const SharedPayload<T> *right,
+	const crypt::Variable &left_owner, const crypt::Variable &right_owner
+) {
+	if (left == right)
+	{
+		return true;
+	}
+
+	const bool exposed =
+		left->exposed.load(std::memory_order_acquire) || right->exposed.load(std::memory_order_acquire);
+	if (!exposed && left_owner.get_hash() != right_owner.get_hash())
+	{
+		return false;
+	}
+
+	return ValuesEqual(left->value, right->value);
+}
 
 namespace crypt
 {
@@ -100,6 +262,10 @@ namespace crypt
 			return proc(m_list);
 		case VariableType::Table:
 			return proc(m_table);
+		case VariableType::IntArray:
+			return proc(m_int_array);
+		case VariableType::RealArray:
+			return proc(m_real_array);
 
 		case VariableType::Null:
 		default:
@@ -124,15 +290,43 @@ namespace crypt
 	}
 
 	Variable::Variable(const string_type &value)
-		: m_type{VariableType::Str}, m_string{value} {
+		: m_type{VariableType::Str}, m_string{new SharedPayload<string_type>(value)} {
 	}
 
 	Variable::Variable(const list_type &value)
-		: m_type{VariableType::List}, m_list{value} {
+		: m_type{VariableType::List}, m_list{new SharedPayload<list_type>(value)} {
 	}
 
 	Variable::Variable(const table_type &value)
-		: m_type{VariableType::Table}, m_table{value} {
+		: m_type{VariableType::Table}, m_table{new SharedPayload<table_type>(value)} {
+	}
+
+	Variable::Variable(string_type &&value)
+		: m_type{VariableType::Str}, m_string{new SharedPayload<string_type>(std::move(value))} {
+	}
+
+	Variable::Variable(list_type &&value)
+		: m_type{VariableType::List}, m_list{new SharedPayload<list_type>(std::move(value))} {
+	}
+
+	Variable::Variable(table_type &&value)
+		: m_type{VariableType::Table}, m_table{new SharedPayload<table_type>(std::move(value))} {
+	}
+
+	Variable::Variable(const int_array_type &value)
+		: m_type{VariableType::IntArray}, m_int_array{new SharedPayload<PackedArray<int_type>>(value)} {
+	}
+
+	Variable::Variable(const real_array_type &value)
+		: m_type{VariableType::RealArray}, m_real_array{new SharedPayload<PackedArray<real_type>>(value)} {
+	}
+
+	Variable::Variable(int_array_type &&value)
+		: m_type{VariableType::IntArray}, m_int_array{new SharedPayload<PackedArray<int_type>>(std::move(value))} {
+	}
+
+	Variable::Variable(real_array_type &&value)
+		: m_type{VariableType::RealArray}, m_real_array{new SharedPayload<PackedArray<real_type>>(std::move(value))} {
 	}
 
 	Variable::Variable(const Variable &copy) : m_type{copy.m_type} {
@@ -141,6 +335,7 @@ namespace crypt
 
 	Variable::Variable(Variable &&move) noexcept : m_type{move.m_type} {
 		this->__apply(MoveConstruct(&move.m_boolean));
+		move.m_type = _null;
 	}
 
 	Variable &Variable::operator=(const Variable &copy) {
@@ -149,16 +344,24 @@ namespace crypt
 			return *this;
 		}
 
-		this->__apply(Deconstruct());
-		m_type = copy.m_type;
-		this->__apply(CopyAssign(&copy.m_boolean));
-		return *this;
+		// copy first, `copy` might live inside our own payload
+		Variable temp{copy};
+		return *this = std::move(temp);
 	}
 
 	Variable &Variable::operator=(Variable &&move) noexcept {
+		if (std::addressof(move) == this)
+		{
+			return *this;
+		}
+
+		// take the value first, `move` might live inside our own payload
+		Variable temp{std::move(move)};
+
 		this->__apply(Deconstruct());
-		m_type = move.m_type;
-		this->__apply(MoveAssign(&move.m_boolean));
+		m_type = temp.m_type;
+		this->__apply(MoveConstruct(&temp.m_boolean));
+		temp.m_type = _null;
 		return *this;
 	}
 
@@ -166,6 +369,11 @@ namespace crypt
 		this->__apply(Deconstruct());
 	}
 
+	void Variable::_release() {
+		this->__apply(Deconstruct());
+		m_type = _null;
+	}
+
 	boolean_type Variable::get_bool() const {
 		switch (m_type)
 		{
@@ -215,30 +423,59 @@ namespace crypt
 	}
 
 	string_type &Variable::get_string() {
+		string_type &value = this->_edit_string();
+		m_string->exposed.store(true, std::memory_order_release);
+		return value;
+	}
+
+	list_type &Variable::get_list() {
+		list_type &value = this->_edit_list();
+		m_list->exposed.store(true, std::memory_order_release);
+		return value;
+	}
+
+	table_type &Variable::get_table() {
+		table_type &value = this->_edit_table();
+		m_table->exposed.store(true, std::memory_order_release);
+		return value;
+	}
+
+	string_type &Variable::_edit_string() {
 		if (m_type != VariableType::Str)
 		{
 			throw VariableAccessError("string");
 		}
 
-		return m_string;
+		return DetachPayload(m_string, false);
 	}
 
-	list_type &Variable::get_list() {
+	list_type &Variable::_edit_list() {
+		// unpack, the numbers might not stay homogeneous
+		if (m_type == VariableType::IntArray)
+		{
+			return this->_build_list(BoxValues(m_int_array->value.values));
+		}
+
+		if (m_type == VariableType::RealArray)
+		{
+			return this->_build_list(BoxValues(m_real_array->value.values));
+		}
+
 		if (m_type != VariableType::List)
 		{
 			throw VariableAccessError("list");
 		}
 
-		return m_list;
+		return DetachPayload(m_list, false);
 	}
 
-	table_type &Variable::get_table() {
+	table_type &Variable::_edit_table() {
 		if (m_type != VariableType::Table)
 		{
 			throw VariableAccessError("table");
 		}
 
-		return m_table;
+		return DetachPayload(m_table, false);
 	}
 
 	const string_type &Variable::get_string() const {
@@ -247,16 +484,26 @@ namespace crypt
 			throw VariableAccessError("string");
 		}
 
-		return m_string;
+		return m_string->value;
 	}
 
 	const list_type &Variable::get_list() const {
+		if (m_type == VariableType::IntArray)
+		{
+			return BoxedView(m_int_array->value);
+		}
+
+		if (m_type == VariableType::RealArray)
+		{
+			return BoxedView(m_real_array->value);
+		}
+
 		if (m_type != VariableType::List)
 		{
 			throw VariableAccessError("list");
 		}
 
-		return m_list;
+		return m_list->value;
 	}
 
 	const table_type &Variable::get_table() const {
@@ -265,6 +512,144 @@ namespace crypt
 			throw VariableAccessError("table");
 		}
 
-		return m_table;
+		return m_table->value;
+	}
+
+	uint64_t Variable::get_stamp() const {
+		switch (m_type)
+		{
+		case VariableType::Str:
+			return PayloadStamp(m_string);
+		case VariableType::List:
+			return PayloadStamp(m_list);
+		case VariableType::Table:
+			return PayloadStamp(m_table);
+		case VariableType::IntArray:
+			return PayloadStamp(m_int_array);
+		case VariableType::RealArray:
+			return PayloadStamp(m_real_array);
+		default:
+			return 0;
+		}
+	}
+
+	Span<int_type> Variable::get_int_array() const {
+		if (m_type != VariableType::IntArray)
+		{
+			throw VariableAccessError("int array");
+		}
+
+		return {m_int_array->value.values.data(), m_int_array->value.values.size()};
+	}
+
+	Span<real_type> Variable::get_real_array() const {
+		if (m_type != VariableType::RealArray)
+		{
+			throw VariableAccessError("real array");
+		}
+
+		return {m_real_array->value.values.data(), m_real_array->value.values.size()};
+	}
+
+	uint64_t Variable::get_hash() const {
+		bool current = true;
+		return this->_hash(current);
+	}
+
+	uint64_t Variable::_hash(bool &current) const {
+		switch (m_type)
+		{
+		case VariableType::Bool:
+			return HashScalar(m_type, m_boolean);
+		case VariableType::Int:
+			return HashScalar(m_type, static_cast<uint64_t>(m_integer));
+		case VariableType::Real:
+			return HashScalar(m_type, RealBits(m_real));
+		case VariableType::Str:
+			return MemoizedHash(m_string, current, [](const string_type &value, bool &) {
+				return HashScalar(VariableType::Str, HashBytes(value.data(), value.size()));
+			});
+		case VariableType::List:
+			return MemoizedHash(m_list, current, [](const list_type &value, bool &stable) {
+				uint64_t hash = ListSeed(value.size());
+				for (const Variable &element : value)
+				{
+					hash = HashCombine(hash, element._hash(stable));
+				}
+				return hash;
+			});
+		case VariableType::Table:
+			return MemoizedHash(m_table, current, [](const table_type &value, bool &stable) {
+				uint64_t hash = HashScalar(VariableType::Table, value.size());
+				for (const auto &[key, element] : value)
+				{
+					hash = HashCombine(hash, HashBytes(key.data(), key.size()));
+					hash = HashCombine(hash, element._hash(stable));
+				}
+				return hash;
+			});
+		case VariableType::IntArray:
+			return MemoizedHash(m_int_array, current, [](const PackedArray<int_type> &value, bool &) {
+				uint64_t hash = ListSeed(value.values.size());
+				for (const int_type element : value.values)
+				{
+					hash = HashCombine(hash, HashScalar(VariableType::Int, static_cast<uint64_t>(element)));
+				}
+				return hash;
+			});
+		case VariableType::RealArray:
+			return MemoizedHash(m_real_array, current, [](const PackedArray<real_type> &value, bool &) {
+				uint64_t hash = ListSeed(value.values.size());
+				for (const real_type element : value.values)
+				{
+					hash = HashCombine(hash, HashScalar(VariableType::Real, RealBits(element)));
+				}
+				return hash;
+			});
+		case VariableType::Null:
+		default:
+			return HashScalar(VariableType::Null, 0);
+		}
+	}
+
+	bool Variable::operator==(const Variable &other) const {
+		if (this == &other)
+		{
+			return true;
+		}
+
+		if (m_type != other.m_type)
+		{
+			// a packed array against a list (or the other packed type)
+			if (this->is_list() && other.is_list())
+			{
+				return this->get_hash() == other.get_hash() && this->get_list() == other.get_list();
+			}
+
+			return false;
+		}
+
+		switch (m_type)
+		{
+		case VariableType::Bool:
+			return m_boolean == other.m_boolean;
+		case VariableType::Int:
+			return m_integer == other.m_integer;
+		case VariableType::Real:
+			return m_real == other.m_real;
+		case VariableType::Str:
+			return PayloadsEqual(m_string, other.m_string, *this, other);
+		case VariableType::List:
+			return PayloadsEqual(m_list, other.m_list, *this, other);
+		case VariableType::Table:
+			return PayloadsEqual(m_table, other.m_table, *this, other);
+		case VariableType::IntArray:
+			return PayloadsEqual(m_int_array, other.m_int_array, *this, other);
+		case VariableType::RealArray:
+			return PayloadsEqual(m_real_array, other.m_real_array, *this, other);
+		case VariableType::Null:
+		default:
+			return true;
+		}
 	}
 }
@@ -0,0 +1,86 @@
+#include "Crypt.hpp"
+
+#include <unordered_set>
+
+using crypt::Variable;
+using crypt::VariableType;
+
+typedef std::unordered_set<Variable> InternSet;
+
+// interns the children first, so the parents compare by their (shared) children's payloads
+static void Intern(Variable &value, InternSet &interned, crypt::LoadStats &stats);
+// heap bytes owned by the value's own payload, not counting its children's payloads
+static size_t PayloadBytes(const Variable &value);
+
+namespace crypt
+{
+	void Deduplicate(Variable &root, LoadStats *stats) {
+		InternSet interned{};
+		LoadStats local_stats{};
+
+		Intern(root, interned, local_stats);
+
+		if (stats != nullptr)
+		{
+			stats->shared_values += local_stats.shared_values;
+			stats->saved_bytes += local_stats.saved_bytes;
+		}
+	}
+}
+
+void Intern(Variable &value, InternSet &interned, crypt::LoadStats &stats) {
+	switch (value.get_type())
+	{
+	case VariableType::Table:
+		for (auto &[key, element] : value._edit_table())
+		{
+			Intern(element, interned, stats);
+		}
+		break;
+	case VariableType::List:
+		for (Variable &element : value._edit_list())
+		{
+			Intern(element, interned, stats);
+		}
+		break;
+	case VariableType::Str:
+	case VariableType::IntArray:
+	case VariableType::RealArray:
+		break;
+	default:
+		// scalars have no payload
+		return;
+	}
+
+	const auto [iter, inserted] = interned.insert(value);
+
+	if (!inserted && !iter->shares_payload(value))
+	{
+		stats.shared_values++;
+		stats.saved_bytes += PayloadBytes(value);
+		value = *iter;
+	}
+}
+
+size_t PayloadBytes(const Variable &value) {
+	// payload header: reference count, stamp and hash
+	constexpr size_t header = sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	// a map node: the entry and the tree links
+	constexpr size_t table_node = sizeof(crypt::table_type::value_type) + 4 * sizeof(void *);
+
+	switch (value.get_type())
+	{
+	case VariableType::Str:
+		return header + value.get_string().capacity() + 1;
+	case VariableType::List:
+		return header + sizeof(crypt::list_type) + value.get_list().capacity() * sizeof(Variable);
+	case VariableType::Table:
+		return header + sizeof(crypt::table_type) + value.get_table().size() * table_node;
+	case VariableType::IntArray:
+		return header + sizeof(crypt::int_array_type) + value.get_int_array().size * sizeof(crypt::int_type);
+	case VariableType::RealArray:
+		return header + sizeof(crypt::real_array_type) + value.get_real_array().size * sizeof(crypt::real_type);
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,218 @@
+#include "CryptDiff.hpp"
+
+#include <algorithm>
+
+using crypt::Change;
+using crypt::ChangeKind;
+using crypt::Path;
+using crypt::Variable;
+
+static void DiffValues(const Variable &from, const Variable &to, std::vector<Path::Segment> &segments, std::vector<Change> &out);
+static void DiffTables(const crypt::table_type &from, const crypt::table_type &to, std::vector<Path::Segment> &segments, std::vector<Change> &out);
+static void DiffLists(const crypt::list_type &from, const crypt::list_type &to, std::vector<Path::Segment> &segments, std::vector<Change> &out);
+
+static inline void PushChange(ChangeKind kind, const std::vector<Path::Segment> &segments, const Variable &value, std::vector<Change> &out);
+static inline Path::Segment KeySegment(const crypt::string_type &key);
+static inline Path::Segment IndexSegment(size_t index);
+
+// the parent of the path's last segment, mutably
+static Variable &ResolveParent(Variable &target, const Path &path);
+
+namespace crypt
+{
+	std::vector<Change> Diff(const Variable &from, const Variable &to) {
+		std::vector<Change> changes{};
+		std::vector<Path::Segment> segments{};
+
+		DiffValues(from, to, segments, changes);
+		return changes;
+	}
+
+	void Patch(Variable &target, const std::vector<Change> &changes) {
+		for (const Change &change : changes)
+		{
+			const std::vector<Path::Segment> &segments = change.path.get_segments();
+
+			if (segments.empty())
+			{
+				target = change.value;
+				continue;
+			}
+
+			Variable &parent = ResolveParent(target, change.path);
+			const Path::Segment &last = segments.back();
+
+			if (!last.is_index)
+			{
+				table_type &table = parent._edit_table();
+
+				if (change.kind == ChangeKind::Removed)
+				{
+					table.erase(last.key);
+				}
+				else
+				{
+					table[last.key] = change.value;
+				}
+
+				continue;
+			}
+
+			list_type &list = parent._edit_list();
+
+			// additions are only ever at the end, removals from the end backwards
+			if (change.kind == ChangeKind::Added && last.index == list.size())
+			{
+				list.push_back(change.value);
+				continue;
+			}
+
+			if (last.index >= list.size())
+			{
+				throw VariableAccessError(change.path.to_string());
+			}
+
+			if (change.kind == ChangeKind::Removed)
+			{
+				list.erase(list.begin() + last.index);
+			}
+			else
+			{
+				list[last.index] = change.value;
+			}
+		}
+	}
+}
+
+void DiffValues(const Variable &from, const Variable &to, std::vector<Path::Segment> &segments, std::vector<Change> &out) {
+	if (from == to)
+	{
+		return;
+	}
+
+	if (from.get_type() == crypt::VariableType::Table && to.get_type() == crypt::VariableType::Table)
+	{
+		DiffTables(from.get_table(), to.get_table(), segments, out);
+		return;
+	}
+
+	if (from.is_list() && to.is_list())
+	{
+		DiffLists(from.get_list(), to.get_list(), segments, out);
+		return;
+	}
+
+	PushChange(ChangeKind::Modified, segments, to, out);
+}
+
+void DiffTables(const crypt::table_type &from, const crypt::table_type &to, std::vector<Path::Segment> &segments, std::vector<Change> &out) {
+	// both sorted, merge them
+	auto from_iter = from.begin();
+	auto to_iter = to.begin();
+
+	while (from_iter != from.end() || to_iter != to.end())
+	{
+		if (to_iter == to.end() || (from_iter != from.end() && from_iter->first < to_iter->first))
+		{
+			segments.push_back(KeySegment(from_iter->first));
+			PushChange(ChangeKind::Removed, segments, {}, out);
+			segments.pop_back();
+
+			++from_iter;
+			continue;
+		}
+
+		if (from_iter == from.end() || to_iter->first < from_iter->first)
+		{
+			segments.push_back(KeySegment(to_iter->first));
+			PushChange(ChangeKind::Added, segments, to_iter->second, out);
+			segments.pop_back();
+
+			++to_iter;
+			continue;
+		}
+
+		segments.push_back(KeySegment(to_iter->first));
+		DiffValues(from_iter->second, to_iter->second, segments, out);
+		segments.pop_back();
+
+		++from_iter;
+		++to_iter;
+	}
+}
+
+void DiffLists(const crypt::list_type &from, const crypt::list_type &to, std::vector<Path::Segment> &segments, std::vector<Change> &out) {
+	const size_t common = std::min(from.size(), to.size());
+
+	for (size_t i = 0; i < common; i++)
+	{
+		segments.push_back(IndexSegment(i));
+		DiffValues(from[i], to[i], segments, out);
+		segments.pop_back();
+	}
+
+	for (size_t i = common; i < to.size(); i++)
+	{
+		segments.push_back(IndexSegment(i));
+		PushChange(ChangeKind::Added, segments, to[i], out);
+		segments.pop_back();
+	}
+
+	// backwards, keeping the indices valid while patching
+	for (size_t i = from.size(); i > common; i--)
+	{
+		segments.push_back(IndexSegment(i - 1));
+		PushChange(ChangeKind::Removed, segments, {}, out);
+		segments.pop_back();
+	}
+}
+
+inline void PushChange(ChangeKind kind, const std::vector<Path::Segment> &segments, const Variable &value, std::vector<Change> &out) {
+	out.push_back({kind, Path(std::vector<Path::Segment>(segments)), value});
+}
+
+inline Path::Segment KeySegment(const crypt::string_type &key) {
+	Path::Segment segment{};
+	segment.key = key;
+	return segment;
+}
+
+inline Path::Segment IndexSegment(size_t index) {
+	Path::Segment segment{};
+	segment.index = index;
+	segment.is_index = true;
+	return segment;
+}
+
+Variable &ResolveParent(Variable &target, const Path &path) {
+	const std::vector<Path::Segment> &segments = path.get_segments();
+	Variable *current = &target;
+
+	for (size_t i = 0; i + 1 < segments.size(); i++)
+	{
+		const Path::Segment &segment = segments[i];
+
+		if (segment.is_index)
+		{
+			crypt::list_type &list = current->_edit_list();
+			if (segment.index >= list.size())
+			{
+				throw crypt::VariableAccessError(path.to_string());
+			}
+
+			current = &list[segment.index];
+			continue;
+		}
+
+		crypt::table_type &table = current->_edit_table();
+		const auto iter = table.find(segment.key);
+		if (iter == table.end())
+		{
+			throw crypt::VariableAccessError(path.to_string());
+		}
+
+		current = &iter->second;
+	}
+
+	return *current;
+}
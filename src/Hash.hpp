@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// 64-bit MurmurHash2 (MurmurHash64A), reads 8 bytes at a time
+static inline uint64_t HashBytes(const void *data, size_t length, uint64_t seed = 0) {
+	constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+	constexpr int r = 47;
+
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint64_t h = seed ^ (length * m);
+
+	const size_t blocks = length / 8;
+	for (size_t i = 0; i < blocks; i++)
+	{
+		uint64_t k;
+		memcpy(&k, bytes + i * 8, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	const uint8_t *tail = bytes + blocks * 8;
+	switch (length & 7)
+	{
+	case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+	case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+	case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+	case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+	case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+	case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+	case 1: h ^= uint64_t(tail[0]);
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
+
+// order dependent mix of `value` into `seed`
+static inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+	value *= 0x9ddfea08eb382d69ULL;
+	value ^= value >> 47;
+	return (seed ^ value) * 0xc6a4a7935bd1e995ULL + 0x9e3779b97f4a7c15ULL;
+}
@@ -0,0 +1,505 @@
+#include "CryptJson.hpp"
+#include "JsonScan.hpp"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+using crypt::JsonError;
+using crypt::Variable;
+
+// nesting deeper than this is rejected instead of risking the stack
+static constexpr size_t JsonMaxDepth = 512;
+
+// a json number `from_chars` found out of range for reals: infinite when too big, zero when too small
+static crypt::real_type SaturatedReal(const char *first, const char *last);
+
+class JsonReader
+{
+public:
+	inline JsonReader(const char *data, size_t length) : m_data{data}, m_length{length} {}
+
+	Variable read_document();
+
+private:
+	Variable _read_value();
+	Variable _read_object();
+	Variable _read_array();
+	Variable _read_number();
+	void _read_string(crypt::string_type &out);
+	void _read_literal(const char *literal, size_t length);
+	uint32_t _read_hex4();
+
+	inline void _skip_whitespace() {
+		m_pos += SkipJsonWhitespace(m_data + m_pos, m_length - m_pos);
+	}
+
+	inline bool _at_end() const noexcept { return m_pos >= m_length; }
+	inline char _peek() const noexcept { return m_pos < m_length ? m_data[m_pos] : '\0'; }
+
+	// skips whitespace and the expected char
+	void _expect(char value);
+
+	[[noreturn]] void _fail(const std::string &message) const;
+
+private:
+	const char *m_data;
+	size_t m_length;
+	size_t m_pos = 0;
+	size_t m_depth = 0;
+};
+
+// appends the utf-8 encoding of `codepoint`
+static inline void AppendUtf8(crypt::string_type &out, uint32_t codepoint);
+
+namespace crypt
+{
+	Variable LoadJson(const char_type *source, size_t length) {
+		if (length == 0 && source != nullptr)
+		{
+			length = strlen(source);
+		}
+
+		return JsonReader(source, length).read_document();
+	}
+}
+
+Variable JsonReader::read_document() {
+	Variable value = this->_read_value();
+
+	this->_skip_whitespace();
+	if (!this->_at_end())
+	{
+		this->_fail("unexpected data after the json value");
+	}
+
+	return value;
+}
+
+Variable JsonReader::_read_value() {
+	this->_skip_whitespace();
+
+	switch (this->_peek())
+	{
+	case '{':
+		return this->_read_object();
+	case '[':
+		return this->_read_array();
+	case '"':
+		{
+			crypt::string_type value{};
+			this->_read_string(value);
+			return Variable(std::move(value));
+		}
+	case 't':
+		this->_read_literal("true", 4);
+		return Variable(true);
+	case 'f':
+		this->_read_literal("false", 5);
+		return Variable(false);
+	case 'n':
+		this->_read_literal("null", 4);
+		return Variable();
+	case '-':
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		return this->_read_number();
+	default:
+		this->_fail(this->_at_end() ? "expected a json value, got the end" : "expected a json value");
+	}
+}
+
+Variable JsonReader::_read_object() {
+	if (++m_depth > JsonMaxDepth)
+	{
+		this->_fail("json nested too deep");
+	}
+
+	m_pos++; // '{'
+
+	Variable result{};
+	crypt::table_type &table = result._build_table();
+
+	this->_skip_whitespace();
+	if (this->_peek() == '}')
+	{
+		m_pos++;
+		m_depth--;
+		return result;
+	}
+
+	crypt::string_type key{};
+	for (;;)
+	{
+		this->_skip_whitespace();
+		if (this->_peek() != '"')
+		{
+			this->_fail("expected a string key");
+		}
+
+		key.clear();
+		this->_read_string(key);
+
+		this->_expect(':');
+		table.insert_or_assign(key, this->_read_value());
+
+		this->_skip_whitespace();
+		if (this->_peek() == ',')
+		{
+			m_pos++;
+			continue;
+		}
+
+		this->_expect('}');
+		break;
+	}
+
+	m_depth--;
+	return result;
+}
+
+Variable JsonReader::_read_array() {
+	if (++m_depth > JsonMaxDepth)
+	{
+		this->_fail("json nested too deep");
+	}
+
+	m_pos++; // '['
+
+	Variable result{};
+	crypt::list_type &list = result._build_list();
+
+	this->_skip_whitespace();
+	if (this->_peek() == ']')
+	{
+		m_pos++;
+		m_depth--;
+		return result;
+	}
+
+	for (;;)
+	{
+		list.emplace_back(this->_read_value());
+
+		this->_skip_whitespace();
+		if (this->_peek() == ',')
+		{
+			m_pos++;
+			continue;
+		}
+
+		this->_expect(']');
+		break;
+	}
+
+	m_depth--;
+	return result;
+}
+
+Variable JsonReader::_read_number() {
+	const size_t start = m_pos;
+	bool is_real = false;
+
+	// validate the json grammar first, from_chars accepts a superset of it
+	if (this->_peek() == '-')
+	{
+		m_pos++;
+	}
+
+	if (this->_peek() == '0')
+	{
+		m_pos++;
+	}
+	else if (this->_peek() >= '1' && this->_peek() <= '9')
+	{
+		while (this->_peek() >= '0' && this->_peek() <= '9')
+		{
+			m_pos++;
+		}
+	}
+	else
+	{
+		this->_fail("expected digits");
+	}
+
+	if (this->_peek() == '.')
+	{
+		is_real = true;
+		m_pos++;
+
+		if (!(this->_peek() >= '0' && this->_peek() <= '9'))
+		{
+			this->_fail("expected digits after the '.'");
+		}
+
+		while (this->_peek() >= '0' && this->_peek() <= '9')
+		{
+			m_pos++;
+		}
+	}
+
+	if (this->_peek() == 'e' || this->_peek() == 'E')
+	{
+		is_real = true;
+		m_pos++;
+
+		if (this->_peek() == '+' || this->_peek() == '-')
+		{
+			m_pos++;
+		}
+
+		if (!(this->_peek() >= '0' && this->_peek() <= '9'))
+		{
+			this->_fail("expected digits in the exponent");
+		}
+
+		while (this->_peek() >= '0' && this->_peek() <= '9')
+		{
+			m_pos++;
+		}
+	}
+
+	const char *first = m_data + start;
+	const char *last = m_data + m_pos;
+
+	if (!is_real)
+	{
+		crypt::int_type value = 0;
+		const std::from_chars_result result = std::from_chars(first, last, value);
+
+		if (result.ec == std::errc())
+		{
+			return Variable(value);
+		}
+
+		// too big for an int, fall back to a real
+	}
+
+	crypt::real_type value = 0;
+	const std::from_chars_result result = std::from_chars(first, last, value);
+
+	if (result.ec == std::errc::result_out_of_range)
+	{
+		// `value` is left untouched, saturate it instead
+		return Variable(SaturatedReal(first, last));
+	}
+
+	if (result.ec != std::errc())
+	{
+		this->_fail("invalid number");
+	}
+
+	return Variable(value);
+}
+
+crypt::real_type SaturatedReal(const char *first, const char *last) {
+	const bool negative = *first == '-';
+
+	double wide = 0;
+	if (std::from_chars(first, last, wide).ec == std::errc())
+	{
+		if (std::fabs(wide) <= std::numeric_limits<crypt::real_type>::max())
+		{
+			return static_cast<crypt::real_type>(wide);
+		}
+	}
+	else
+	{
+		// out of range for doubles too: a negative exponent underflows, anything else overflows
+		const char *exponent = std::find_if(first, last, [](char value) { return value == 'e' || value == 'E'; });
+		if (exponent != last && exponent[1] == '-')
+		{
+			return negative ? -0.0f : 0.0f;
+		}
+	}
+
+	const crypt::real_type infinity = std::numeric_limits<crypt::real_type>::infinity();
+	return negative ? -infinity : infinity;
+}
+
+void JsonReader::_read_string(crypt::string_type &out) {
+	m_pos++; // '"'
+
+	for (;;)
+	{
+		// copy the plain run up to the next quote/escape in one go
+		const size_t run = FindJsonStringSpecial(m_data + m_pos, m_length - m_pos);
+		out.append(m_data + m_pos, run);
+		m_pos += run;
+
+		if (this->_at_end())
+		{
+			this->_fail("unterminated string");
+		}
+
+		const char special = m_data[m_pos++];
+		if (special == '"')
+		{
+			return;
+		}
+
+		if (special != '\\')
+		{
+			m_pos--;
+			this->_fail("control char in string");
+		}
+
+		if (this->_at_end())
+		{
+			this->_fail("unterminated string");
+		}
+
+		const char escaped = m_data[m_pos++];
+		switch (escaped)
+		{
+		case '"':
+		case '\\':
+		case '/':
+			out.push_back(escaped);
+			break;
+		case 'b':
+			out.push_back('\b');
+			break;
+		case 'f':
+			out.push_back('\f');
+			break;
+		case 'n':
+			out.push_back('\n');
+			break;
+		case 'r':
+			out.push_back('\r');
+			break;
+		case 't':
+			out.push_back('\t');
+			break;
+		case 'u':
+			{
+				uint32_t codepoint = this->_read_hex4();
+
+				// a high surrogate followed by a low one encodes a single codepoint,
+				// lone surrogates are kept as is (like most decoders do)
+				if (codepoint >= 0xD800 && codepoint <= 0xDBFF && m_pos + 6 <= m_length &&
+						m_data[m_pos] == '\\' && m_data[m_pos + 1] == 'u')
+				{
+					const size_t high_end = m_pos;
+					m_pos += 2;
+
+					const uint32_t low = this->_read_hex4();
+					if (low >= 0xDC00 && low <= 0xDFFF)
+					{
+						codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					else
+					{
+						m_pos = high_end;
+					}
+				}
+
+				AppendUtf8(out, codepoint);
+			}
+			break;
+		default:
+			m_pos--;
+			this->_fail("invalid escape");
+		}
+	}
+}
+
+void JsonReader::_read_literal(const char *literal, size_t length) {
+	if (m_length - m_pos < length || memcmp(m_data + m_pos, literal, length) != 0)
+	{
+		this->_fail(std::string("expected '") + literal + "'");
+	}
+
+	m_pos += length;
+}
+
+uint32_t JsonReader::_read_hex4() {
+	if (m_length - m_pos < 4)
+	{
+		this->_fail("expected 4 hex digits");
+	}
+
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; i++)
+	{
+		const char digit = m_data[m_pos++];
+		value <<= 4;
+
+		if (digit >= '0' && digit <= '9')
+		{
+			value |= digit - '0';
+		}
+		else if (digit >= 'a' && digit <= 'f')
+		{
+			value |= digit - 'a' + 10;
+		}
+		else if (digit >= 'A' && digit <= 'F')
+		{
+			value |= digit - 'A' + 10;
+		}
+		else
+		{
+			m_pos--;
+			this->_fail("expected 4 hex digits");
+		}
+	}
+
+	return value;
+}
+
+void JsonReader::_expect(char value) {
+	this->_skip_whitespace();
+
+	if (this->_peek() != value || this->_at_end())
+	{
+		this->_fail(std::string("expected '") + value + "'");
+	}
+
+	m_pos++;
+}
+
+void JsonReader::_fail(const std::string &message) const {
+	// positions are only worked out for errors, keeping the happy path free of line tracking
+	size_t line = 1;
+	size_t line_start = 0;
+	const size_t end = m_pos < m_length ? m_pos : m_length;
+
+	for (size_t i = 0; i < end; i++)
+	{
+		if (m_data[i] == '\n')
+		{
+			line++;
+			line_start = i + 1;
+		}
+	}
+
+	throw JsonError(message, line, end - line_start + 1);
+}
+
+inline void AppendUtf8(crypt::string_type &out, uint32_t codepoint) {
+	if (codepoint < 0x80)
+	{
+		out.push_back(static_cast<char>(codepoint));
+	}
+	else if (codepoint < 0x800)
+	{
+		out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+	else if (codepoint < 0x10000)
+	{
+		out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+	else
+	{
+		out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Simd.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// chars that end a run of plain string content: the quote, the escape and control chars
+static inline bool IsJsonStringSpecial(uint8_t value) {
+	return value == '"' || value == '\\' || value < 0x20;
+}
+
+static inline bool IsJsonWhitespace(uint8_t value) {
+	return value == ' ' || value == '\n' || value == '\r' || value == '\t';
+}
+
+// index of the first string special char in `data`, `length` if there is none
+static inline size_t FindJsonStringSpecial(const char *data, size_t length) {
+	size_t index = 0;
+
+#if CRYPT_SIMD_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control_max = _mm_set1_epi8(0x1F);
+
+	for (; index + 16 <= length; index += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+
+		// unsigned `chunk <= 0x1F` is `max(chunk, 0x1F) == 0x1F`
+		const __m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max)
+		);
+
+		const int mask = _mm_movemask_epi8(special);
+		if (mask != 0)
+		{
+			return index + simd::FirstSetBit(mask);
+		}
+	}
+#endif
+
+	for (; index < length; index++)
+	{
+		if (IsJsonStringSpecial(static_cast<uint8_t>(data[index])))
+		{
+			return index;
+		}
+	}
+
+	return length;
+}
+
+// index of the first non-whitespace char in `data`, `length` if there is none
+static inline size_t SkipJsonWhitespace(const char *data, size_t length) {
+	size_t index = 0;
+
+	// most gaps are a single space or none, check a few before going wide
+	for (; index < length && index < 4; index++)
+	{
+		if (!IsJsonWhitespace(static_cast<uint8_t>(data[index])))
+		{
+			return index;
+		}
+	}
+
+#if CRYPT_SIMD_SSE2
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriage = _mm_set1_epi8('\r');
+	const __m128i tab = _mm_set1_epi8('\t');
+
+	for (; index + 16 <= length; index += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+
+		const __m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, carriage), _mm_cmpeq_epi8(chunk, tab))
+		);
+
+		const int mask = ~_mm_movemask_epi8(whitespace) & 0xFFFF;
+		if (mask != 0)
+		{
+			return index + simd::FirstSetBit(mask);
+		}
+	}
+#endif
+
+	for (; index < length; index++)
+	{
+		if (!IsJsonWhitespace(static_cast<uint8_t>(data[index])))
+		{
+			return index;
+		}
+	}
+
+	return length;
+}
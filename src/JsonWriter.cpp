@@ -0,0 +1,240 @@
+#include "CryptJson.hpp"
+#include "JsonScan.hpp"
+#include "TextWriter.hpp"
+
+#include <cmath>
+
+using crypt::SerializeOptions;
+using crypt::Variable;
+using crypt::VariableType;
+
+class JsonWriter
+{
+public:
+	inline JsonWriter(crypt::Sink &sink, const SerializeOptions &options)
+		: m_writer{sink}, m_options{options} {
+	}
+
+	void write_value(const Variable &value, size_t depth);
+
+private:
+	void _write_string(const crypt::string_type &value);
+	void _write_real(crypt::real_type value);
+	void _write_object(const crypt::table_type &table, size_t depth);
+	void _write_array(const crypt::list_type &list, size_t depth);
+	template <typename T>
+	void _write_packed(crypt::Span<T> values, size_t depth);
+
+	// separates elements, on their own indented lines when pretty
+	void _separate(bool first, size_t depth);
+	// empty containers are closed right after being opened
+	void _close(char bracket, bool empty, size_t depth);
+
+private:
+	TextWriter m_writer;
+	const SerializeOptions &m_options;
+};
+
+static constexpr char HexDigits[] = "0123456789abcdef";
+
+namespace crypt
+{
+	void SerializeJson(const Variable &value, Sink &sink, const SerializeOptions &options) {
+		JsonWriter(sink, options).write_value(value, 0);
+	}
+
+	void SerializeJson(const Variable &value, string_type &out, const SerializeOptions &options) {
+		StringSink sink{out};
+		SerializeJson(value, sink, options);
+	}
+
+	string_type SerializeJson(const Variable &value, const SerializeOptions &options) {
+		string_type result{};
+		SerializeJson(value, result, options);
+		return result;
+	}
+}
+
+void JsonWriter::write_value(const Variable &value, size_t depth) {
+	switch (value.get_type())
+	{
+	case VariableType::Null:
+		m_writer.write("null");
+		break;
+	case VariableType::Bool:
+		if (value.get_bool())
+		{
+			m_writer.write("true");
+		}
+		else
+		{
+			m_writer.write("false");
+		}
+		break;
+	case VariableType::Int:
+		m_writer.write_int(value.get_int());
+		break;
+	case VariableType::Real:
+		this->_write_real(value.get_real());
+		break;
+	case VariableType::Str:
+		this->_write_string(value.get_string());
+		break;
+	case VariableType::List:
+		this->_write_array(value.get_list(), depth);
+		break;
+	case VariableType::Table:
+		this->_write_object(value.get_table(), depth);
+		break;
+	case VariableType::IntArray:
+		this->_write_packed(value.get_int_array(), depth);
+		break;
+	case VariableType::RealArray:
+		this->_write_packed(value.get_real_array(), depth);
+		break;
+	}
+}
+
+void JsonWriter::_write_string(const crypt::string_type &value) {
+	m_writer.put('"');
+
+	const char *data = value.data();
+	size_t left = value.size();
+
+	for (;;)
+	{
+		const size_t run = FindJsonStringSpecial(data, left);
+		m_writer.write(data, run);
+
+		if (run == left)
+		{
+			break;
+		}
+
+		const uint8_t special = static_cast<uint8_t>(data[run]);
+		m_writer.put('\\');
+
+		switch (special)
+		{
+		case '"':
+		case '\\':
+			m_writer.put(static_cast<char>(special));
+			break;
+		case '\b':
+			m_writer.put('b');
+			break;
+		case '\f':
+			m_writer.put('f');
+			break;
+		case '\n':
+			m_writer.put('n');
+			break;
+		case '\r':
+			m_writer.put('r');
+			break;
+		case '\t':
+			m_writer.put('t');
+			break;
+		default:
+			m_writer.write("u00");
+			m_writer.put(HexDigits[special >> 4]);
+			m_writer.put(HexDigits[special & 0xF]);
+			break;
+		}
+
+		data += run + 1;
+		left -= run + 1;
+	}
+
+	m_writer.put('"');
+}
+
+void JsonWriter::_write_real(crypt::real_type value) {
+	if (!std::isfinite(value))
+	{
+		throw std::domain_error("json can't represent infinite or nan reals");
+	}
+
+	m_writer.write_real(value, true, true);
+}
+
+void JsonWriter::_write_object(const crypt::table_type &table, size_t depth) {
+	m_writer.put('{');
+
+	bool first = true;
+	for (const auto &[key, value] : table)
+	{
+		this->_separate(first, depth);
+		this->_write_string(key);
+
+		if (m_options.pretty)
+		{
+			m_writer.write(": ");
+		}
+		else
+		{
+			m_writer.put(':');
+		}
+
+		this->write_value(value, depth + 1);
+		first = false;
+	}
+
+	this->_close('}', table.empty(), depth);
+}
+
+void JsonWriter::_write_array(const crypt::list_type &list, size_t depth) {
+	m_writer.put('[');
+
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		this->_separate(i == 0, depth);
+		this->write_value(list[i], depth + 1);
+	}
+
+	this->_close(']', list.empty(), depth);
+}
+
+template <typename T>
+void JsonWriter::_write_packed(crypt::Span<T> values, size_t depth) {
+	m_writer.put('[');
+
+	for (size_t i = 0; i < values.size; i++)
+	{
+		this->_separate(i == 0, depth);
+
+		if constexpr (std::is_same_v<T, crypt::real_type>)
+		{
+			this->_write_real(values[i]);
+		}
+		else
+		{
+			m_writer.write_int(values[i]);
+		}
+	}
+
+	this->_close(']', values.empty(), depth);
+}
+
+void JsonWriter::_separate(bool first, size_t depth) {
+	if (!first)
+	{
+		m_writer.put(',');
+	}
+
+	if (m_options.pretty)
+	{
+		m_writer.put('\n');
+		m_writer.repeat(m_options.indent_char, (depth + 1) * m_options.indent_width);
+	}
+}
+
+void JsonWriter::_close(char bracket, bool empty, size_t depth) {
+	if (m_options.pretty && !empty)
+	{
+		m_writer.put('\n');
+		m_writer.repeat(m_options.indent_char, depth * m_options.indent_width);
+	}
+
+	m_writer.put(bracket);
+}
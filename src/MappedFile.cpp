@@ -0,0 +1,157 @@
+#include "MappedFile.hpp"
+
+#include <utility>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char *path) {
+	HANDLE file = CreateFileA(
+		path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error(std::string("can't open file: ") + path);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error(std::string("can't stat file: ") + path);
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	// empty files can't be mapped, they are exposed as an empty range instead
+	if (m_size == 0)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+
+	if (m_mapping == nullptr)
+	{
+		throw std::runtime_error(std::string("can't map file: ") + path);
+	}
+
+	m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		throw std::runtime_error(std::string("can't map file: ") + path);
+	}
+}
+
+void MappedFile::_unmap() noexcept {
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	m_data = nullptr;
+	m_mapping = nullptr;
+	m_size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const char *path) {
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error(std::string("can't open file: ") + path);
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		throw std::runtime_error(std::string("can't stat file: ") + path);
+	}
+
+	m_size = static_cast<size_t>(info.st_size);
+
+	// empty files can't be mapped, they are exposed as an empty range instead
+	if (m_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void *address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+
+	if (address == MAP_FAILED)
+	{
+		m_size = 0;
+		throw std::runtime_error(std::string("can't map file: ") + path);
+	}
+
+	m_data = static_cast<const uint8_t *>(address);
+}
+
+void MappedFile::_unmap() noexcept {
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	this->_unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&move) noexcept
+	: m_data{move.m_data}, m_size{move.m_size}
+#ifdef _WIN32
+	, m_mapping{move.m_mapping}
+#endif
+{
+	move.m_data = nullptr;
+	move.m_size = 0;
+#ifdef _WIN32
+	move.m_mapping = nullptr;
+#endif
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&move) noexcept {
+	if (this != &move)
+	{
+		this->_unmap();
+		std::swap(m_data, move.m_data);
+		std::swap(m_size, move.m_size);
+#ifdef _WIN32
+		std::swap(m_mapping, move.m_mapping);
+#endif
+	}
+
+	return *this;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	// throws std::runtime_error if the file can't be opened or mapped
+	explicit MappedFile(const char *path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	MappedFile(MappedFile &&move) noexcept;
+	MappedFile &operator=(MappedFile &&move) noexcept;
+
+	inline const uint8_t *data() const noexcept { return m_data; }
+	inline size_t size() const noexcept { return m_size; }
+
+private:
+	void _unmap() noexcept;
+
+private:
+	const uint8_t *m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void *m_mapping = nullptr;
+#endif
+};
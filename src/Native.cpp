@@ -0,0 +1,47 @@
+#include "CryptNative.hpp"
+
+#include <stdexcept>
+
+namespace crypt
+{
+	void _NativeTypeError(const char *expected, const Variable &value) {
+		const char *got = "?";
+		switch (value.get_type())
+		{
+		case VariableType::Null:
+			got = "null";
+			break;
+		case VariableType::Bool:
+			got = "bool";
+			break;
+		case VariableType::Int:
+			got = "int";
+			break;
+		case VariableType::Real:
+			got = "real";
+			break;
+		case VariableType::Str:
+			got = "string";
+			break;
+		case VariableType::List:
+			got = "list";
+			break;
+		case VariableType::Table:
+			got = "table";
+			break;
+		case VariableType::IntArray:
+			got = "int array";
+			break;
+		case VariableType::RealArray:
+			got = "real array";
+			break;
+		}
+
+		throw std::invalid_argument(std::string("expected ") + expected + " argument, got " + got);
+	}
+
+	const NativeFunction *NativeRegistry::find(const string_type &name) const {
+		const auto found = m_functions.find(name);
+		return found != m_functions.end() ? &found->second : nullptr;
+	}
+}
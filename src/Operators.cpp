@@ -0,0 +1,324 @@
+#include "Operators.hpp"
+
+using crypt::Variable;
+using crypt::VariableType;
+
+static inline const char *TypeName(VariableType type);
+[[noreturn]] static void UnsupportedOperands(OpCode op, const Variable &left, const Variable &right);
+
+static Variable ApplyIntBinary(OpCode op, CryptInt left, CryptInt right);
+static Variable ApplyRealBinary(OpCode op, CryptReal left, CryptReal right);
+// -1, 0 or 1
+template <typename T>
+static inline int Compare(const T &left, const T &right) {
+	return left < right ? -1 : (right < left ? 1 : 0);
+}
+static inline bool OrderingHolds(OpCode op, int order);
+
+bool IsTruthy(const Variable &value) {
+	switch (value.get_type())
+	{
+	case VariableType::Null:
+		return false;
+	case VariableType::Bool:
+		return value.get_bool();
+	case VariableType::Int:
+		return value.get_int() != 0;
+	case VariableType::Real:
+		return value.get_real() != 0;
+	case VariableType::Str:
+		return !value.get_string().empty();
+	case VariableType::List:
+		return !value.get_list().empty();
+	case VariableType::Table:
+		return !value.get_table().empty();
+	case VariableType::IntArray:
+		return !value.get_int_array().empty();
+	case VariableType::RealArray:
+		return !value.get_real_array().empty();
+	}
+
+	return false;
+}
+
+Variable ApplyBinary(OpCode op, const Variable &left, const Variable &right) {
+	const VariableType left_type = left.get_type();
+	const VariableType right_type = right.get_type();
+
+	if (left_type == VariableType::Int && right_type == VariableType::Int)
+	{
+		return ApplyIntBinary(op, left.get_int(), right.get_int());
+	}
+
+	if (IsNumber(left) && IsNumber(right))
+	{
+		return ApplyRealBinary(op, left.get_real(), right.get_real());
+	}
+
+	switch (op)
+	{
+	case OpCode::Equal:
+		return Variable(left == right);
+	case OpCode::NotEqual:
+		return Variable(left != right);
+	case OpCode::Add:
+		if (left_type == VariableType::Str && right_type == VariableType::Str)
+		{
+			CryptString result{};
+			result.reserve(left.get_string().size() + right.get_string().size());
+			result.append(left.get_string()).append(right.get_string());
+			return Variable(std::move(result));
+		}
+		break;
+	case OpCode::Less:
+	case OpCode::LessEqual:
+	case OpCode::Greater:
+	case OpCode::GreaterEqual:
+		if (left_type == VariableType::Str && right_type == VariableType::Str)
+		{
+			const int order = left.get_string().compare(right.get_string());
+			return Variable(OrderingHolds(op, order < 0 ? -1 : (order > 0 ? 1 : 0)));
+		}
+		break;
+	default:
+		break;
+	}
+
+	UnsupportedOperands(op, left, right);
+}
+
+Variable ApplyUnary(OpCode op, const Variable &value) {
+	switch (op)
+	{
+	case OpCode::Not:
+		return Variable(!IsTruthy(value));
+	case OpCode::Negate:
+		if (value.get_type() == VariableType::Int)
+		{
+			return Variable(WrapSub(0, value.get_int()));
+		}
+
+		if (value.get_type() == VariableType::Real)
+		{
+			return Variable(-value.get_real());
+		}
+		break;
+	case OpCode::BitNot:
+		if (value.get_type() == VariableType::Int)
+		{
+			return Variable(static_cast<CryptInt>(~value.get_int()));
+		}
+		break;
+	default:
+		break;
+	}
+
+	throw std::invalid_argument(
+		std::string("unsupported operand type for ") + GetOpCodeName(op) + ": " + TypeName(value.get_type())
+	);
+}
+
+const Variable *FindField(const Variable &value, const CryptString &key) {
+	if (value.get_type() != VariableType::Table)
+	{
+		throw std::invalid_argument("can't read field '" + key + "' of " + TypeName(value.get_type()));
+	}
+
+	const crypt::table_type &table = value.get_table();
+	const auto found = table.find(key);
+	return found != table.end() ? &found->second : nullptr;
+}
+
+Variable &WriteField(Variable &root, const std::vector<CryptString> &path) {
+	Variable *current = &root;
+
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (current->get_type() != VariableType::Table)
+		{
+			throw std::invalid_argument("can't set field '" + path[i] + "' of " + TypeName(current->get_type()));
+		}
+
+		// copies the table first when it's shared
+		crypt::table_type &table = current->_edit_table();
+
+		if (i + 1 == path.size())
+		{
+			return table[path[i]];
+		}
+
+		const auto found = table.find(path[i]);
+		if (found == table.end())
+		{
+			throw std::invalid_argument("can't set field '" + path[i + 1] + "' of null");
+		}
+
+		current = &found->second;
+	}
+
+	return *current;
+}
+
+Variable ApplyIntBinary(OpCode op, CryptInt left, CryptInt right) {
+	switch (op)
+	{
+	case OpCode::Add:
+		return Variable(WrapAdd(left, right));
+	case OpCode::Sub:
+		return Variable(WrapSub(left, right));
+	case OpCode::Mul:
+		return Variable(WrapMul(left, right));
+	case OpCode::Div:
+		if (right == 0)
+		{
+			throw std::domain_error("int division by zero");
+		}
+
+		// the one overflowing division wraps like the other ops
+		if (right == -1)
+		{
+			return Variable(WrapSub(0, left));
+		}
+
+		return Variable(static_cast<CryptInt>(left / right));
+	case OpCode::BitAnd:
+		return Variable(static_cast<CryptInt>(left & right));
+	case OpCode::BitOr:
+		return Variable(static_cast<CryptInt>(left | right));
+	case OpCode::Equal:
+		return Variable(left == right);
+	case OpCode::NotEqual:
+		return Variable(left != right);
+	default:
+		return Variable(OrderingHolds(op, Compare(left, right)));
+	}
+}
+
+Variable ApplyRealBinary(OpCode op, CryptReal left, CryptReal right) {
+	switch (op)
+	{
+	case OpCode::Add:
+		return Variable(left + right);
+	case OpCode::Sub:
+		return Variable(left - right);
+	case OpCode::Mul:
+		return Variable(left * right);
+	case OpCode::Div:
+		return Variable(left / right);
+	case OpCode::Equal:
+		return Variable(left == right);
+	case OpCode::NotEqual:
+		return Variable(left != right);
+	case OpCode::Less:
+		return Variable(left < right);
+	case OpCode::LessEqual:
+		return Variable(left <= right);
+	case OpCode::Greater:
+		return Variable(left > right);
+	case OpCode::GreaterEqual:
+		return Variable(left >= right);
+	default:
+		throw std::invalid_argument(std::string("unsupported operand types for ") + GetOpCodeName(op) + ": real");
+	}
+}
+
+inline bool OrderingHolds(OpCode op, int order) {
+	switch (op)
+	{
+	case OpCode::Less:
+		return order < 0;
+	case OpCode::LessEqual:
+		return order <= 0;
+	case OpCode::Greater:
+		return order > 0;
+	case OpCode::GreaterEqual:
+		return order >= 0;
+	default:
+		return false;
+	}
+}
+
+inline const char *TypeName(VariableType type) {
+	switch (type)
+	{
+	case VariableType::Null:
+		return "null";
+	case VariableType::Bool:
+		return "bool";
+	case VariableType::Int:
+		return "int";
+	case VariableType::Real:
+		return "real";
+	case VariableType::Str:
+		return "string";
+	case VariableType::List:
+		return "list";
+	case VariableType::Table:
+		return "table";
+	case VariableType::IntArray:
+		return "int array";
+	case VariableType::RealArray:
+		return "real array";
+	}
+
+	return "?";
+}
+
+void UnsupportedOperands(OpCode op, const Variable &left, const Variable &right) {
+	throw std::invalid_argument(
+		std::string("unsupported operand types for ") + GetOpCodeName(op) + ": " +
+		TypeName(left.get_type()) + " and " + TypeName(right.get_type())
+	);
+}
+
+OpCode UnaryOpCode(TokenType op) {
+	switch (op)
+	{
+	case TokenType::SubOp:
+		return OpCode::Negate;
+	case TokenType::BitNotOp:
+		return OpCode::BitNot;
+	case TokenType::NotOp:
+		return OpCode::Not;
+	default:
+		throw std::logic_error("not a unary operator");
+	}
+}
+
+OpCode BinaryOpCode(TokenType op) {
+	switch (op)
+	{
+	case TokenType::AddOp:
+	case TokenType::AddEqOp:
+		return OpCode::Add;
+	case TokenType::SubOp:
+	case TokenType::SubEqOp:
+		return OpCode::Sub;
+	case TokenType::MulOp:
+	case TokenType::MulEqOp:
+		return OpCode::Mul;
+	case TokenType::DivOp:
+	case TokenType::DivEqOp:
+		return OpCode::Div;
+	case TokenType::BitAndOp:
+	case TokenType::BitAndEqOp:
+		return OpCode::BitAnd;
+	case TokenType::BitOrOp:
+	case TokenType::BitOrEqOp:
+		return OpCode::BitOr;
+	case TokenType::EqualityOp:
+		return OpCode::Equal;
+	case TokenType::InEqualityOp:
+		return OpCode::NotEqual;
+	case TokenType::LessOp:
+		return OpCode::Less;
+	case TokenType::LessEqOp:
+		return OpCode::LessEqual;
+	case TokenType::GreaterOp:
+		return OpCode::Greater;
+	case TokenType::GreaterEqOp:
+		return OpCode::GreaterEqual;
+	default:
+		throw std::logic_error("not a binary operator");
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Bytecode.hpp"
+
+// script operator semantics, shared by the vm and the compiler's constant folding
+
+// null, false, zeros and empty strings/lists/tables are falsy
+bool IsTruthy(const crypt::Variable &value);
+
+// one of the binary ops (`Add` through `GreaterEqual`):
+// ints stay ints (wrapping on overflow) unless mixed with reals, `+` also concatenates strings,
+// comparisons order numbers and strings, equality is deep (with ints equal to the same reals);
+// throws std::invalid_argument on unsupported operand types and std::domain_error on int division by zero
+crypt::Variable ApplyBinary(OpCode op, const crypt::Variable &left, const crypt::Variable &right);
+// `Negate`, `Not` or `BitNot`, throws std::invalid_argument on unsupported operand types
+crypt::Variable ApplyUnary(OpCode op, const crypt::Variable &value);
+
+// the field `key` of a table, nullptr when it has none;
+// throws std::invalid_argument when `value` isn't a table
+const crypt::Variable *FindField(const crypt::Variable &value, const CryptString &key);
+// the field at the end of `path` for writing, the last one is added (as null) when missing;
+// throws std::invalid_argument when a step isn't a table (missing steps are null)
+crypt::Variable &WriteField(crypt::Variable &root, const std::vector<CryptString> &path);
+
+// the opcodes of the operator tokens, compound assignments (`+=`...) map to their binary op
+OpCode UnaryOpCode(TokenType op);
+OpCode BinaryOpCode(TokenType op);
+
+static inline bool IsNumber(const crypt::Variable &value) {
+	return value.get_type() == crypt::VariableType::Int || value.get_type() == crypt::VariableType::Real;
+}
+
+// wrapping int arithmetic, signed overflow is undefined
+static inline CryptInt WrapAdd(CryptInt left, CryptInt right) {
+	return static_cast<CryptInt>(static_cast<uintptr_t>(left) + static_cast<uintptr_t>(right));
+}
+
+static inline CryptInt WrapSub(CryptInt left, CryptInt right) {
+	return static_cast<CryptInt>(static_cast<uintptr_t>(left) - static_cast<uintptr_t>(right));
+}
+
+static inline CryptInt WrapMul(CryptInt left, CryptInt right) {
+	return static_cast<CryptInt>(static_cast<uintptr_t>(left) * static_cast<uintptr_t>(right));
+}
@@ -0,0 +1,367 @@
+#include "Optimizer.hpp"
+#include "Operators.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+using crypt::Variable;
+
+class Optimizer
+{
+public:
+	inline Optimizer(crypt::ScriptStats &stats, const crypt::NativeRegistry *natives)
+		: m_stats{stats}, m_natives{natives} {
+	}
+
+	void optimize(Symbol &root);
+
+private:
+	void _optimize_block(Symbol &block);
+	void _optimize_statement(Symbol &statement);
+	void _optimize_if(Symbol &branch);
+	void _optimize_while(Symbol &loop);
+
+	void _fold(Symbol &expression);
+	void _fold_unary(Symbol &unary);
+	void _fold_binary(Symbol &binary);
+	// calls of pure natives with constant arguments
+	void _fold_call(Symbol &call);
+
+	// counts the assignments of every name, anywhere in the script
+	void _count_assignments(const Symbol &symbol);
+
+	static inline bool IsConstant(const Symbol &symbol) { return symbol.type == SymbolType::Value; }
+	static void MakeConstant(Symbol &symbol, Variable &&value);
+
+private:
+	crypt::ScriptStats &m_stats;
+	const crypt::NativeRegistry *m_natives;
+
+	// the functions the script declares, which take precedence over natives
+	std::unordered_set<CryptString> m_functions;
+
+	std::unordered_map<CryptString, size_t> m_assignment_counts;
+	// top-level constants known at the current statement, null inside functions
+	// which can run before the constants are assigned
+	std::unordered_map<CryptString, Variable> *m_constants = nullptr;
+};
+
+void OptimizeScript(Symbol &root, crypt::ScriptStats &stats, const crypt::NativeRegistry *natives) {
+	Optimizer(stats, natives).optimize(root);
+}
+
+void Optimizer::optimize(Symbol &root) {
+	this->_count_assignments(root);
+
+	for (const Symbol &statement : root.children)
+	{
+		if (statement.type == SymbolType::Function)
+		{
+			m_functions.insert(statement.name);
+		}
+	}
+
+	std::unordered_map<CryptString, Variable> constants{};
+
+	for (Symbol &statement : root.children)
+	{
+		if (statement.type == SymbolType::Function)
+		{
+			m_constants = nullptr;
+			this->_optimize_block(statement.children.back());
+			continue;
+		}
+
+		m_constants = &constants;
+		this->_optimize_statement(statement);
+
+		// only straight-line top-level assignments are known to have happened for the code after them
+		if (statement.type == SymbolType::Assign && statement.op == TokenType::AssignOp &&
+				m_assignment_counts[statement.name] == 1 && IsConstant(statement.children[0]))
+		{
+			constants.emplace(statement.name, statement.children[0].value);
+		}
+	}
+
+	m_constants = nullptr;
+}
+
+void Optimizer::_optimize_block(Symbol &block) {
+	for (Symbol &statement : block.children)
+	{
+		this->_optimize_statement(statement);
+	}
+}
+
+void Optimizer::_optimize_statement(Symbol &statement) {
+	switch (statement.type)
+	{
+	case SymbolType::Assign:
+	case SymbolType::Return:
+		for (Symbol &child : statement.children)
+		{
+			this->_fold(child);
+		}
+		break;
+	case SymbolType::AssignField:
+		// the rest of the children are field names
+		this->_fold(statement.children[0]);
+		break;
+	case SymbolType::If:
+		this->_optimize_if(statement);
+		break;
+	case SymbolType::While:
+		this->_optimize_while(statement);
+		break;
+	case SymbolType::Block:
+		this->_optimize_block(statement);
+		break;
+	case SymbolType::Function:
+		break;
+	default:
+		this->_fold(statement);
+		break;
+	}
+}
+
+void Optimizer::_optimize_if(Symbol &branch) {
+	std::vector<Symbol> arms{};
+	const size_t count = branch.children.size();
+
+	size_t index = 0;
+	for (; index + 1 < count; index += 2)
+	{
+		Symbol &condition = branch.children[index];
+		this->_fold(condition);
+
+		if (!IsConstant(condition))
+		{
+			arms.push_back(std::move(condition));
+			arms.push_back(std::move(branch.children[index + 1]));
+			continue;
+		}
+
+		if (!IsTruthy(condition.value))
+		{
+			m_stats.removed_branches++;
+			continue;
+		}
+
+		// always taken: it becomes the `else` and everything after it is unreachable
+		arms.push_back(std::move(branch.children[index + 1]));
+		m_stats.removed_branches += (count - index - 2) / 2 + (count - index - 2) % 2;
+		index = count;
+		break;
+	}
+
+	// the original `else`, when no arm was always taken
+	if (index < count)
+	{
+		arms.push_back(std::move(branch.children.back()));
+	}
+
+	branch.children = std::move(arms);
+
+	// no condition left, the statement is its `else` block (or nothing)
+	if (branch.children.size() <= 1)
+	{
+		Symbol block{};
+		if (!branch.children.empty())
+		{
+			block = std::move(branch.children[0]);
+		}
+
+		block.type = SymbolType::Block;
+		block.pos = branch.pos;
+		branch = std::move(block);
+
+		this->_optimize_block(branch);
+		return;
+	}
+
+	for (Symbol &child : branch.children)
+	{
+		if (child.type == SymbolType::Block)
+		{
+			this->_optimize_block(child);
+		}
+	}
+}
+
+void Optimizer::_optimize_while(Symbol &loop) {
+	this->_fold(loop.children[0]);
+
+	// a loop that never runs
+	if (IsConstant(loop.children[0]) && !IsTruthy(loop.children[0].value))
+	{
+		Symbol block{};
+		block.type = SymbolType::Block;
+		block.pos = loop.pos;
+		loop = std::move(block);
+
+		m_stats.removed_branches++;
+		return;
+	}
+
+	this->_optimize_block(loop.children[1]);
+}
+
+void Optimizer::_fold(Symbol &expression) {
+	switch (expression.type)
+	{
+	case SymbolType::Identifier:
+		if (m_constants != nullptr)
+		{
+			const auto found = m_constants->find(expression.name);
+			if (found != m_constants->end())
+			{
+				const Variable value = found->second;
+				MakeConstant(expression, Variable(value));
+				m_stats.propagated_constants++;
+			}
+		}
+		break;
+	case SymbolType::Unary:
+		this->_fold_unary(expression);
+		break;
+	case SymbolType::Binary:
+		this->_fold_binary(expression);
+		break;
+	case SymbolType::Call:
+		this->_fold_call(expression);
+		break;
+	case SymbolType::Field:
+		this->_fold(expression.children[0]);
+
+		// fields of table literals, non-tables are left for the vm to report
+		if (IsConstant(expression.children[0]) && expression.children[0].value.get_type() == crypt::VariableType::Table)
+		{
+			const Variable *field = FindField(expression.children[0].value, expression.name);
+			MakeConstant(expression, field ? Variable(*field) : Variable());
+			m_stats.folded_expressions++;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void Optimizer::_fold_call(Symbol &call) {
+	for (Symbol &argument : call.children)
+	{
+		this->_fold(argument);
+	}
+
+	if (m_natives == nullptr || m_functions.count(call.name) != 0)
+	{
+		return;
+	}
+
+	const crypt::NativeFunction *native = m_natives->find(call.name);
+	if (native == nullptr || !native->pure || native->param_count != call.children.size())
+	{
+		return;
+	}
+
+	std::vector<Variable> arguments{};
+	for (const Symbol &argument : call.children)
+	{
+		if (!IsConstant(argument))
+		{
+			return;
+		}
+
+		arguments.push_back(argument.value);
+	}
+
+	try
+	{
+		MakeConstant(call, native->invoke(native->target.get(), arguments.data()));
+		m_stats.folded_expressions++;
+	}
+	catch (const std::exception &)
+	{
+		// left for the vm to report where it happens
+	}
+}
+
+void Optimizer::_fold_unary(Symbol &unary) {
+	Symbol &operand = unary.children[0];
+	this->_fold(operand);
+
+	if (!IsConstant(operand))
+	{
+		return;
+	}
+
+	try
+	{
+		Variable result = ApplyUnary(UnaryOpCode(unary.op), operand.value);
+		MakeConstant(unary, std::move(result));
+		m_stats.folded_expressions++;
+	}
+	catch (const std::exception &)
+	{
+		// left for the vm to report when (and if) it runs
+	}
+}
+
+void Optimizer::_fold_binary(Symbol &binary) {
+	Symbol &left = binary.children[0];
+	Symbol &right = binary.children[1];
+
+	this->_fold(left);
+	this->_fold(right);
+
+	if (binary.op == TokenType::AndOp || binary.op == TokenType::OrOp)
+	{
+		if (!IsConstant(left))
+		{
+			return;
+		}
+
+		// a constant left operand either decides the result or hands it to the right one
+		const bool decides = IsTruthy(left.value) == (binary.op == TokenType::OrOp);
+		Symbol result = decides ? std::move(left) : std::move(right);
+		binary = std::move(result);
+		m_stats.folded_expressions++;
+		return;
+	}
+
+	if (!IsConstant(left) || !IsConstant(right))
+	{
+		return;
+	}
+
+	try
+	{
+		Variable result = ApplyBinary(BinaryOpCode(binary.op), left.value, right.value);
+		MakeConstant(binary, std::move(result));
+		m_stats.folded_expressions++;
+	}
+	catch (const std::exception &)
+	{
+		// like `1 / 0`, left for the vm to report
+	}
+}
+
+void Optimizer::_count_assignments(const Symbol &symbol) {
+	// a field assignment modifies its table in place
+	if (symbol.type == SymbolType::Assign || symbol.type == SymbolType::AssignField)
+	{
+		m_assignment_counts[symbol.name]++;
+	}
+
+	for (const Symbol &child : symbol.children)
+	{
+		this->_count_assignments(child);
+	}
+}
+
+void Optimizer::MakeConstant(Symbol &symbol, Variable &&value) {
+	symbol.type = SymbolType::Value;
+	symbol.op = TokenType::Unknown;
+	symbol.name.clear();
+	symbol.children.clear();
+	symbol.value = std::move(value);
+}
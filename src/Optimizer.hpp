@@ -0,0 +1,8 @@
+#pragma once
+#include "Parser.hpp"
+#include "CryptScript.hpp"
+#include "CryptNative.hpp"
+
+// folds constant expressions (calls of pure `natives` included), propagates top-level constants
+// and drops dead branches of a parsed script (see `crypt::ScriptOptions::optimize`), counting into `stats`
+void OptimizeScript(Symbol &root, crypt::ScriptStats &stats, const crypt::NativeRegistry *natives);
@@ -0,0 +1,169 @@
+#include "ParseCache.hpp"
+#include "CryptSnapshot.hpp"
+#include "Hash.hpp"
+#include "MappedFile.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static constexpr char ParseCacheMagic[4] = {'C', 'R', 'Y', 'S'};
+
+// precedes the snapshot of the document in a parse cache entry
+struct ParseCacheHeader
+{
+	char magic[4];
+	uint32_t reserved;
+	// the `CacheKey` it was parsed from
+	uint64_t source_hash;
+	// of the whole file, with this field zeroed (see `EntryChecksum()`)
+	uint64_t checksum;
+	// of the snapshot
+	uint64_t size;
+};
+
+// keeps the snapshot after it aligned
+static_assert(sizeof(ParseCacheHeader) % 8 == 0, "parse cache header must keep the alignment");
+
+// the header (with the checksum zeroed) and the snapshot after it
+static uint64_t EntryChecksum(ParseCacheHeader header, const uint8_t *snapshot, size_t size) {
+	header.checksum = 0;
+	return HashBytes(snapshot, size, HashBytes(&header, sizeof(header)));
+}
+
+// unique among the processes/threads writing the same cache entry
+static fs::path TempFilePath(const fs::path &target);
+
+CacheKey CacheKey::Of(const crypt::char_type *source, size_t length) {
+	const uint64_t seed = HashBytes(CRYPT_VERSION, sizeof(CRYPT_VERSION) - 1);
+	return CacheKey{HashBytes(source, length * sizeof(crypt::char_type), seed), length};
+}
+
+bool ReadParseCache(const crypt::string_type &directory, const CacheKey &key, crypt::Variable &out) {
+	const fs::path path = CacheFilePath(directory, key, "crys");
+
+	std::error_code error{};
+	if (!fs::is_regular_file(path, error))
+	{
+		return false;
+	}
+
+	try
+	{
+		const MappedFile file{path.string().c_str()};
+		if (file.size() < sizeof(ParseCacheHeader))
+		{
+			return false;
+		}
+
+		ParseCacheHeader header;
+		memcpy(&header, file.data(), sizeof(header));
+
+		const uint8_t *image = file.data() + sizeof(ParseCacheHeader);
+		const size_t size = file.size() - sizeof(ParseCacheHeader);
+
+		// a damaged snapshot can still decode, into the wrong document
+		if (memcmp(header.magic, ParseCacheMagic, sizeof(ParseCacheMagic)) != 0 || header.source_hash != key.hash ||
+				header.size != size || EntryChecksum(header, image, size) != header.checksum)
+		{
+			return false;
+		}
+
+		const crypt::Snapshot snapshot = crypt::Snapshot::FromBuffer(image, size);
+		out = snapshot.root().to_variable();
+	}
+	catch (const std::exception &)
+	{
+		// stale or damaged entries are treated as misses, the next write replaces them
+		return false;
+	}
+
+	return out.get_type() == crypt::VariableType::Table;
+}
+
+void WriteParseCache(const crypt::string_type &directory, const CacheKey &key, const crypt::Variable &document) {
+	std::vector<uint8_t> snapshot{};
+	try
+	{
+		snapshot = crypt::EncodeSnapshot(document);
+	}
+	catch (const std::exception &)
+	{
+		return;
+	}
+
+	ParseCacheHeader header{};
+	memcpy(header.magic, ParseCacheMagic, sizeof(ParseCacheMagic));
+	header.source_hash = key.hash;
+	header.size = snapshot.size();
+	header.checksum = EntryChecksum(header, snapshot.data(), snapshot.size());
+
+	std::vector<uint8_t> image(sizeof(header) + snapshot.size());
+	memcpy(image.data(), &header, sizeof(header));
+	memcpy(image.data() + sizeof(header), snapshot.data(), snapshot.size());
+
+	WriteCacheFile(directory, CacheFilePath(directory, key, "crys"), image);
+}
+
+fs::path CacheFilePath(const crypt::string_type &directory, const CacheKey &key, const char *extension) {
+	char name[64];
+	snprintf(
+		name, sizeof(name), "%016llx-%llx.%s", (unsigned long long)key.hash, (unsigned long long)key.length, extension
+	);
+
+	return fs::path(directory) / name;
+}
+
+bool WriteCacheFile(const crypt::string_type &directory, const fs::path &target, const std::vector<uint8_t> &image) {
+	std::error_code error{};
+	fs::create_directories(directory, error);
+	if (error)
+	{
+		return false;
+	}
+
+	const fs::path temp = TempFilePath(target);
+
+	FILE *file = fopen(temp.string().c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	const size_t written = fwrite(image.data(), 1, image.size(), file);
+	const bool closed = fclose(file) == 0;
+
+	if (written != image.size() || !closed)
+	{
+		fs::remove(temp, error);
+		return false;
+	}
+
+	fs::rename(temp, target, error);
+	if (error)
+	{
+		fs::remove(temp, error);
+		return false;
+	}
+
+	return true;
+}
+
+fs::path TempFilePath(const fs::path &target) {
+	static std::atomic<uint64_t> counter{0};
+
+	uint64_t unique = HashCombine(counter.fetch_add(1), std::hash<std::thread::id>()(std::this_thread::get_id()));
+	unique = HashCombine(unique, std::chrono::steady_clock::now().time_since_epoch().count());
+
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%016llx.tmp", (unsigned long long)unique);
+
+	fs::path temp = target;
+	temp += suffix;
+	return temp;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Crypt.hpp"
+
+#include <filesystem>
+
+// identifies a source in the parse (or bytecode) cache, collisions need both the hash and the length to match
+struct CacheKey
+{
+	uint64_t hash = 0;
+	size_t length = 0;
+
+	// hashes the source seeded with `CRYPT_VERSION`
+	static CacheKey Of(const crypt::char_type *source, size_t length);
+};
+
+// parse cache entries: a header with a checksum of the file, then a snapshot of the document
+
+// restores the cached document of `key`, false on a miss (or an unreadable or damaged cache file)
+bool ReadParseCache(const crypt::string_type &directory, const CacheKey &key, crypt::Variable &out);
+// caches `document` under `key` by writing a temporary file and renaming it in place,
+// so concurrent loaders never read a partial file; failures are ignored
+void WriteParseCache(const crypt::string_type &directory, const CacheKey &key, const crypt::Variable &document);
+
+// the file of `key`'s entry in `directory`, named by the key and `extension`
+std::filesystem::path CacheFilePath(const crypt::string_type &directory, const CacheKey &key, const char *extension);
+// writes `image` to `target` (creating `directory` on demand) through a temporary file renamed
+// in place, replacing any existing entry atomically; false on failure
+bool WriteCacheFile(const crypt::string_type &directory, const std::filesystem::path &target, const std::vector<uint8_t> &image);
@@ -1,402 +1,361 @@
 #include "Parser.hpp"
 #include <stdexcept>
+#include <charconv>
+#include <string.h>
 
-#include "Error.hpp"
-
-enum ObjectType
-{
-	eObjType_None,
-	eObjType_List,
-	eObjType_Table,
-};
-
-struct TokenReadout
-{
-	const Token *tokens;
-	size_t count;
-};
-
-struct ParseResult
-{
-	size_t read_count = 0;
-	errno_t error = 0;
-};
-
-struct Block
-{
-	bool root;
-	Symbol &parent;
-};
-
-static CryptString PreprocessTokenStr(const CryptChar *content, size_t size);
-static ParseResult ParseValue(const Token *tokens, size_t count, crypt::Variable &out);
-
-static CryptInt ParseInt(const CryptChar *content, size_t length);
-static CryptReal ParseReal(const CryptChar *content, size_t length);
-static CryptBool ParseBoolean(const CryptChar *content, size_t length);
-
-static ParseResult ParseExpression(const TokenReadout &tokens, Symbol &out);
-static ParseResult ParseBlock(const TokenReadout &tokens, const Block &block);
-
-static ParseResult _ParseIdentifierExpr(const TokenReadout &tokens, Symbol &out);
+#include "ParseCache.hpp"
 
 /// @param tokens start of the object (the '{' token)
 /// @param count in/out. in is the tokens count; out is the read count
-/// @param count in/out. in is the tokens count; out is the read count
-static ParseResult ParseObject(const Token *tokens, size_t count, crypt::Variable &out);
-static ParseResult _ParseTable(const Token *tokens, size_t count, CryptTable &out);
-static ParseResult _ParseList(const Token *tokens, size_t count, CryptList &out);
+static errno_t ParseObject(const Token *tokens, size_t &count, crypt::Variable &out);
+/// @param root the table is the document root, it has no braces and ends with the tokens
+static errno_t _ParseTable(const Token *tokens, size_t &count, CryptTable &out, bool root = false);
+static errno_t _ParseList(const Token *tokens, size_t &count, CryptList &out);
+/// parses lists made only of ints (or only of reals) into a packed array
+/// @returns false without touching `out` or `count` if the list isn't homogeneous
+static bool _ParsePackedList(const Token *tokens, size_t &count, crypt::Variable &out);
 
-static ObjectType GetObjectType(const Token *tokens, size_t count);
 static const Token *SkipUselessTokens(const Token *tokens, size_t count);
-static size_t NextUsefulTokenIndex(const Token *tokens, size_t count);
 
-static inline bool IsExpectedTokenTypeForTableKey(TokenType type);
+// `Load()`'s error, formatted like the streaming reader's (1-based)
+[[noreturn]] static void ThrowDocumentError(const char *msg, const TextPosition &pos);
+
 static inline CryptChar UnescapeChar(CryptChar value);
 static inline constexpr bool IsUselessTokenType(TokenType type);
 
 
 
+namespace crypt
+{
+	Variable Load(const char_type *source, size_t length) {
+		std::vector<Token> tokens{};
+		Variable document{};
 
-Symbol Symbol::Parse(const Token *tokens, size_t count) {
-	Symbol base;
+		try
+		{
+			Token::Parse(source, length, tokens);
 
-	for (size_t i = 0; i < count; i++)
-	{
-		i += NextUsefulTokenIndex(&tokens[i], count - i);
+			size_t count = tokens.size();
+			_ParseTable(tokens.data(), count, document._build_table(), true);
+		}
+		catch (const TokenError &error)
+		{
+			ThrowDocumentError(error.what(), error.pos);
+		}
+		catch (const ParseError &error)
+		{
+			ThrowDocumentError(error.what(), error.pos);
+		}
 
+		return document;
+	}
 
+	Variable Load(const char_type *source, size_t length, const LoadOptions &options) {
+		if (length == 0 && source != nullptr)
+		{
+			length = strlen(source);
+		}
 
-	}
+		Variable document{};
+		const bool cached = !options.cache_dir.empty();
+		const CacheKey key = cached ? CacheKey::Of(source, length) : CacheKey{};
 
-	return base;
+		if (cached && ReadParseCache(options.cache_dir, key, document))
+		{
+			if (options.stats)
+			{
+				options.stats->from_cache = true;
+			}
+		}
+		else
+		{
+			document = Load(source, length);
+
+			if (cached)
+			{
+				WriteParseCache(options.cache_dir, key, document);
+			}
+		}
+
+		if (options.deduplicate)
+		{
+			Deduplicate(document, options.stats);
+		}
+
+		return document;
+	}
 }
 
-CryptString PreprocessTokenStr(const CryptChar *content, const size_t size) {
-	CryptString result{};
-	result.resize(size);
+void PreprocessTokenStr(const CryptChar *content, const size_t size, CryptString &out) {
+	out.resize(size);
 
 	offset_t result_head = 0;
 	for (size_t i = 0; i < size; i++)
 	{
-		if (content[i] == '\\')
+		// skip escape (a trailing one is kept as is)
+		if (content[i] == '\\' && i + 1 < size)
 		{
-			// skip escape
 			i++;
 
-			result[result_head++] = UnescapeChar(content[i]);
+			out[result_head++] = UnescapeChar(content[i]);
 			continue;
 		}
 
-		result[result_head++] = content[i];
+		out[result_head++] = content[i];
 	}
 
-	return result;
+	// escapes shrink the string
+	out.resize(result_head);
 }
 
-ParseResult ParseValue(const Token *tokens, size_t count, crypt::Variable &out) {
+errno_t ParseValue(const Token *tokens, size_t &count, crypt::Variable &out) {
 	const Token &head = tokens[0];
 
 	const size_t tokens_count = count;
 	count = 1;
 
-	ParseResult result;
-
-
 	switch (head.type)
 	{
 	case TokenType::Null:
 		{
+			out = crypt::Variable();
 			break;
 		}
 	case TokenType::String:
 		{
-			out = PreprocessTokenStr(head.content, head.content_length);
+			// unescaped straight into the value's storage
+			PreprocessTokenStr(head.content, head.content_length, out._build_string());
 			break;
 		}
 	case TokenType::Integer:
 		{
-			out = ParseInt(head.content, head.content_length);
+			out = ParseInt(head);
 			break;
 		}
 	case TokenType::Real:
 		{
-			out = ParseReal(head.content, head.content_length);
+			out = ParseReal(head);
 			break;
 		}
 	case TokenType::Boolean:
 		{
-			out = ParseBoolean(head.content, head.content_length);
+			out = ParseBoolean(head);
 			break;
 		}
 	case TokenType::BraceOpen:
 		{
-			// overriden to 1 above to suite most cases 
+			// overriden to 1 above to suite most cases
 			count = tokens_count;
 			const errno_t error = ParseObject(tokens, count, out);
 
 			if (error != EOK)
 			{
-				throw std::runtime_error("parse object error");
+				throw ParseError("invalid table or list", head.pos);
 			}
 
 			return error;
 		}
 	default:
-		throw std::runtime_error("invalid token list to value");
+		throw ParseError("expected a value", head.pos);
 	}
 
 	return EOK;
 }
 
-CryptInt ParseInt(const CryptChar *content, size_t length) {
-	if (length == 0 || content == nullptr)
-	{
-		//! temp
-		throw std::runtime_error("invalid args");
-	}
+CryptInt ParseInt(const Token &token) {
+	const CryptChar *const end = token.content + token.content_length;
 
-	constexpr CryptInt base = 10;
-	CryptInt mul = 1;
 	CryptInt value = 0;
+	const std::from_chars_result result = std::from_chars(token.content, end, value);
 
-	if (content[0] == '-')
+	if (result.ec == std::errc::result_out_of_range)
 	{
-		mul = -1;
-		content++;
-		length--;
+		throw ParseError("int out of range", token.pos);
 	}
 
-	for (size_t i = 0; i < length; i++)
+	if (token.content_length == 0 || result.ec != std::errc() || result.ptr != end)
 	{
-		if (content[i] > '9' || content[i] < '0')
-		{
-			//! temp
-			throw std::runtime_error("unexpected char in int parsing");
-		}
-
-		value += mul * (content[i] - '0');
-		mul *= base;
+		throw ParseError("invalid int", token.pos);
 	}
 
 	return value;
 }
 
-CryptReal ParseReal(const CryptChar *content, size_t length) {
-	if (length == 0 || content == nullptr)
-	{
-		//! temp
-		throw std::runtime_error("invalid args");
-	}
-
-	constexpr CryptReal PreDecimalBase = 10;
-	constexpr CryptReal DecimalBase = 0.1;
+CryptReal ParseReal(const Token &token) {
+	const CryptChar *const end = token.content + token.content_length;
 
-	CryptReal base = PreDecimalBase;
-	CryptReal mul = 1;
 	CryptReal value = 0;
+	const std::from_chars_result result = std::from_chars(token.content, end, value, std::chars_format::fixed);
 
-	if (content[0] == '-')
+	if (result.ec == std::errc::result_out_of_range)
 	{
-		mul = -1;
-		content++;
-		length--;
+		throw ParseError("real out of range", token.pos);
 	}
 
-	const CryptChar *decimal_dot = nullptr;
-	for (size_t i = 0; i < length; i++)
+	if (token.content_length == 0 || result.ec != std::errc() || result.ptr != end)
 	{
-		if (decimal_dot == nullptr && content[i] == '.')
-		{
-			decimal_dot = &content[i];
-			base = DecimalBase;
-
-			if (mul > 0)
-			{
-				mul = DecimalBase;
-			}
-			else
-			{
-				mul = -DecimalBase;
-			}
-		}
-
-		if (content[i] > '9' || content[i] < '0')
-		{
-			//! temp
-			throw std::runtime_error("unexpected char in int parsing");
-		}
-
-		value += mul * CryptReal(content[i] - '0');
-		mul *= base;
+		throw ParseError("invalid real", token.pos);
 	}
 
 	return value;
 }
 
-CryptBool ParseBoolean(const CryptChar *content, size_t length) {
-	if (StringEqual(content, BooleanNames[false], length))
+CryptBool ParseBoolean(const Token &token) {
+	if (StringEqual(token.content, BooleanNames[false], token.content_length))
 	{
 		return false;
 	}
 
-	if (StringEqual(content, BooleanNames[true], length))
+	if (StringEqual(token.content, BooleanNames[true], token.content_length))
 	{
 		return true;
 	}
 
-	//! temp
-	throw std::runtime_error("invalid boolean");
-	// return false;
+	throw ParseError("invalid boolean", token.pos);
 }
 
-ParseResult ParseExpression(const TokenReadout &tokens, Symbol &out) {
-	ParseResult result;
-
-	size_t &index = result.read_count;
-	for (;index < tokens.count; index++)
+errno_t ParseObject(const Token *tokens, size_t &count, crypt::Variable &out) {
+	if (tokens[0].type != TokenType::BraceOpen)
 	{
-		index += NextUsefulTokenIndex(&tokens.tokens[index], tokens.count - index);
-		if (index > tokens.count)
-		{
-			break;
-		}
-
-		const Token &token = tokens.tokens[index];
+		return EINVAL;
+	}
 
-		if (token.type == TokenType::Identifier)
-		{
-			out.
+	if (count < 2)
+	{
+		return ERANGE;
+	}
 
+	// objects that are neither are parsed (and fail) as tables
+	ObjectType obj_type = GetObjectType(tokens, count);
 
+	if (obj_type == eObjType_None)
+	{
+		obj_type = eObjType_Table;
+	}
 
+	// the elements are parsed straight into the new object
+	if (obj_type == eObjType_List)
+	{
+		if (_ParsePackedList(tokens, count, out))
+		{
+			return EOK;
 		}
+
+		return _ParseList(tokens, count, out._build_list());
 	}
 
-	return result;
+	return _ParseTable(tokens, count, out._build_table());
 }
 
-errno_t ParseBlock(const TokenReadout &tokens, size_t &read_count, const Block &block) {
-	read_count = 0;
+errno_t _ParseTable(const Token *tokens, size_t &count, CryptTable &out, bool root) {
+	const size_t tokens_count = count;
+	size_t index = root ? 0 : 1;
 
-	size_t index = 0;
-	for (; index < tokens.count; index++)
+	for (; index < tokens_count; index++)
 	{
-		index += NextUsefulTokenIndex(&tokens.tokens[index], tokens.count - index);
-		if (index > tokens.count)
+		// skip useless
+		index += SkipUselessTokens(&tokens[index], tokens_count - index) - &tokens[index];
+
+		if (index >= tokens_count)
 		{
 			break;
 		}
 
-		Symbol output = {};
-		ParseResult result = ParseExpression({&tokens.tokens[index], tokens.count - index}, output);
-		block.parent.children.push_back(output);
+		const Token &token = tokens[index];
 
-		if (result.error != EOK)
+		if (!root && token.type == TokenType::BraceClose)
 		{
-			//! TEMP
-			throw std::runtime_error("parse error!");
+			count = index + 1;
+			return EOK;
 		}
 
-		if (result.read_count > 0)
+		// separators between the entries are optional
+		if (token.type == TokenType::Comma)
 		{
-			index += result.read_count - 1;
+			continue;
 		}
-	}
-
-	return errno_t();
-}
 
-ParseResult _ParseIdentifierExpr(const TokenReadout &tokens, Symbol &out) {
-	if (tokens.tokens[0].type != TokenType::Identifier)
-	{
-		throw std::logic_error("!");
-	}
-	ParseResult result{};
+		if (!IsExpectedTokenTypeForTableKey(token.type))
+		{
+			throw ParseError("expected a key", token.pos);
+		}
 
-	const auto identifier_name = \
-		CryptString(tokens.tokens[0].content, tokens.tokens[0].content_length);
+		CryptString key{};
+		if (token.type == TokenType::String)
+		{
+			PreprocessTokenStr(token.content, token.content_length, key);
+		}
+		else
+		{
+			key.assign(token.content, token.content_length);
+		}
 
-	size_t &index = result.read_count;
-	index++;
-	index += NextUsefulTokenIndex(&tokens.tokens[index], tokens.count - index);
+		index++;
+		index += NextUsefulTokenIndex(&tokens[index], tokens_count - index);
 
-	switch (tokens.tokens[index].type)
-	{
-	case TokenType::AssignOp:
+		if (index >= tokens_count || tokens[index].type != TokenType::AssignOp)
 		{
-			out.type = SymbolType::Assign;
-			out.name = identifier_name;
-
-			index++;
-			index += NextUsefulTokenIndex(&tokens.tokens[index], tokens.count - index);
+			throw ParseError("expected '=' after the key", token.pos);
+		}
 
-			Symbol &expr = out.children.emplace_back();
-			ParseResult expr_result = ParseExpression(
-				{&tokens.tokens[index], tokens.count - index},
-				expr
-			);
+		index++;
+		index += NextUsefulTokenIndex(&tokens[index], tokens_count - index);
 
-			result.error = expr_result.error;
-			index += expr_result.read_count;
+		if (index >= tokens_count)
+		{
+			throw ParseError("expected a value after the key", token.pos);
 		}
-		break;
-	default:
-		result.error = EINVAL;
-	}
 
-	return result;
-}
-
-errno_t ParseObject(const Token *tokens, size_t &count, crypt::Variable &out) {
-	if (tokens[0].type != TokenType::BraceOpen)
-	{
-		LOG_ERR("Expected '{' at object start %p", tokens);
-		return EINVAL;
-	}
+		// expecting a value
+		size_t read_tokens_inout = tokens_count - index;
 
-	if (count < 2)
-	{
-		LOG_ERR("too little tokens, min is 2, given is %llu", count);
-		return ERANGE;
-	}
+		crypt::Variable &value = out.try_emplace(std::move(key)).first->second;
+		const errno_t error = ParseValue(&tokens[index], read_tokens_inout, value);
 
-	ObjectType obj_type = GetObjectType(tokens, count);
+		if (error != EOK)
+		{
+			return error;
+		}
 
-	if (obj_type == eObjType_None)
-	{
-		LOG_ERR("object type returned as none, overwriting to table type, tokens=%p", tokens);
-		obj_type = eObjType_Table;
+		if (read_tokens_inout > 0)
+		{// out the tokens read
+			index += read_tokens_inout - 1;
+		}
 	}
 
-	if (obj_type == eObjType_List)
+	if (!root)
 	{
-		out = crypt::Variable(crypt::VariableType::List);
-		return _ParseList(tokens, count, out.get_list());
+		throw ParseError("unterminated table", tokens[0].pos);
 	}
 
-	out = crypt::Variable(crypt::VariableType::Table);
-	return _ParseTable(tokens, count, out.get_table());
+	count = index;
+
+	return EOK;
 }
 
-errno_t _ParseTable(const Token *tokens, size_t &count, CryptTable &out) {
+errno_t _ParseList(const Token *tokens, size_t &count, CryptList &out) {
 	const size_t tokens_count = count;
 	size_t index = 1;
 	bool expecting_separator = false;
-	bool found_value = false;
 
-	for (; index < count; index++)
+	for (; index < tokens_count; index++)
 	{
 		// skip useless
 		index += SkipUselessTokens(&tokens[index], tokens_count - index) - &tokens[index];
 
-		if (index >= count)
+		if (index >= tokens_count)
 		{
 			break;
 		}
 
 		const Token &token = tokens[index];
 
+		if (token.type == TokenType::BraceClose)
+		{
+			count = index + 1;
+			return EOK;
+		}
+
 		if (expecting_separator)
 		{
 			if (token.type == TokenType::Comma)
@@ -405,19 +364,16 @@ errno_t _ParseTable(const Token *tokens, size_t &count, CryptTable &out) {
 				continue;
 			}
 
-			//! ERROR?
-			continue;
+			throw ParseError("expected ',' between list elements", token.pos);
 		}
 
 		// expecting a value
 		size_t read_tokens_inout = tokens_count - index;
 
-		out.emplace();
-		const errno_t error = ParseValue(&tokens[index], read_tokens_inout, out.back());
+		const errno_t error = ParseValue(&tokens[index], read_tokens_inout, out.emplace_back());
 
 		if (error != EOK)
 		{
-			LOG_ERR("error parsing value at %llu:%llu", token.pos.line, token.pos.column);
 			return error;
 		}
 
@@ -425,63 +381,110 @@ errno_t _ParseTable(const Token *tokens, size_t &count, CryptTable &out) {
 		{// out the tokens read
 			index += read_tokens_inout - 1;
 		}
-	}
 
-	count = index;
+		expecting_separator = true;
+	}
 
-	return EOK;
+	throw ParseError("unterminated list", tokens[0].pos);
 }
 
-errno_t _ParseList(const Token *tokens, size_t &count, CryptList &out) {
+bool _ParsePackedList(const Token *tokens, size_t &count, crypt::Variable &out) {
 	const size_t tokens_count = count;
-	size_t index = 1;
+
+	// the type of the first element decides the array type
+	const size_t first_index = 1 + NextUsefulTokenIndex(&tokens[1], tokens_count - 1);
+	if (first_index >= tokens_count)
+	{
+		return false;
+	}
+
+	const TokenType element_type = tokens[first_index].type;
+	if (element_type != TokenType::Integer && element_type != TokenType::Real)
+	{
+		return false;
+	}
+
+	// validate the layout and count the elements before allocating anything
+	size_t elements = 0;
+	size_t end_index = first_index;
 	bool expecting_separator = false;
 
-	for (; index < count; index++)
+	for (; end_index < tokens_count; end_index++)
 	{
-		// skip useless
-		index += SkipUselessTokens(&tokens[index], tokens_count - index) - &tokens[index];
+		end_index += NextUsefulTokenIndex(&tokens[end_index], tokens_count - end_index);
 
-		if (index >= count)
+		if (end_index >= tokens_count)
 		{
-			break;
+			return false;
 		}
 
-		const Token &token = tokens[index];
+		const TokenType type = tokens[end_index].type;
+
+		if (type == TokenType::BraceClose)
+		{
+			break;
+		}
 
 		if (expecting_separator)
 		{
-			if (token.type == TokenType::Comma)
+			if (type != TokenType::Comma)
 			{
-				expecting_separator = false;
-				continue;
+				return false;
 			}
 
-			//! ERROR?
+			expecting_separator = false;
 			continue;
 		}
 
-		// expecting a value
-		size_t read_tokens_inout = tokens_count - index;
+		if (type != element_type)
+		{
+			return false;
+		}
 
-		out.emplace_back();
-		const errno_t error = ParseValue(&tokens[index], read_tokens_inout, out.back());
+		elements++;
+		expecting_separator = true;
+	}
 
-		if (error != EOK)
+	if (end_index >= tokens_count)
+	{
+		return false;
+	}
+
+	if (element_type == TokenType::Integer)
+	{
+		crypt::int_array_type &values = out._build_int_array();
+		values.reserve(elements);
+
+		for (size_t i = first_index; i < end_index; i++)
 		{
-			LOG_ERR("error parsing value at %llu:%llu", token.pos.line, token.pos.column);
-			return error;
-		}
+			// skip comments too, they might contain numbers
+			i += NextUsefulTokenIndex(&tokens[i], end_index - i);
 
-		if (read_tokens_inout > 0)
-		{// out the tokens read
-			index += read_tokens_inout - 1;
+			if (i < end_index && tokens[i].type == element_type)
+			{
+				values.push_back(ParseInt(tokens[i]));
+			}
 		}
 	}
+	else
+	{
+		crypt::real_array_type &values = out._build_real_array();
+		values.reserve(elements);
 
-	count = index;
+		for (size_t i = first_index; i < end_index; i++)
+		{
+			// skip comments too, they might contain numbers
+			i += NextUsefulTokenIndex(&tokens[i], end_index - i);
 
-	return EOK;
+			if (i < end_index && tokens[i].type == element_type)
+			{
+				values.push_back(ParseReal(tokens[i]));
+			}
+		}
+	}
+
+	count = end_index + 1;
+	return true;
 }
 
 ObjectType GetObjectType(const Token *tokens, size_t count) {
@@ -526,8 +529,8 @@ ObjectType GetObjectType(const Token *tokens, size_t count) {
 		return eObjType_Table;
 	}
 
-	// comma after a value ('name ,'), can't be a table; must be a list
-	if (tokens[index].type == TokenType::Comma)
+	// comma or the end after a value ('name ,' or 'name }'), can't be a table; must be a list
+	if (tokens[index].type == TokenType::Comma || tokens[index].type == TokenType::BraceClose)
 	{
 		return eObjType_List;
 	}
@@ -549,6 +552,12 @@ const Token *SkipUselessTokens(const Token *tokens, size_t count) {
 				count,
 				[](const Token &token) { return token.type == TokenType::Newline; }
 			);
+
+			// commented till the end
+			if (index >= count)
+			{
+				break;
+			}
 			continue;
 		}
 
@@ -570,10 +579,6 @@ size_t NextUsefulTokenIndex(const Token *tokens, size_t count) {
 	return useful_token - tokens;
 }
 
-inline bool IsExpectedTokenTypeForTableKey(TokenType type) {
-	return type == TokenType::Identifier || type == TokenType::String;
-}
-
 inline CryptChar UnescapeChar(CryptChar value) {
 	switch (value)
 	{
@@ -595,3 +600,9 @@ inline CryptChar UnescapeChar(CryptChar value) {
 inline constexpr bool IsUselessTokenType(TokenType type) {
 	return type == TokenType::Newline || type == TokenType::Whitespace;
 }
+
+void ThrowDocumentError(const char *msg, const TextPosition &pos) {
+	throw std::runtime_error(
+		std::string(msg) + " at " + std::to_string(pos.line + 1) + ":" + std::to_string(pos.column + 1)
+	);
+}
@@ -7,18 +7,72 @@ enum class SymbolType : uint8_t
 	Invalid,
 
 	Identifier, // identifier name is the `name` field
-	Assign,
+	Assign, // `name` = children[0], `op` is `AssignOp` or a compound op like `AddEqOp`
 	Value,
+
+	Unary, // `op` applied to children[0]
+	Binary, // children[0] `op` children[1]
+	Call, // `name`(children...)
+	Field, // the field `name` of the table children[0]
+	// `name`.children[1].name... = children[0], the rest of the children are the field names
+	// (identifiers), `op` is like in `Assign`
+	AssignField,
+
+	Block, // children are the statements
+	If, // (condition, block) pairs in the children, a trailing unpaired block is the `else`
+	While, // loops over children[1] (a block) while children[0] holds
+	Function, // `name`, children are the parameters (identifiers) followed by the body block
+	Return, // returns children[0] or null when there are no children
+};
+
+enum ObjectType
+{
+	eObjType_None,
+	eObjType_List,
+	eObjType_Table,
 };
 
 struct Symbol
 {
 	SymbolType type = SymbolType::Invalid;
+	TokenType op = TokenType::Unknown;
+	TextPosition pos = {};
 
 	crypt::Variable value;
 	CryptString name;
 
 	std::vector<Symbol> children;
 
+	// parses a script into a `Block` symbol, throws crypt::ScriptError on syntax errors
 	static Symbol Parse(const Token *tokens, size_t count);
 };
+
+// a document syntax error at `pos` (0-based, like the tokens')
+class ParseError : public std::runtime_error
+{
+public:
+	inline ParseError(const std::string &msg, const TextPosition &pos) : std::runtime_error(msg), pos{pos} {}
+
+	TextPosition pos;
+};
+
+// value helpers, shared with the streaming reader and the script parser
+
+/// @param count in/out. in is the tokens count; out is the read count
+/// @throws ParseError on malformed values
+errno_t ParseValue(const Token *tokens, size_t &count, crypt::Variable &out);
+
+void PreprocessTokenStr(const CryptChar *content, size_t size, CryptString &out);
+
+// the value of an `Integer`/`Real`/`Boolean` token, throw ParseError at the token when malformed
+CryptInt ParseInt(const Token &token);
+CryptReal ParseReal(const Token &token);
+CryptBool ParseBoolean(const Token &token);
+
+/// @param tokens start of the object (the '{' token is optional)
+ObjectType GetObjectType(const Token *tokens, size_t count);
+size_t NextUsefulTokenIndex(const Token *tokens, size_t count);
+
+inline bool IsExpectedTokenTypeForTableKey(TokenType type) {
+	return type == TokenType::Identifier || type == TokenType::String;
+}
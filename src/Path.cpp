@@ -0,0 +1,233 @@
+#include "CryptPath.hpp"
+#include "Common.hpp"
+
+#include <stdexcept>
+
+using crypt::Path;
+
+static inline bool IsPathKeyChar(CryptChar value);
+static size_t ParseBracket(const CryptString &expression, size_t index, Path::Segment &out);
+
+namespace crypt
+{
+	Path::Path(const string_type &expression) {
+		size_t index = 0;
+
+		while (index < expression.size())
+		{
+			Segment &segment = m_segments.emplace_back();
+
+			if (expression[index] == '[')
+			{
+				index = ParseBracket(expression, index, segment);
+			}
+			else
+			{
+				const size_t start = index;
+				while (index < expression.size() && IsPathKeyChar(expression[index]))
+				{
+					index++;
+				}
+
+				if (index == start)
+				{
+					throw std::invalid_argument("expected a key in path at " + std::to_string(index));
+				}
+
+				segment.key.assign(expression, start, index - start);
+			}
+
+			if (index >= expression.size())
+			{
+				break;
+			}
+
+			// a dot starts the next key, brackets follow directly
+			if (expression[index] == '.')
+			{
+				index++;
+
+				if (index >= expression.size() || expression[index] == '[' || expression[index] == '.')
+				{
+					throw std::invalid_argument("expected a key after '.' in path");
+				}
+			}
+			else if (expression[index] != '[')
+			{
+				throw std::invalid_argument("unexpected char in path at " + std::to_string(index));
+			}
+		}
+
+		m_caches.resize(m_segments.size());
+	}
+
+	Path::Path(std::vector<Segment> &&segments)
+		: m_segments{std::move(segments)}, m_caches(m_segments.size()) {
+	}
+
+	const Variable *Path::resolve(const Variable &root) const {
+		const Variable *current = &root;
+
+		for (size_t i = 0; i < m_segments.size(); i++)
+		{
+			const Segment &segment = m_segments[i];
+
+			if (segment.is_index)
+			{
+				if (!current->is_list())
+				{
+					return nullptr;
+				}
+
+				const list_type &list = current->get_list();
+				if (segment.index >= list.size())
+				{
+					return nullptr;
+				}
+
+				current = &list[segment.index];
+				continue;
+			}
+
+			if (current->get_type() != VariableType::Table)
+			{
+				return nullptr;
+			}
+
+			// the same table contents as the last lookup, same entry
+			// (tables without a stamp can change behind it, those are never cached)
+			SlotCache &cache = m_caches[i];
+			const uint64_t stamp = current->get_stamp();
+			if (stamp != 0 && cache.stamp == stamp)
+			{
+				current = cache.value;
+				continue;
+			}
+
+			const table_type &table = current->get_table();
+			const auto iter = table.find(segment.key);
+			if (iter == table.end())
+			{
+				return nullptr;
+			}
+
+			cache.stamp = stamp;
+			cache.value = &iter->second;
+			current = &iter->second;
+		}
+
+		return current;
+	}
+
+	const Variable &Path::at(const Variable &root) const {
+		const Variable *value = this->resolve(root);
+
+		if (value == nullptr)
+		{
+			throw VariableAccessError(this->to_string());
+		}
+
+		return *value;
+	}
+
+	void Path::ResolveMany(const Path *paths, size_t count, const Variable &root, const Variable **out) {
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = paths[i].resolve(root);
+		}
+	}
+
+	string_type Path::to_string() const {
+		string_type result{};
+
+		for (const Segment &segment : m_segments)
+		{
+			if (segment.is_index)
+			{
+				result += '[';
+				result += std::to_string(segment.index);
+				result += ']';
+				continue;
+			}
+
+			bool plain_key = !segment.key.empty();
+			for (const char_type chr : segment.key)
+			{
+				plain_key = plain_key && IsPathKeyChar(chr);
+			}
+
+			if (!plain_key)
+			{
+				result += "[\"";
+				for (const char_type chr : segment.key)
+				{
+					if (chr == '"' || chr == '\\')
+					{
+						result += '\\';
+					}
+					result += chr;
+				}
+				result += "\"]";
+				continue;
+			}
+
+			if (!result.empty())
+			{
+				result += '.';
+			}
+			result += segment.key;
+		}
+
+		return result;
+	}
+}
+
+inline bool IsPathKeyChar(CryptChar value) {
+	return value != '.' && value != '[' && value != ']' && value != '"';
+}
+
+size_t ParseBracket(const CryptString &expression, size_t index, Path::Segment &out) {
+	// skip '['
+	index++;
+
+	if (index < expression.size() && expression[index] == '"')
+	{
+		index++;
+
+		for (; index < expression.size() && expression[index] != '"'; index++)
+		{
+			// the escaped char is taken as is
+			if (expression[index] == '\\' && index + 1 < expression.size())
+			{
+				index++;
+			}
+
+			out.key += expression[index];
+		}
+
+		// skip the closing quote
+		index++;
+	}
+	else
+	{
+		const size_t start = index;
+		out.is_index = true;
+
+		for (; index < expression.size() && expression[index] >= '0' && expression[index] <= '9'; index++)
+		{
+			out.index = out.index * 10 + size_t(expression[index] - '0');
+		}
+
+		if (index == start)
+		{
+			throw std::invalid_argument("expected an index or a quoted key in path brackets");
+		}
+	}
+
+	if (index >= expression.size() || expression[index] != ']')
+	{
+		throw std::invalid_argument("expected ']' in path");
+	}
+
+	return index + 1;
+}
@@ -0,0 +1,194 @@
+#include "Peephole.hpp"
+
+#include <algorithm>
+
+using crypt::Program;
+
+static inline bool IsComparison(OpCode op) {
+	return op >= OpCode::Equal && op <= OpCode::GreaterEqual;
+}
+
+// instructions that only push a value
+static inline bool IsPush(OpCode op) {
+	return (op >= OpCode::PushConst && op <= OpCode::PushInt) || op == OpCode::LoadGlobal || op == OpCode::LoadLocal;
+}
+
+// the instruction a superinstruction was rewritten from
+static OpCode HeadOf(OpCode fused) {
+	switch (fused)
+	{
+	case OpCode::LoadLocal2:
+	case OpCode::IncrementLocal:
+	case OpCode::DecrementLocal:
+		return OpCode::LoadLocal;
+	case OpCode::IncrementGlobal:
+	case OpCode::DecrementGlobal:
+		return OpCode::LoadGlobal;
+	case OpCode::StoreLocalKeep:
+		return OpCode::StoreLocal;
+	case OpCode::StoreGlobalKeep:
+		return OpCode::StoreGlobal;
+	case OpCode::AddImmediate:
+	case OpCode::SubImmediate:
+		return OpCode::PushInt;
+	default:
+		if (fused >= OpCode::EqualJumpIfFalse && fused <= OpCode::GreaterEqualJumpIfFalse)
+		{
+			// in the same order as the comparisons
+			return static_cast<OpCode>(
+				static_cast<size_t>(OpCode::Equal) + (static_cast<size_t>(fused) - static_cast<size_t>(OpCode::EqualJumpIfFalse))
+			);
+		}
+		return OpCode::Nop;
+	}
+}
+
+// what the sequence at `index` (starting with `first`, which may differ from the instruction there)
+// is rewritten into: a superinstruction, `Jump` when it does nothing or `Nop` when it stays;
+// the longest sequence wins
+static OpCode MatchFusion(OpCode first, const Instruction *code, size_t index, size_t end) {
+	const auto op_at = [&](size_t offset) {
+		return index + offset < end ? GetOpCode(code[index + offset]) : OpCode::Nop;
+	};
+	const auto same_slot = [&](size_t offset) { return GetOperand(code[index + offset]) == GetOperand(code[index]); };
+
+	const OpCode second = op_at(1);
+
+	switch (first)
+	{
+	case OpCode::LoadLocal:
+	case OpCode::LoadGlobal:
+		{
+			const bool local = first == OpCode::LoadLocal;
+			const OpCode store = local ? OpCode::StoreLocal : OpCode::StoreGlobal;
+
+			// `x += k` and `x -= k`
+			const OpCode arithmetic = op_at(2);
+			if (second == OpCode::PushInt && (arithmetic == OpCode::Add || arithmetic == OpCode::Sub) &&
+					op_at(3) == store && same_slot(3))
+			{
+				if (arithmetic == OpCode::Add)
+				{
+					return local ? OpCode::IncrementLocal : OpCode::IncrementGlobal;
+				}
+				return local ? OpCode::DecrementLocal : OpCode::DecrementGlobal;
+			}
+
+			// `x = x`
+			if (second == store && same_slot(1))
+			{
+				return OpCode::Jump;
+			}
+
+			if (local && second == OpCode::LoadLocal)
+			{
+				return OpCode::LoadLocal2;
+			}
+		}
+		break;
+	case OpCode::StoreLocal:
+		if (second == OpCode::LoadLocal && same_slot(1))
+		{
+			return OpCode::StoreLocalKeep;
+		}
+		break;
+	case OpCode::StoreGlobal:
+		if (second == OpCode::LoadGlobal && same_slot(1))
+		{
+			return OpCode::StoreGlobalKeep;
+		}
+		break;
+	case OpCode::PushInt:
+		if (second == OpCode::Add)
+		{
+			return OpCode::AddImmediate;
+		}
+		if (second == OpCode::Sub)
+		{
+			return OpCode::SubImmediate;
+		}
+		break;
+	default:
+		if (IsComparison(first) && second == OpCode::JumpIfFalse)
+		{
+			return static_cast<OpCode>(
+				static_cast<size_t>(OpCode::EqualJumpIfFalse) + (static_cast<size_t>(first) - static_cast<size_t>(OpCode::Equal))
+			);
+		}
+		break;
+	}
+
+	// a value pushed only to be popped
+	if (IsPush(first) && second == OpCode::Pop)
+	{
+		return OpCode::Jump;
+	}
+
+	return OpCode::Nop;
+}
+
+size_t FusedLength(OpCode op) {
+	switch (op)
+	{
+	case OpCode::IncrementLocal:
+	case OpCode::DecrementLocal:
+	case OpCode::IncrementGlobal:
+	case OpCode::DecrementGlobal:
+		return 3;
+	default:
+		return HeadOf(op) != OpCode::Nop ? 1 : 0;
+	}
+}
+
+bool IsFusionIntact(const std::vector<Instruction> &code, size_t index, size_t end) {
+	const OpCode fused = GetOpCode(code[index]);
+	return MatchFusion(HeadOf(fused), code.data(), index, end) == fused;
+}
+
+size_t FuseInstructions(Program &program) {
+	std::vector<uint32_t> entries{};
+	for (const FunctionInfo &function : program.functions)
+	{
+		entries.push_back(function.entry);
+	}
+	std::sort(entries.begin(), entries.end());
+
+	std::vector<Instruction> &code = program.code;
+	size_t fused = 0;
+
+	// sequences never cross into the next function
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const size_t end = i + 1 < entries.size() ? entries[i + 1] : code.size();
+
+		size_t pc = entries[i];
+		while (pc < end)
+		{
+			const Instruction head = code[pc];
+			const OpCode op = MatchFusion(GetOpCode(head), code.data(), pc, end);
+
+			// (jumps can only reach the first `MaxOperand` instructions)
+			if (op == OpCode::Nop || (op == OpCode::Jump && pc + 2 > MaxOperand))
+			{
+				pc++;
+				continue;
+			}
+
+			// the skipped pairs are left as they are, like the rest of the sequences
+			if (op == OpCode::Jump)
+			{
+				code[pc] = MakeInstruction(OpCode::Jump, static_cast<uint32_t>(pc + 2));
+				pc += 2;
+			}
+			else
+			{
+				code[pc] = MakeInstruction(op, GetOperand(head));
+				pc += 1 + FusedLength(op);
+			}
+
+			fused++;
+		}
+	}
+
+	return fused;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "Bytecode.hpp"
+
+// rewrites the first instruction of each sequence in the built-in set (see `OpCode::LoadLocal2` on)
+// into its superinstruction and jumps over redundant load/store pairs (`x = x`, values pushed only
+// to be popped), returns how many sequences it rewrote; the code keeps its length and layout
+size_t FuseInstructions(crypt::Program &program);
+
+// how many of the instructions after the superinstruction `op` it runs in their place, zero for
+// other instructions
+size_t FusedLength(OpCode op);
+
+// whether the instructions after the superinstruction at `index` are still the sequence it stands
+// for, `end` is the end of its function
+bool IsFusionIntact(const std::vector<Instruction> &code, size_t index, size_t end);
@@ -0,0 +1,405 @@
+#include "CryptPersistentTable.hpp"
+#include "Hash.hpp"
+
+#include <bitset>
+#include <stdexcept>
+
+using crypt::PersistentTable;
+using crypt::PersistentTableNode;
+using crypt::string_type;
+
+struct PersistentTableEntry
+{
+	uint64_t hash;
+	PersistentTable::value_type pair;
+};
+
+typedef std::shared_ptr<const PersistentTableNode> NodePtr;
+typedef std::shared_ptr<const PersistentTableEntry> EntryPtr;
+
+// a branch of a node, either a sub-node or an entry
+struct TrieSlot
+{
+	NodePtr child;
+	EntryPtr entry;
+};
+
+constexpr uint32_t BitsPerLevel = 5;
+constexpr uint64_t LevelMask = (1u << BitsPerLevel) - 1;
+// the hash is fully consumed past this shift, nodes there are plain lists of colliding entries
+constexpr uint32_t MaxShift = 64;
+
+namespace crypt
+{
+	struct PersistentTableNode
+	{
+		// the set bits are the occupied branches, `slots` holds them packed in bit order
+		uint32_t bitmap = 0;
+		std::vector<TrieSlot> slots;
+
+		// only used past `MaxShift`
+		std::vector<EntryPtr> collisions;
+	};
+}
+
+static inline uint64_t HashKey(const string_type &key);
+static inline uint32_t BranchBit(uint64_t hash, uint32_t shift);
+static inline size_t SlotIndex(uint32_t bitmap, uint32_t bit);
+static inline bool IsEntryFor(const PersistentTableEntry &entry, uint64_t hash, const string_type &key);
+
+static const PersistentTableEntry *FindEntry(const PersistentTableNode *node, uint64_t hash, const string_type &key);
+// a node holding only `left` and `right`, which are in the same branch up to `shift`
+static NodePtr MergeEntries(const EntryPtr &left, const EntryPtr &right, uint32_t shift);
+// @returns the updated copy of `node` (which can be null)
+static NodePtr SetEntry(const PersistentTableNode *node, const EntryPtr &entry, uint32_t shift, bool &added);
+// @returns the updated copy of `node`, `node` itself if the key is missing or null if the node got empty
+static NodePtr EraseEntry(const NodePtr &node, uint64_t hash, const string_type &key, uint32_t shift, bool &removed);
+// the entry of a node left with a single entry, which can be pulled up to the parent
+static EntryPtr SoleEntry(const PersistentTableNode &node);
+
+namespace crypt
+{
+	PersistentTable::PersistentTable(const table_type &table) {
+		for (const auto &[key, value] : table)
+		{
+			bool added = false;
+			m_root = SetEntry(
+				m_root.get(),
+				std::make_shared<PersistentTableEntry>(PersistentTableEntry{HashKey(key), {key, value}}),
+				0,
+				added
+			);
+			m_size += added;
+		}
+	}
+
+	const Variable &PersistentTable::at(const string_type &key) const {
+		const Variable *value = this->find(key);
+
+		if (value == nullptr)
+		{
+			throw std::out_of_range("key");
+		}
+
+		return *value;
+	}
+
+	const Variable *PersistentTable::find(const string_type &key) const {
+		const PersistentTableEntry *entry = FindEntry(m_root.get(), HashKey(key), key);
+		return entry == nullptr ? nullptr : &entry->pair.second;
+	}
+
+	PersistentTable PersistentTable::set(const string_type &key, const Variable &value) const {
+		PersistentTable result{};
+		bool added = false;
+
+		result.m_root = SetEntry(
+			m_root.get(),
+			std::make_shared<PersistentTableEntry>(PersistentTableEntry{HashKey(key), {key, value}}),
+			0,
+			added
+		);
+		result.m_size = m_size + added;
+
+		return result;
+	}
+
+	PersistentTable PersistentTable::erase(const string_type &key) const {
+		if (m_root == nullptr)
+		{
+			return *this;
+		}
+
+		PersistentTable result{};
+		bool removed = false;
+
+		result.m_root = EraseEntry(m_root, HashKey(key), key, 0, removed);
+		result.m_size = m_size - removed;
+
+		return result;
+	}
+
+	table_type PersistentTable::to_table() const {
+		return table_type(this->begin(), this->end());
+	}
+
+	PersistentTable::const_iterator PersistentTable::begin() const {
+		const_iterator iterator{};
+
+		if (m_root != nullptr)
+		{
+			iterator.m_stack.emplace_back(m_root.get(), 0);
+			iterator._advance();
+		}
+
+		return iterator;
+	}
+
+	PersistentTable::const_iterator &PersistentTable::const_iterator::operator++() {
+		this->_advance();
+		return *this;
+	}
+
+	void PersistentTable::const_iterator::_advance() {
+		m_current = nullptr;
+
+		while (!m_stack.empty())
+		{
+			const PersistentTableNode *node = m_stack.back().first;
+			size_t &index = m_stack.back().second;
+
+			if (index < node->slots.size())
+			{
+				const TrieSlot &slot = node->slots[index++];
+
+				if (slot.entry != nullptr)
+				{
+					m_current = &slot.entry->pair;
+					return;
+				}
+
+				m_stack.emplace_back(slot.child.get(), 0);
+				continue;
+			}
+
+			const size_t collision_index = index - node->slots.size();
+			if (collision_index < node->collisions.size())
+			{
+				index++;
+				m_current = &node->collisions[collision_index]->pair;
+				return;
+			}
+
+			m_stack.pop_back();
+		}
+	}
+}
+
+inline uint64_t HashKey(const string_type &key) {
+	return HashBytes(key.data(), key.size());
+}
+
+inline uint32_t BranchBit(uint64_t hash, uint32_t shift) {
+	return 1u << ((hash >> shift) & LevelMask);
+}
+
+inline size_t SlotIndex(uint32_t bitmap, uint32_t bit) {
+	return std::bitset<32>(bitmap & (bit - 1)).count();
+}
+
+inline bool IsEntryFor(const PersistentTableEntry &entry, uint64_t hash, const string_type &key) {
+	return entry.hash == hash && entry.pair.first == key;
+}
+
+const PersistentTableEntry *FindEntry(const PersistentTableNode *node, uint64_t hash, const string_type &key) {
+	for (uint32_t shift = 0; node != nullptr; shift += BitsPerLevel)
+	{
+		if (shift >= MaxShift)
+		{
+			for (const EntryPtr &entry : node->collisions)
+			{
+				if (IsEntryFor(*entry, hash, key))
+				{
+					return entry.get();
+				}
+			}
+
+			return nullptr;
+		}
+
+		const uint32_t bit = BranchBit(hash, shift);
+		if ((node->bitmap & bit) == 0)
+		{
+			return nullptr;
+		}
+
+		const TrieSlot &slot = node->slots[SlotIndex(node->bitmap, bit)];
+		if (slot.entry != nullptr)
+		{
+			return IsEntryFor(*slot.entry, hash, key) ? slot.entry.get() : nullptr;
+		}
+
+		node = slot.child.get();
+	}
+
+	return nullptr;
+}
+
+NodePtr MergeEntries(const EntryPtr &left, const EntryPtr &right, uint32_t shift) {
+	auto node = std::make_shared<PersistentTableNode>();
+
+	if (shift >= MaxShift)
+	{
+		node->collisions = {left, right};
+		return node;
+	}
+
+	const uint32_t left_bit = BranchBit(left->hash, shift);
+	const uint32_t right_bit = BranchBit(right->hash, shift);
+
+	if (left_bit == right_bit)
+	{
+		node->bitmap = left_bit;
+		node->slots.push_back({MergeEntries(left, right, shift + BitsPerLevel), nullptr});
+		return node;
+	}
+
+	node->bitmap = left_bit | right_bit;
+	if (left_bit < right_bit)
+	{
+		node->slots = {{nullptr, left}, {nullptr, right}};
+	}
+	else
+	{
+		node->slots = {{nullptr, right}, {nullptr, left}};
+	}
+
+	return node;
+}
+
+NodePtr SetEntry(const PersistentTableNode *node, const EntryPtr &entry, uint32_t shift, bool &added) {
+	// path copy, the copied slots still share their children/entries
+	auto result = node == nullptr \
+		? std::make_shared<PersistentTableNode>()
+		: std::make_shared<PersistentTableNode>(*node);
+
+	if (shift >= MaxShift)
+	{
+		for (EntryPtr &existing : result->collisions)
+		{
+			if (IsEntryFor(*existing, entry->hash, entry->pair.first))
+			{
+				existing = entry;
+				return result;
+			}
+		}
+
+		result->collisions.push_back(entry);
+		added = true;
+		return result;
+	}
+
+	const uint32_t bit = BranchBit(entry->hash, shift);
+	const size_t index = SlotIndex(result->bitmap, bit);
+
+	if ((result->bitmap & bit) == 0)
+	{
+		result->bitmap |= bit;
+		result->slots.insert(result->slots.begin() + index, {nullptr, entry});
+		added = true;
+		return result;
+	}
+
+	TrieSlot &slot = result->slots[index];
+
+	if (slot.entry == nullptr)
+	{
+		slot.child = SetEntry(slot.child.get(), entry, shift + BitsPerLevel, added);
+		return result;
+	}
+
+	if (IsEntryFor(*slot.entry, entry->hash, entry->pair.first))
+	{
+		slot.entry = entry;
+		return result;
+	}
+
+	// two keys in the same branch, push them a level down
+	slot.child = MergeEntries(slot.entry, entry, shift + BitsPerLevel);
+	slot.entry = nullptr;
+	added = true;
+	return result;
+}
+
+NodePtr EraseEntry(const NodePtr &node, uint64_t hash, const string_type &key, uint32_t shift, bool &removed) {
+	if (shift >= MaxShift)
+	{
+		for (size_t i = 0; i < node->collisions.size(); i++)
+		{
+			if (!IsEntryFor(*node->collisions[i], hash, key))
+			{
+				continue;
+			}
+
+			removed = true;
+			if (node->collisions.size() == 1)
+			{
+				return nullptr;
+			}
+
+			auto result = std::make_shared<PersistentTableNode>(*node);
+			result->collisions.erase(result->collisions.begin() + i);
+			return result;
+		}
+
+		return node;
+	}
+
+	const uint32_t bit = BranchBit(hash, shift);
+	if ((node->bitmap & bit) == 0)
+	{
+		return node;
+	}
+
+	const size_t index = SlotIndex(node->bitmap, bit);
+	const TrieSlot &slot = node->slots[index];
+
+	NodePtr child = nullptr;
+	if (slot.entry != nullptr)
+	{
+		if (!IsEntryFor(*slot.entry, hash, key))
+		{
+			return node;
+		}
+	}
+	else
+	{
+		child = EraseEntry(slot.child, hash, key, shift + BitsPerLevel, removed);
+		if (child == slot.child)
+		{
+			return node;
+		}
+	}
+
+	removed = true;
+
+	if (child == nullptr && node->slots.size() == 1)
+	{
+		return nullptr;
+	}
+
+	auto result = std::make_shared<PersistentTableNode>(*node);
+
+	if (child == nullptr)
+	{
+		result->bitmap &= ~bit;
+		result->slots.erase(result->slots.begin() + index);
+		return result;
+	}
+
+	EntryPtr sole_entry = SoleEntry(*child);
+	if (sole_entry != nullptr)
+	{
+		result->slots[index] = {nullptr, std::move(sole_entry)};
+	}
+	else
+	{
+		result->slots[index].child = std::move(child);
+	}
+
+	return result;
+}
+
+EntryPtr SoleEntry(const PersistentTableNode &node) {
+	if (node.slots.size() == 1 && node.collisions.empty())
+	{
+		return node.slots[0].entry;
+	}
+
+	if (node.slots.empty() && node.collisions.size() == 1)
+	{
+		return node.collisions[0];
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,159 @@
+#include "CryptScript.hpp"
+#include "VM.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+
+using crypt::OpcodeProfile;
+
+static constexpr size_t OpCodeCount = OpcodeCounts::OpCodeCount;
+
+// the `count` largest entries, largest first
+template <typename Entry>
+static void KeepHottest(std::vector<Entry> &entries, size_t count) {
+	const auto hotter = [](const Entry &left, const Entry &right) { return left.second > right.second; };
+
+	if (entries.size() > count)
+	{
+		std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), hotter);
+		entries.resize(count);
+	}
+	else
+	{
+		std::sort(entries.begin(), entries.end(), hotter);
+	}
+}
+
+namespace crypt
+{
+	OpcodeProfile::OpcodeProfile() : m_counts{std::make_unique<OpcodeCounts>()} {
+	}
+
+	OpcodeProfile::OpcodeProfile(const OpcodeProfile &copy) : OpcodeProfile() {
+		this->merge(copy);
+	}
+
+	OpcodeProfile::OpcodeProfile(OpcodeProfile &&move) noexcept = default;
+
+	OpcodeProfile &OpcodeProfile::operator=(const OpcodeProfile &copy) {
+		if (this != &copy)
+		{
+			this->clear();
+			this->merge(copy);
+		}
+		return *this;
+	}
+
+	OpcodeProfile &OpcodeProfile::operator=(OpcodeProfile &&move) noexcept = default;
+	OpcodeProfile::~OpcodeProfile() = default;
+
+	uint64_t OpcodeProfile::get_executed() const noexcept {
+		return m_counts ? m_counts->executed : 0;
+	}
+
+	std::vector<OpcodeProfile::Sequence> OpcodeProfile::get_pairs(size_t count) const {
+		std::vector<std::pair<size_t, uint64_t>> entries{};
+		if (m_counts)
+		{
+			for (size_t i = 0; i < OpCodeCount * OpCodeCount; i++)
+			{
+				if (m_counts->pairs[i] != 0)
+				{
+					entries.emplace_back(i, m_counts->pairs[i]);
+				}
+			}
+		}
+
+		KeepHottest(entries, count);
+
+		std::vector<Sequence> sequences{};
+		for (const auto &[index, hits] : entries)
+		{
+			Sequence &sequence = sequences.emplace_back();
+			sequence.names.emplace_back(GetOpCodeName(static_cast<OpCode>(index / OpCodeCount)));
+			sequence.names.emplace_back(GetOpCodeName(static_cast<OpCode>(index % OpCodeCount)));
+			sequence.count = hits;
+		}
+
+		return sequences;
+	}
+
+	std::vector<OpcodeProfile::Sequence> OpcodeProfile::get_triples(size_t count) const {
+		std::vector<std::pair<uint32_t, uint64_t>> entries{};
+		if (m_counts)
+		{
+			entries.assign(m_counts->triples.begin(), m_counts->triples.end());
+		}
+
+		KeepHottest(entries, count);
+
+		std::vector<Sequence> sequences{};
+		for (const auto &[key, hits] : entries)
+		{
+			Sequence &sequence = sequences.emplace_back();
+			sequence.names.emplace_back(GetOpCodeName(static_cast<OpCode>(key & 0xFF)));
+			sequence.names.emplace_back(GetOpCodeName(static_cast<OpCode>((key >> 8) & 0xFF)));
+			sequence.names.emplace_back(GetOpCodeName(static_cast<OpCode>((key >> 16) & 0xFF)));
+			sequence.count = hits;
+		}
+
+		return sequences;
+	}
+
+	void OpcodeProfile::merge(const OpcodeProfile &other) {
+		if (!other.m_counts || other.m_counts.get() == m_counts.get())
+		{
+			return;
+		}
+
+		if (!m_counts)
+		{
+			m_counts = std::make_unique<OpcodeCounts>();
+		}
+
+		m_counts->executed += other.m_counts->executed;
+		for (size_t i = 0; i < OpCodeCount * OpCodeCount; i++)
+		{
+			m_counts->pairs[i] += other.m_counts->pairs[i];
+		}
+
+		for (const auto &[key, hits] : other.m_counts->triples)
+		{
+			m_counts->triples[key] += hits;
+		}
+	}
+
+	void OpcodeProfile::clear() {
+		m_counts = std::make_unique<OpcodeCounts>();
+	}
+
+	string_type OpcodeProfile::report(size_t count) const {
+		const uint64_t executed = this->get_executed();
+
+		string_type result{};
+		const auto append = [&](const char *title, const std::vector<Sequence> &sequences) {
+			result.append(title).push_back('\n');
+
+			for (const Sequence &sequence : sequences)
+			{
+				char line[48];
+				snprintf(
+					line, sizeof(line), "%14llu %6.2f%%  ", static_cast<unsigned long long>(sequence.count),
+					executed ? 100.0 * static_cast<double>(sequence.count) / static_cast<double>(executed) : 0.0
+				);
+				result.append(line);
+
+				for (size_t i = 0; i < sequence.names.size(); i++)
+				{
+					result.append(i ? " " : "").append(sequence.names[i]);
+				}
+				result.push_back('\n');
+			}
+		};
+
+		result.append(std::to_string(executed)).append(" instructions\n");
+		append("pairs:", this->get_pairs(count));
+		append("triples:", this->get_triples(count));
+		return result;
+	}
+}
@@ -0,0 +1,425 @@
+#include "CryptReader.hpp"
+#include "Parser.hpp"
+
+#include <stdexcept>
+
+// `list` as a packed array when it's only ints (or only reals), the same value `Load()` builds
+static crypt::Variable PackNumbers(crypt::list_type &&list);
+
+struct ReaderFrame
+{
+	bool list;
+	// the document's table, it has no braces
+	bool root;
+	// a list element was read, a ',' (or the end) must follow
+	bool after_value;
+};
+
+namespace crypt
+{
+	struct ReaderState
+	{
+		std::vector<Token> tokens;
+		size_t index = 0;
+
+		std::vector<ReaderFrame> frames;
+		bool started = false;
+		// a key was read, its value comes next
+		bool expecting_value = false;
+
+		bool peeked = false;
+		ReadEvent peeked_event = ReadEvent::End;
+
+		TextPosition position = {};
+
+		string_type key;
+
+		VariableType value_type = VariableType::Null;
+		// the non-string scalars
+		Variable value;
+		string_type string;
+
+		ReadEvent read();
+		ReadEvent read_value();
+
+		void skip_useless();
+		[[noreturn]] void fail(const char *msg) const;
+
+		// `parse(token)`, its errors reported like the reader's own
+		template <typename _Parse>
+		inline Variable parse_scalar(_Parse &&parse, const Token &token) const {
+			try
+			{
+				return Variable(parse(token));
+			}
+			catch (const ParseError &error)
+			{
+				this->fail(error.what());
+			}
+		}
+	};
+}
+
+using crypt::ReadEvent;
+using crypt::ReaderState;
+
+namespace crypt
+{
+	Reader::Reader(const char_type *source, size_t length)
+		: m_state{new ReaderState()} {
+		try
+		{
+			Token::Parse(source, length, m_state->tokens);
+		}
+		catch (const TokenError &error)
+		{
+			m_state->position = error.pos;
+			m_state->fail(error.what());
+		}
+	}
+
+	Reader::~Reader() = default;
+
+	ReadEvent Reader::next() {
+		if (m_state->peeked)
+		{
+			m_state->peeked = false;
+			return m_state->peeked_event;
+		}
+
+		return m_state->read();
+	}
+
+	ReadEvent Reader::peek() {
+		if (!m_state->peeked)
+		{
+			m_state->peeked_event = m_state->read();
+			m_state->peeked = true;
+		}
+
+		return m_state->peeked_event;
+	}
+
+	void Reader::skip_value() {
+		size_t depth = 0;
+
+		do
+		{
+			switch (this->next())
+			{
+			case ReadEvent::ListBegin:
+			case ReadEvent::TableBegin:
+				depth++;
+				break;
+			case ReadEvent::ListEnd:
+			case ReadEvent::TableEnd:
+				depth--;
+				break;
+			case ReadEvent::End:
+				return;
+			default:
+				break;
+			}
+		} while (depth > 0);
+	}
+
+	Variable Reader::read_value() {
+		switch (this->next())
+		{
+		case ReadEvent::Value:
+			if (m_state->value_type == VariableType::Str)
+			{
+				return Variable(m_state->string);
+			}
+
+			return m_state->value;
+		case ReadEvent::ListBegin:
+			{
+				list_type list{};
+
+				while (this->peek() != ReadEvent::ListEnd)
+				{
+					list.push_back(this->read_value());
+				}
+
+				this->next();
+				return PackNumbers(std::move(list));
+			}
+		case ReadEvent::TableBegin:
+			{
+				Variable result{};
+				table_type &table = result._build_table();
+
+				while (this->next() == ReadEvent::Key)
+				{
+					Variable &value = table[m_state->key];
+					value = this->read_value();
+				}
+
+				return result;
+			}
+		default:
+			m_state->fail("expected a value");
+		}
+	}
+
+	const string_type &Reader::get_key() const {
+		return m_state->key;
+	}
+
+	VariableType Reader::get_value_type() const {
+		return m_state->value_type;
+	}
+
+	boolean_type Reader::get_bool() const {
+		if (m_state->value_type == VariableType::Str)
+		{
+			throw VariableAccessError("boolean");
+		}
+
+		return m_state->value.get_bool();
+	}
+
+	int_type Reader::get_int() const {
+		if (m_state->value_type == VariableType::Str)
+		{
+			throw VariableAccessError("int");
+		}
+
+		return m_state->value.get_int();
+	}
+
+	real_type Reader::get_real() const {
+		if (m_state->value_type == VariableType::Str)
+		{
+			throw VariableAccessError("real");
+		}
+
+		return m_state->value.get_real();
+	}
+
+	const string_type &Reader::get_string() const {
+		if (m_state->value_type != VariableType::Str)
+		{
+			throw VariableAccessError("string");
+		}
+
+		return m_state->string;
+	}
+
+	size_t Reader::get_line() const {
+		return m_state->position.line + 1;
+	}
+
+	size_t Reader::get_column() const {
+		return m_state->position.column + 1;
+	}
+
+	ReadEvent ReaderState::read() {
+		if (!started)
+		{
+			started = true;
+			frames.push_back({false, true, false});
+			return ReadEvent::TableBegin;
+		}
+
+		if (frames.empty())
+		{
+			return ReadEvent::End;
+		}
+
+		if (expecting_value)
+		{
+			expecting_value = false;
+			return this->read_value();
+		}
+
+		while (true)
+		{
+			ReaderFrame &frame = frames.back();
+			this->skip_useless();
+
+			if (index >= tokens.size())
+			{
+				if (!frame.root)
+				{
+					this->fail(frame.list ? "unterminated list" : "unterminated table");
+				}
+
+				frames.pop_back();
+				return ReadEvent::TableEnd;
+			}
+
+			const Token &token = tokens[index];
+			position = token.pos;
+
+			if (token.type == TokenType::BraceClose)
+			{
+				if (frame.root)
+				{
+					this->fail("unexpected '}'");
+				}
+
+				index++;
+				const bool list = frame.list;
+				frames.pop_back();
+				return list ? ReadEvent::ListEnd : ReadEvent::TableEnd;
+			}
+
+			if (frame.list)
+			{
+				if (frame.after_value)
+				{
+					if (token.type != TokenType::Comma)
+					{
+						this->fail("expected ',' between list elements");
+					}
+
+					index++;
+					frame.after_value = false;
+					continue;
+				}
+
+				frame.after_value = true;
+				return this->read_value();
+			}
+
+			// separators between the table entries are optional
+			if (token.type == TokenType::Comma)
+			{
+				index++;
+				continue;
+			}
+
+			if (!IsExpectedTokenTypeForTableKey(token.type))
+			{
+				this->fail("expected a key");
+			}
+
+			if (token.type == TokenType::String)
+			{
+				PreprocessTokenStr(token.content, token.content_length, key);
+			}
+			else
+			{
+				key.assign(token.content, token.content_length);
+			}
+
+			index++;
+			this->skip_useless();
+
+			if (index >= tokens.size() || tokens[index].type != TokenType::AssignOp)
+			{
+				this->fail("expected '=' after the key");
+			}
+
+			index++;
+			expecting_value = true;
+			return ReadEvent::Key;
+		}
+	}
+
+	ReadEvent ReaderState::read_value() {
+		this->skip_useless();
+
+		if (index >= tokens.size())
+		{
+			this->fail("expected a value");
+		}
+
+		const Token &token = tokens[index];
+		position = token.pos;
+
+		switch (token.type)
+		{
+		case TokenType::Null:
+			value_type = VariableType::Null;
+			value = Variable();
+			break;
+		case TokenType::Boolean:
+			value_type = VariableType::Bool;
+			value = this->parse_scalar(ParseBoolean, token);
+			break;
+		case TokenType::Integer:
+			value_type = VariableType::Int;
+			value = this->parse_scalar(ParseInt, token);
+			break;
+		case TokenType::Real:
+			value_type = VariableType::Real;
+			value = this->parse_scalar(ParseReal, token);
+			break;
+		case TokenType::String:
+			value_type = VariableType::Str;
+			PreprocessTokenStr(token.content, token.content_length, string);
+			break;
+		case TokenType::BraceOpen:
+			{
+				// like in the parser: `{}` is a list, objects that are neither are read (and fail) as tables
+				const bool list = GetObjectType(tokens.data() + index, tokens.size() - index) == eObjType_List;
+
+				index++;
+				frames.push_back({list, false, false});
+				return list ? ReadEvent::ListBegin : ReadEvent::TableBegin;
+			}
+		default:
+			this->fail("invalid token for a value");
+		}
+
+		index++;
+		return ReadEvent::Value;
+	}
+
+	void ReaderState::skip_useless() {
+		index += NextUsefulTokenIndex(tokens.data() + index, tokens.size() - index);
+	}
+
+	void ReaderState::fail(const char *msg) const {
+		throw std::runtime_error(
+			string_type(msg) + " at " + std::to_string(position.line + 1) + ":" + std::to_string(position.column + 1)
+		);
+	}
+}
+
+crypt::Variable PackNumbers(crypt::list_type &&list) {
+	using crypt::VariableType;
+
+	const VariableType type = list.empty() ? VariableType::Null : list[0].get_type();
+	const auto homogeneous = [&]() {
+		for (const crypt::Variable &element : list)
+		{
+			if (element.get_type() != type)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	if (type == VariableType::Int && homogeneous())
+	{
+		crypt::Variable result{};
+		crypt::int_array_type &values = result._build_int_array();
+		values.reserve(list.size());
+
+		for (const crypt::Variable &element : list)
+		{
+			values.push_back(element.get_int());
+		}
+		return result;
+	}
+
+	if (type == VariableType::Real && homogeneous())
+	{
+		crypt::Variable result{};
+		crypt::real_array_type &values = result._build_real_array();
+		values.reserve(list.size());
+
+		for (const crypt::Variable &element : list)
+		{
+			values.push_back(element.get_real());
+		}
+		return result;
+	}
+
+	return crypt::Variable(std::move(list));
+}
@@ -0,0 +1,111 @@
+#include "CryptScheduler.hpp"
+
+namespace crypt
+{
+	ScriptScheduler::ScriptScheduler(size_t workers, size_t quantum) : m_quantum{quantum > 0 ? quantum : 1} {
+		if (workers == 0)
+		{
+			workers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		m_workers.reserve(workers);
+		for (size_t i = 0; i < workers; i++)
+		{
+			m_workers.emplace_back(&ScriptScheduler::_work, this);
+		}
+	}
+
+	ScriptScheduler::~ScriptScheduler() {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stopping = true;
+		}
+
+		m_ready.notify_all();
+
+		for (std::thread &worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	std::future<ScriptResult> ScriptScheduler::submit(const Script &script, table_type globals) {
+		auto job = std::make_unique<Job>(Job{ScriptTask(script, std::move(globals)), {}});
+		std::future<ScriptResult> result = job->promise.get_future();
+
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_queue.push_back(std::move(job));
+			m_pending++;
+		}
+
+		m_ready.notify_one();
+		return result;
+	}
+
+	size_t ScriptScheduler::get_pending() const {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_pending;
+	}
+
+	void ScriptScheduler::_work() {
+		for (;;)
+		{
+			std::unique_ptr<Job> job{};
+
+			{
+				std::unique_lock<std::mutex> lock{m_mutex};
+				m_ready.wait(lock, [this] { return !m_queue.empty() || (m_stopping && m_pending == 0); });
+
+				// stopping only once the runs still being resumed elsewhere are done too
+				if (m_queue.empty())
+				{
+					return;
+				}
+
+				job = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
+
+			bool finished = true;
+			try
+			{
+				finished = job->task.resume(m_quantum);
+
+				if (finished)
+				{
+					job->promise.set_value({job->task.get_result(), std::move(job->task.get_globals())});
+				}
+			}
+			catch (...)
+			{
+				job->promise.set_exception(std::current_exception());
+			}
+
+			bool drained = false;
+			{
+				std::lock_guard<std::mutex> lock{m_mutex};
+
+				if (finished)
+				{
+					drained = --m_pending == 0;
+				}
+				else
+				{
+					// to the back, behind the runs that waited meanwhile
+					m_queue.push_back(std::move(job));
+				}
+			}
+
+			if (!finished)
+			{
+				m_ready.notify_one();
+			}
+			else if (drained)
+			{
+				// stopping workers wait for the last run
+				m_ready.notify_all();
+			}
+		}
+	}
+}
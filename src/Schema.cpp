@@ -0,0 +1,217 @@
+#include "CryptSchema.hpp"
+#include "CryptReader.hpp"
+
+#include <unordered_map>
+#include <stdexcept>
+
+struct SchemaField
+{
+	size_t slot;
+	crypt::VariableType type;
+	// the keys of a nested table, its own slot is unused
+	std::shared_ptr<const crypt::SchemaLevel> nested;
+};
+
+namespace crypt
+{
+	struct SchemaLevel
+	{
+		std::unordered_map<string_type, SchemaField> fields;
+	};
+}
+
+using crypt::Schema;
+using crypt::SchemaLevel;
+using crypt::VariableType;
+
+struct SchemaTypeName
+{
+	const char *name;
+	VariableType type;
+};
+
+static constexpr SchemaTypeName SchemaTypeNames[] = {
+	{ "any", Schema::any_type },
+	{ "null", VariableType::Null },
+	{ "bool", VariableType::Bool },
+	{ "int", VariableType::Int },
+	{ "real", VariableType::Real },
+	{ "string", VariableType::Str },
+	{ "list", VariableType::List },
+	{ "table", VariableType::Table },
+};
+
+static std::shared_ptr<const SchemaLevel> CompileLevel(
+	const crypt::table_type &definition, const crypt::string_type &prefix,
+	std::vector<crypt::string_type> &paths, std::vector<VariableType> &types
+);
+static VariableType TypeFromName(const crypt::string_type &name);
+// whether `value` fits `type`, converting ints to reals in place for real slots
+static bool MatchType(crypt::Variable &value, VariableType type);
+static void ParseLevel(
+	crypt::Reader &reader, const SchemaLevel &level, const crypt::string_type &prefix,
+	std::vector<crypt::Variable> &slots, std::vector<bool> &present, std::vector<crypt::SchemaIssue> &issues
+);
+
+namespace crypt
+{
+	Schema Schema::Compile(const Variable &definition) {
+		Schema schema{};
+		schema.m_root = CompileLevel(definition.get_table(), {}, schema.m_paths, schema.m_types);
+		return schema;
+	}
+
+	Schema Schema::Compile(const char_type *source, size_t length) {
+		return Compile(Load(source, length));
+	}
+
+	size_t Schema::find_slot(const string_type &path) const {
+		const SchemaLevel *level = m_root.get();
+		size_t start = 0;
+
+		while (level != nullptr)
+		{
+			const size_t dot = path.find('.', start);
+			const auto iter = level->fields.find(path.substr(start, dot - start));
+
+			if (iter == level->fields.end())
+			{
+				return npos;
+			}
+
+			if (dot == string_type::npos)
+			{
+				return iter->second.nested == nullptr ? iter->second.slot : npos;
+			}
+
+			level = iter->second.nested.get();
+			start = dot + 1;
+		}
+
+		return npos;
+	}
+
+	SlotDocument Schema::parse(const char_type *source, size_t length) const {
+		SlotDocument document{};
+		document.m_slots.resize(m_paths.size());
+		document.m_present.resize(m_paths.size());
+
+		Reader reader{source, length};
+		reader.next();
+
+		ParseLevel(reader, *m_root, {}, document.m_slots, document.m_present, document.m_issues);
+		return document;
+	}
+}
+
+std::shared_ptr<const SchemaLevel> CompileLevel(
+	const crypt::table_type &definition, const crypt::string_type &prefix,
+	std::vector<crypt::string_type> &paths, std::vector<VariableType> &types
+) {
+	auto level = std::make_shared<SchemaLevel>();
+
+	for (const auto &[key, value] : definition)
+	{
+		SchemaField field{paths.size(), VariableType::Null, nullptr};
+
+		// the slot is reserved for nested tables too, keeping the indices stable
+		paths.push_back(prefix + key);
+		types.push_back(VariableType::Table);
+
+		if (value.get_type() == VariableType::Table)
+		{
+			field.type = VariableType::Table;
+			field.nested = CompileLevel(value.get_table(), prefix + key + '.', paths, types);
+		}
+		else
+		{
+			field.type = TypeFromName(value.get_string());
+			types[field.slot] = field.type;
+		}
+
+		level->fields.emplace(key, std::move(field));
+	}
+
+	return level;
+}
+
+VariableType TypeFromName(const crypt::string_type &name) {
+	for (const SchemaTypeName &type_name : SchemaTypeNames)
+	{
+		if (name == type_name.name)
+		{
+			return type_name.type;
+		}
+	}
+
+	throw std::invalid_argument("unknown schema type '" + name + "'");
+}
+
+bool MatchType(crypt::Variable &value, VariableType type) {
+	if (type == Schema::any_type)
+	{
+		return true;
+	}
+
+	switch (type)
+	{
+	case VariableType::Real:
+		if (value.get_type() == VariableType::Int)
+		{
+			value = value.get_real();
+			return true;
+		}
+
+		return value.get_type() == VariableType::Real;
+	case VariableType::List:
+		return value.is_list();
+	default:
+		return value.get_type() == type;
+	}
+}
+
+void ParseLevel(
+	crypt::Reader &reader, const SchemaLevel &level, const crypt::string_type &prefix,
+	std::vector<crypt::Variable> &slots, std::vector<bool> &present, std::vector<crypt::SchemaIssue> &issues
+) {
+	using crypt::ReadEvent;
+
+	while (reader.next() == ReadEvent::Key)
+	{
+		const auto iter = level.fields.find(reader.get_key());
+
+		if (iter == level.fields.end())
+		{
+			issues.push_back({crypt::SchemaIssueKind::UnknownKey, prefix + reader.get_key(), reader.get_line(), reader.get_column()});
+			reader.skip_value();
+			continue;
+		}
+
+		const SchemaField &field = iter->second;
+
+		if (field.nested != nullptr)
+		{
+			if (reader.peek() != ReadEvent::TableBegin)
+			{
+				issues.push_back({crypt::SchemaIssueKind::TypeMismatch, prefix + iter->first, reader.get_line(), reader.get_column()});
+				reader.skip_value();
+				continue;
+			}
+
+			reader.next();
+			present[field.slot] = true;
+			ParseLevel(reader, *field.nested, prefix + iter->first + '.', slots, present, issues);
+			continue;
+		}
+
+		crypt::Variable value = reader.read_value();
+		if (!MatchType(value, field.type))
+		{
+			issues.push_back({crypt::SchemaIssueKind::TypeMismatch, prefix + iter->first, reader.get_line(), reader.get_column()});
+			continue;
+		}
+
+		slots[field.slot] = std::move(value);
+		present[field.slot] = true;
+	}
+}
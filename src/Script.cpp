@@ -0,0 +1,346 @@
+#include "CryptScript.hpp"
+#include "CryptSerialize.hpp"
+#include "BytecodeCache.hpp"
+#include "Compiler.hpp"
+#include "Hash.hpp"
+#include "Optimizer.hpp"
+#include "Peephole.hpp"
+#include "VM.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+using crypt::Program;
+using crypt::Variable;
+
+// the slots only hold values during a run, so the globals' payloads aren't kept shared between runs
+static void LoadGlobals(const Program &program, const crypt::table_type &globals, std::vector<Variable> &slots) {
+	slots.resize(program.globals.size());
+
+	for (size_t i = 0; i < program.globals.size(); i++)
+	{
+		const auto found = globals.find(program.globals[i]);
+		if (found != globals.end())
+		{
+			slots[i] = found->second;
+		}
+	}
+}
+
+static void ClearGlobals(std::vector<Variable> &slots) {
+	for (Variable &slot : slots)
+	{
+		slot.set_null();
+	}
+}
+
+// writes back the globals the program assigns
+static void StoreGlobals(const Program &program, std::vector<Variable> &slots, crypt::table_type &globals) {
+	for (const uint32_t index : program.written_globals)
+	{
+		globals[program.globals[index]] = std::move(slots[index]);
+	}
+
+	ClearGlobals(slots);
+}
+
+namespace crypt
+{
+	Script Script::Compile(const char_type *source, size_t length) {
+		return Compile(source, length, ScriptOptions{});
+	}
+
+	Script Script::Compile(const char_type *source, size_t length, const ScriptOptions &options) {
+		if (options.cache_dir.empty())
+		{
+			return _compile(source, length, options);
+		}
+
+		if (length == 0 && source != nullptr)
+		{
+			length = strlen(source);
+		}
+
+		// the options change the bytecode, so they are part of the key
+		CacheKey key = CacheKey::Of(source, length);
+		key.hash = HashCombine(key.hash, (options.optimize ? 1 : 0) | (options.fuse ? 2 : 0));
+
+		std::shared_ptr<Program> program{};
+		if (ReadBytecodeCache(options.cache_dir, key, program))
+		{
+			if (options.stats)
+			{
+				*options.stats = ScriptStats{};
+				options.stats->instructions = program->code.size();
+				options.stats->from_cache = true;
+			}
+
+			Script script{};
+			script.m_program = std::move(program);
+			return script;
+		}
+
+		Script script = _compile(source, length, options);
+		if (script.m_program->natives.empty())
+		{
+			WriteBytecodeCache(options.cache_dir, key, *script.m_program);
+		}
+
+		return script;
+	}
+
+	Script Script::_compile(const char_type *source, size_t length, const ScriptOptions &options) {
+		std::vector<Token> tokens{};
+		try
+		{
+			Token::Parse(source, length, tokens);
+		}
+		catch (const TokenError &error)
+		{
+			throw ScriptError(error.what(), error.pos.line + 1, error.pos.column + 1);
+		}
+
+		Symbol root = Symbol::Parse(tokens.data(), tokens.size());
+
+		ScriptStats stats{};
+		if (options.optimize)
+		{
+			OptimizeScript(root, stats, options.natives);
+		}
+
+		std::shared_ptr<Program> program = CompileProgram(root, options.natives);
+		if (options.fuse)
+		{
+			stats.fused_sequences = FuseInstructions(*program);
+		}
+
+		if (options.stats)
+		{
+			stats.instructions = program->code.size();
+			*options.stats = stats;
+		}
+
+		Script script{};
+		script.m_program = std::move(program);
+		return script;
+	}
+
+	Variable Script::run(table_type &globals) const {
+		static thread_local ScriptContext context{};
+		return context.run(*this, globals);
+	}
+
+	Variable Script::run() const {
+		table_type globals{};
+		return this->run(globals);
+	}
+
+	size_t Script::get_instruction_count() const {
+		return m_program ? m_program->code.size() : 0;
+	}
+
+	ScriptContext::ScriptContext() : m_state{std::make_unique<ExecutionState>()} {
+	}
+
+	ScriptContext::ScriptContext(ScriptContext &&move) noexcept = default;
+	ScriptContext &ScriptContext::operator=(ScriptContext &&move) noexcept = default;
+	ScriptContext::~ScriptContext() = default;
+
+	Variable ScriptContext::run(const Script &script, table_type &globals) {
+		return this->_run(script, globals, nullptr);
+	}
+
+	Variable ScriptContext::run(const Script &script, table_type &globals, OpcodeProfile &profile) {
+		// a moved-from profile starts over
+		if (!profile.m_counts)
+		{
+			profile.clear();
+		}
+
+		return this->_run(script, globals, profile.m_counts.get());
+	}
+
+	Variable ScriptContext::_run(const Script &script, table_type &globals, OpcodeCounts *counts) {
+		if (!script.m_program)
+		{
+			return Variable();
+		}
+
+		// a script run from inside another run on this context (like from a host callback)
+		if (!m_state || m_state->running)
+		{
+			ScriptContext nested{};
+			return nested._run(script, globals, counts);
+		}
+
+		const Program &program = *script.m_program;
+		ExecutionState &state = *m_state;
+
+		LoadGlobals(program, globals, state.globals);
+
+		struct RunGuard
+		{
+			ExecutionState &state;
+
+			inline RunGuard(ExecutionState &_state) : state{_state} { state.running = true; }
+			inline ~RunGuard() {
+				state.running = false;
+				ClearGlobals(state.globals);
+			}
+		} guard{state};
+
+		FieldCache *const field_caches = state.caches.fields(script.m_program);
+
+		Variable result{};
+		if (counts)
+		{
+			result = ExecuteProfiled(program, state.globals.data(), state, field_caches, *counts);
+		}
+		else
+		{
+			uint64_t budget = UnlimitedBudget;
+			result = Execute(program, state.globals.data(), state, field_caches, budget);
+		}
+
+		StoreGlobals(program, state.globals, globals);
+		return result;
+	}
+
+	ScriptTask::ScriptTask(const Script &script, table_type globals)
+		: m_program{script.m_program}, m_globals{std::move(globals)} {
+		if (!m_program)
+		{
+			m_finished = true;
+			return;
+		}
+
+		m_state = std::make_unique<ExecutionState>();
+		LoadGlobals(*m_program, m_globals, m_state->globals);
+	}
+
+	ScriptTask::ScriptTask(ScriptTask &&move) noexcept = default;
+	ScriptTask &ScriptTask::operator=(ScriptTask &&move) noexcept = default;
+	ScriptTask::~ScriptTask() = default;
+
+	bool ScriptTask::resume(size_t budget) {
+		if (m_finished)
+		{
+			return true;
+		}
+
+		if (budget == 0)
+		{
+			return false;
+		}
+
+		// the caches of whichever thread resumes the task
+		static thread_local InlineCaches caches{};
+
+		uint64_t remaining = budget;
+		try
+		{
+			Variable result = Execute(*m_program, m_state->globals.data(), *m_state, caches.fields(m_program), remaining);
+			m_executed += budget - remaining;
+
+			if (m_state->suspended)
+			{
+				return false;
+			}
+
+			m_result = std::move(result);
+		}
+		catch (const ScriptError &)
+		{
+			m_executed += budget - remaining;
+			m_finished = true;
+			m_state.reset();
+			throw;
+		}
+
+		StoreGlobals(*m_program, m_state->globals, m_globals);
+
+		// the stack isn't needed anymore
+		m_finished = true;
+		m_state.reset();
+		return true;
+	}
+
+	string_type Script::disassemble() const {
+		if (!m_program)
+		{
+			return {};
+		}
+
+		const Program &program = *m_program;
+
+		SerializeOptions options{};
+		options.document = false;
+
+		string_type result{};
+		for (const FunctionInfo &function : program.functions)
+		{
+			char header[96];
+			snprintf(
+				header, sizeof(header), ": entry %04u, %u params, %u locals, %u stack\n",
+				function.entry, function.param_count, function.local_count, function.max_stack
+			);
+
+			result.append(function.name).append(header);
+		}
+
+		for (size_t i = 0; i < program.code.size(); i++)
+		{
+			const OpCode op = GetOpCode(program.code[i]);
+			const uint32_t operand = GetOperand(program.code[i]);
+
+			// `PushInt` operands are signed
+			const long long shown = op == OpCode::PushInt ? SignExtendOperand(operand) : static_cast<long long>(operand);
+
+			char line[64];
+			snprintf(line, sizeof(line), "%04zu  %-24s %lld", i, GetOpCodeName(op), shown);
+			result.append(line);
+
+			if (const size_t fused = FusedLength(op))
+			{
+				result.append("  ; runs the next ").append(std::to_string(fused));
+			}
+
+			switch (op)
+			{
+			case OpCode::PushConst:
+				result.append("  ; ").append(Serialize(program.constants[operand], options));
+				break;
+			case OpCode::LoadGlobal:
+			case OpCode::StoreGlobal:
+				result.append("  ; ").append(program.globals[operand]);
+				break;
+			case OpCode::Call:
+				result.append("  ; ").append(program.functions[operand].name);
+				break;
+			case OpCode::CallNative:
+				result.append("  ; native ").append(program.natives[operand].name);
+				break;
+			case OpCode::GetField:
+				result.append("  ; .").append(program.field_keys[operand]);
+				break;
+			case OpCode::StoreField:
+				{
+					const FieldTarget &target = program.field_targets[operand];
+					result.append(target.global ? "  ; global " : "  ; local ").append(std::to_string(target.slot));
+
+					for (const CryptString &key : target.keys)
+					{
+						result.append(".").append(key);
+					}
+				}
+				break;
+			default:
+				break;
+			}
+
+			result.push_back('\n');
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,550 @@
+#include "Parser.hpp"
+#include "CryptScript.hpp"
+
+using crypt::ScriptError;
+
+// walks the useful tokens of a script, skipping whitespace, newlines and comments
+class TokenCursor
+{
+public:
+	inline TokenCursor(const Token *tokens, size_t count) : m_tokens{tokens}, m_count{count} {
+		this->_skip();
+	}
+
+	// nullptr at the end
+	inline const Token *peek() const noexcept { return m_index < m_count ? &m_tokens[m_index] : nullptr; }
+	inline bool peek_is(TokenType type) const noexcept { return peek() && peek()->type == type; }
+
+	inline const Token &next() {
+		const Token &token = this->current();
+		m_index++;
+		this->_skip();
+		return token;
+	}
+
+	// throws if at the end
+	const Token &current() const;
+
+	// whether the token right after the current one is `type`, without skipping anything
+	inline bool adjacent_is(TokenType type) const noexcept {
+		return m_index + 1 < m_count && m_tokens[m_index + 1].type == type;
+	}
+
+	const Token &expect(TokenType type, const char *what);
+
+	// the remaining raw tokens, for reading literals with `ParseValue()`
+	inline const Token *raw() const noexcept { return &m_tokens[m_index]; }
+	inline size_t raw_count() const noexcept { return m_count - m_index; }
+	inline void skip_raw(size_t count) {
+		m_index += count;
+		this->_skip();
+	}
+
+	[[noreturn]] void fail(const std::string &message) const;
+	[[noreturn]] static void Fail(const std::string &message, const TextPosition &pos);
+
+private:
+	inline void _skip() { m_index += NextUsefulTokenIndex(&m_tokens[m_index], m_count - m_index); }
+
+private:
+	const Token *m_tokens;
+	size_t m_count;
+	size_t m_index = 0;
+};
+
+static void ParseStatement(TokenCursor &cursor, Symbol &out, bool root);
+/// parses statements until the end of the tokens or (unless `root`) a block terminator:
+/// `end`, `elif` or `else`, which is left unread
+static void ParseBlock(TokenCursor &cursor, Symbol &out, bool root);
+static void ParseFunction(TokenCursor &cursor, Symbol &out);
+static void ParseIf(TokenCursor &cursor, Symbol &out);
+static void ParseWhile(TokenCursor &cursor, Symbol &out);
+
+static void ParseExpression(TokenCursor &cursor, Symbol &out, int min_precedence = 1);
+static void _ParseUnary(TokenCursor &cursor, Symbol &out);
+static void _ParsePrimary(TokenCursor &cursor, Symbol &out);
+
+/// zero for tokens that aren't binary operators
+static inline int BinaryPrecedence(TokenType type);
+static inline bool IsCompoundAssignOp(TokenType type);
+static inline bool IsBlockTerminator(TokenType type);
+static inline bool EndsOperand(TokenType type);
+
+// `a -1` is tokenized as `a` followed by the number `-1`, split such numbers
+// back into a minus and a number when they come right after an operand
+static void SplitNegativeNumbers(std::vector<Token> &tokens);
+
+Symbol Symbol::Parse(const Token *tokens, size_t count) {
+	std::vector<Token> script_tokens{tokens, tokens + count};
+	SplitNegativeNumbers(script_tokens);
+
+	Symbol base;
+	base.type = SymbolType::Block;
+
+	TokenCursor cursor{script_tokens.data(), script_tokens.size()};
+	ParseBlock(cursor, base, true);
+
+	return base;
+}
+
+void ParseBlock(TokenCursor &cursor, Symbol &out, bool root) {
+	while (const Token *token = cursor.peek())
+	{
+		if (IsBlockTerminator(token->type))
+		{
+			if (root)
+			{
+				cursor.fail("unexpected '" + CryptString(token->content, token->content_length) + "'");
+			}
+
+			return;
+		}
+
+		ParseStatement(cursor, out.children.emplace_back(), root);
+	}
+
+	if (!root)
+	{
+		cursor.fail("expected 'end'");
+	}
+}
+
+void ParseStatement(TokenCursor &cursor, Symbol &out, bool root) {
+	const Token &head = cursor.current();
+	out.pos = head.pos;
+
+	switch (head.type)
+	{
+	case TokenType::KW_Function:
+		if (!root)
+		{
+			cursor.fail("functions can only be declared at the top level");
+		}
+
+		ParseFunction(cursor, out);
+		return;
+	case TokenType::KW_If:
+		ParseIf(cursor, out);
+		return;
+	case TokenType::KW_While:
+		ParseWhile(cursor, out);
+		return;
+	case TokenType::KW_Return:
+		{
+			cursor.next();
+			out.type = SymbolType::Return;
+
+			// a bare `return` is followed by the end of its block
+			const Token *value = cursor.peek();
+			if (value != nullptr && !IsBlockTerminator(value->type))
+			{
+				ParseExpression(cursor, out.children.emplace_back());
+			}
+		}
+		return;
+	case TokenType::Identifier:
+		{
+			// look past the name (and any fields of it) for an assignment
+			TokenCursor lookahead = cursor;
+			lookahead.next();
+
+			std::vector<Symbol> fields{};
+			while (lookahead.peek_is(TokenType::Dot))
+			{
+				lookahead.next();
+				const Token &field = lookahead.expect(TokenType::Identifier, "a field name");
+
+				Symbol &symbol = fields.emplace_back();
+				symbol.type = SymbolType::Identifier;
+				symbol.pos = field.pos;
+				symbol.name = CryptString(field.content, field.content_length);
+			}
+
+			const Token *op = lookahead.peek();
+			if (op != nullptr && (op->type == TokenType::AssignOp || IsCompoundAssignOp(op->type)))
+			{
+				out.type = fields.empty() ? SymbolType::Assign : SymbolType::AssignField;
+				out.op = op->type;
+				out.name = CryptString(head.content, head.content_length);
+
+				cursor = lookahead;
+				cursor.next();
+				ParseExpression(cursor, out.children.emplace_back());
+
+				for (Symbol &field : fields)
+				{
+					out.children.emplace_back(std::move(field));
+				}
+				return;
+			}
+
+			if (op != nullptr && op->type == TokenType::BitNotEqOp)
+			{
+				lookahead.fail("'~=' isn't supported in scripts");
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	// an expression evaluated for its side effects, like a call
+	ParseExpression(cursor, out);
+}
+
+void ParseFunction(TokenCursor &cursor, Symbol &out) {
+	cursor.next(); // 'function'
+
+	const Token &name = cursor.expect(TokenType::Identifier, "a function name");
+	out.type = SymbolType::Function;
+	out.name = CryptString(name.content, name.content_length);
+
+	cursor.expect(TokenType::ParenthesisOpen, "'('");
+	while (!cursor.peek_is(TokenType::ParenthesisClose))
+	{
+		const Token &parameter = cursor.expect(TokenType::Identifier, "a parameter name");
+
+		Symbol &symbol = out.children.emplace_back();
+		symbol.type = SymbolType::Identifier;
+		symbol.pos = parameter.pos;
+		symbol.name = CryptString(parameter.content, parameter.content_length);
+
+		if (!cursor.peek_is(TokenType::Comma))
+		{
+			break;
+		}
+
+		cursor.next();
+	}
+
+	cursor.expect(TokenType::ParenthesisClose, "')'");
+	cursor.expect(TokenType::KW_BlockBegin, "'do'");
+
+	Symbol &body = out.children.emplace_back();
+	body.type = SymbolType::Block;
+	body.pos = out.pos;
+	ParseBlock(cursor, body, false);
+
+	cursor.expect(TokenType::KW_BlockEnd, "'end'");
+}
+
+void ParseIf(TokenCursor &cursor, Symbol &out) {
+	cursor.next(); // 'if'
+	out.type = SymbolType::If;
+
+	for (;;)
+	{
+		ParseExpression(cursor, out.children.emplace_back());
+		cursor.expect(TokenType::KW_BlockBegin, "'then'");
+
+		Symbol &block = out.children.emplace_back();
+		block.type = SymbolType::Block;
+		block.pos = out.pos;
+		ParseBlock(cursor, block, false);
+
+		if (cursor.peek_is(TokenType::KW_Elif))
+		{
+			cursor.next();
+			continue;
+		}
+
+		if (cursor.peek_is(TokenType::KW_Else))
+		{
+			cursor.next();
+
+			Symbol &otherwise = out.children.emplace_back();
+			otherwise.type = SymbolType::Block;
+			otherwise.pos = out.pos;
+			ParseBlock(cursor, otherwise, false);
+		}
+
+		break;
+	}
+
+	cursor.expect(TokenType::KW_BlockEnd, "'end'");
+}
+
+void ParseWhile(TokenCursor &cursor, Symbol &out) {
+	cursor.next(); // 'while'
+	out.type = SymbolType::While;
+
+	ParseExpression(cursor, out.children.emplace_back());
+	cursor.expect(TokenType::KW_BlockBegin, "'do'");
+
+	Symbol &body = out.children.emplace_back();
+	body.type = SymbolType::Block;
+	body.pos = out.pos;
+	ParseBlock(cursor, body, false);
+
+	cursor.expect(TokenType::KW_BlockEnd, "'end'");
+}
+
+void ParseExpression(TokenCursor &cursor, Symbol &out, int min_precedence) {
+	_ParseUnary(cursor, out);
+
+	// precedence climbing, all binary operators are left associative
+	for (;;)
+	{
+		const Token *op = cursor.peek();
+		const int precedence = op ? BinaryPrecedence(op->type) : 0;
+
+		if (precedence < min_precedence || precedence == 0)
+		{
+			return;
+		}
+
+		cursor.next();
+
+		Symbol left = std::move(out);
+		out = Symbol{};
+		out.type = SymbolType::Binary;
+		out.op = op->type;
+		out.pos = op->pos;
+		out.children.emplace_back(std::move(left));
+
+		ParseExpression(cursor, out.children.emplace_back(), precedence + 1);
+	}
+}
+
+void _ParseUnary(TokenCursor &cursor, Symbol &out) {
+	const Token &head = cursor.current();
+
+	if (head.type == TokenType::SubOp || head.type == TokenType::NotOp || head.type == TokenType::BitNotOp)
+	{
+		cursor.next();
+
+		out.type = SymbolType::Unary;
+		out.op = head.type;
+		out.pos = head.pos;
+		_ParseUnary(cursor, out.children.emplace_back());
+		return;
+	}
+
+	_ParsePrimary(cursor, out);
+
+	// field accesses bind tighter than any operator
+	while (cursor.peek_is(TokenType::Dot))
+	{
+		const Token &dot = cursor.next();
+		const Token &field = cursor.expect(TokenType::Identifier, "a field name");
+
+		Symbol table = std::move(out);
+		out = Symbol{};
+		out.type = SymbolType::Field;
+		out.pos = dot.pos;
+		out.name = CryptString(field.content, field.content_length);
+		out.children.emplace_back(std::move(table));
+	}
+}
+
+void _ParsePrimary(TokenCursor &cursor, Symbol &out) {
+	const Token &head = cursor.current();
+	out.pos = head.pos;
+
+	switch (head.type)
+	{
+	case TokenType::Identifier:
+		out.name = CryptString(head.content, head.content_length);
+
+		// a call needs its '(' right after the name, `f (x)` is `f` followed by `(x)`
+		if (!cursor.adjacent_is(TokenType::ParenthesisOpen))
+		{
+			cursor.next();
+			out.type = SymbolType::Identifier;
+			return;
+		}
+
+		out.type = SymbolType::Call;
+		cursor.next();
+		cursor.next(); // '('
+
+		while (!cursor.peek_is(TokenType::ParenthesisClose))
+		{
+			ParseExpression(cursor, out.children.emplace_back());
+
+			if (!cursor.peek_is(TokenType::Comma))
+			{
+				break;
+			}
+
+			cursor.next();
+		}
+
+		cursor.expect(TokenType::ParenthesisClose, "')'");
+		return;
+	case TokenType::ParenthesisOpen:
+		cursor.next();
+		ParseExpression(cursor, out);
+		cursor.expect(TokenType::ParenthesisClose, "')'");
+		return;
+	case TokenType::Null:
+	case TokenType::Boolean:
+	case TokenType::Integer:
+	case TokenType::Real:
+	case TokenType::String:
+	case TokenType::BraceOpen:
+		{
+			out.type = SymbolType::Value;
+
+			size_t count = cursor.raw_count();
+			try
+			{
+				ParseValue(cursor.raw(), count, out.value);
+			}
+			catch (const ParseError &error)
+			{
+				TokenCursor::Fail(error.what(), error.pos);
+			}
+			catch (const std::exception &error)
+			{
+				cursor.fail(error.what());
+			}
+
+			cursor.skip_raw(count);
+		}
+		return;
+	default:
+		cursor.fail("expected an expression");
+	}
+}
+
+const Token &TokenCursor::current() const {
+	const Token *token = this->peek();
+	if (token == nullptr)
+	{
+		this->fail("unexpected end of script");
+	}
+
+	return *token;
+}
+
+const Token &TokenCursor::expect(TokenType type, const char *what) {
+	if (!this->peek_is(type))
+	{
+		this->fail(std::string("expected ") + what);
+	}
+
+	return this->next();
+}
+
+void TokenCursor::fail(const std::string &message) const {
+	if (m_index < m_count)
+	{
+		Fail(message, m_tokens[m_index].pos);
+	}
+
+	// past the last token, point at the end of it
+	TextPosition pos{};
+	if (m_count > 0)
+	{
+		pos = m_tokens[m_count - 1].pos;
+		pos.column += static_cast<uint32_t>(m_tokens[m_count - 1].content_length);
+	}
+
+	Fail(message, pos);
+}
+
+void TokenCursor::Fail(const std::string &message, const TextPosition &pos) {
+	throw ScriptError(message, pos.line + 1, pos.column + 1);
+}
+
+void SplitNegativeNumbers(std::vector<Token> &tokens) {
+	TokenType previous = TokenType::Unknown;
+
+	for (size_t i = 0; i < tokens.size(); i++)
+	{
+		const Token token = tokens[i];
+
+		if (token.type == TokenType::CommentPrefix)
+		{
+			// comments run to the end of the line and don't count as operands
+			while (i + 1 < tokens.size() && tokens[i + 1].type != TokenType::Newline)
+			{
+				i++;
+			}
+			continue;
+		}
+
+		if (token.type == TokenType::Whitespace || token.type == TokenType::Newline)
+		{
+			continue;
+		}
+
+		const bool negative_number = (token.type == TokenType::Integer || token.type == TokenType::Real) &&
+			token.content_length > 1 && token.content[0] == '-';
+
+		if (negative_number && EndsOperand(previous))
+		{
+			Token minus = token;
+			minus.type = TokenType::SubOp;
+			minus.content_length = 1;
+
+			Token number = token;
+			number.content++;
+			number.content_length--;
+			number.pos.column++;
+
+			tokens[i] = minus;
+			tokens.insert(tokens.begin() + i + 1, number);
+			i++;
+		}
+
+		previous = tokens[i].type;
+	}
+}
+
+inline int BinaryPrecedence(TokenType type) {
+	switch (type)
+	{
+	case TokenType::OrOp:
+		return 1;
+	case TokenType::AndOp:
+		return 2;
+	case TokenType::EqualityOp:
+	case TokenType::InEqualityOp:
+		return 3;
+	case TokenType::LessOp:
+	case TokenType::LessEqOp:
+	case TokenType::GreaterOp:
+	case TokenType::GreaterEqOp:
+		return 4;
+	case TokenType::BitOrOp:
+		return 5;
+	case TokenType::BitAndOp:
+		return 6;
+	case TokenType::AddOp:
+	case TokenType::SubOp:
+		return 7;
+	case TokenType::MulOp:
+	case TokenType::DivOp:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+inline bool IsCompoundAssignOp(TokenType type) {
+	return type == TokenType::AddEqOp || type == TokenType::SubEqOp || type == TokenType::MulEqOp ||
+		type == TokenType::DivEqOp || type == TokenType::BitAndEqOp || type == TokenType::BitOrEqOp;
+}
+
+inline bool IsBlockTerminator(TokenType type) {
+	return type == TokenType::KW_BlockEnd || type == TokenType::KW_Elif || type == TokenType::KW_Else;
+}
+
+inline bool EndsOperand(TokenType type) {
+	switch (type)
+	{
+	case TokenType::Identifier:
+	case TokenType::Integer:
+	case TokenType::Real:
+	case TokenType::String:
+	case TokenType::Null:
+	case TokenType::Boolean:
+	case TokenType::ParenthesisClose:
+	case TokenType::BraceClose:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,301 @@
+#include "CryptSerialize.hpp"
+#include "TextWriter.hpp"
+#include "Tokenizer.hpp"
+
+#include <cmath>
+
+using crypt::SerializeOptions;
+using crypt::Variable;
+using crypt::VariableType;
+
+class Serializer
+{
+public:
+	inline Serializer(crypt::Sink &sink, const SerializeOptions &options)
+		: m_writer{sink}, m_options{options} {
+	}
+
+	void write_document(const crypt::table_type &table);
+	void write_value(const Variable &value, size_t depth);
+
+private:
+	void _write_string(const crypt::string_type &value);
+	void _write_key(const crypt::string_type &key);
+	void _write_real(crypt::real_type value);
+	void _write_table(const crypt::table_type &table, size_t depth);
+	void _write_list(const crypt::list_type &list, size_t depth);
+	template <typename T>
+	void _write_array(crypt::Span<T> values);
+
+	void _newline(size_t depth);
+
+private:
+	TextWriter m_writer;
+	const SerializeOptions &m_options;
+};
+
+// the inverse of the parser's `UnescapeChar()`, 0 for chars written as is
+static inline CryptChar EscapeChar(CryptChar value);
+// lists of scalars stay on one line even when pretty
+static inline bool IsFlatList(const crypt::list_type &list);
+
+namespace crypt
+{
+	void Serialize(const Variable &value, Sink &sink, const SerializeOptions &options) {
+		Serializer serializer{sink, options};
+
+		if (options.document && value.get_type() == VariableType::Table)
+		{
+			serializer.write_document(value.get_table());
+			return;
+		}
+
+		serializer.write_value(value, 0);
+	}
+
+	void Serialize(const Variable &value, string_type &out, const SerializeOptions &options) {
+		StringSink sink{out};
+		Serialize(value, sink, options);
+	}
+
+	string_type Serialize(const Variable &value, const SerializeOptions &options) {
+		string_type result{};
+		Serialize(value, result, options);
+		return result;
+	}
+}
+
+void Serializer::write_document(const crypt::table_type &table) {
+	for (const auto &[key, value] : table)
+	{
+		this->_write_key(key);
+		m_writer.write(" = ");
+		this->write_value(value, 0);
+		m_writer.put('\n');
+	}
+}
+
+void Serializer::write_value(const Variable &value, size_t depth) {
+	switch (value.get_type())
+	{
+	case VariableType::Null:
+		m_writer.write(CryptNull, strlen(CryptNull));
+		break;
+	case VariableType::Bool:
+		{
+			const CryptChar *name = BooleanNames[value.get_bool()];
+			m_writer.write(name, strlen(name));
+		}
+		break;
+	case VariableType::Int:
+		m_writer.write_int(value.get_int());
+		break;
+	case VariableType::Real:
+		this->_write_real(value.get_real());
+		break;
+	case VariableType::Str:
+		this->_write_string(value.get_string());
+		break;
+	case VariableType::List:
+		this->_write_list(value.get_list(), depth);
+		break;
+	case VariableType::Table:
+		this->_write_table(value.get_table(), depth);
+		break;
+	case VariableType::IntArray:
+		this->_write_array(value.get_int_array());
+		break;
+	case VariableType::RealArray:
+		this->_write_array(value.get_real_array());
+		break;
+	}
+}
+
+void Serializer::_write_string(const crypt::string_type &value) {
+	m_writer.put('"');
+
+	// runs of plain chars are written at once
+	size_t run_start = 0;
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		const CryptChar escaped = EscapeChar(value[i]);
+		if (escaped == 0)
+		{
+			continue;
+		}
+
+		m_writer.write(value.data() + run_start, i - run_start);
+		m_writer.put('\\');
+		m_writer.put(escaped);
+		run_start = i + 1;
+	}
+
+	m_writer.write(value.data() + run_start, value.size() - run_start);
+	m_writer.put('"');
+}
+
+void Serializer::_write_key(const crypt::string_type &key) {
+	if (IsPlainIdentifier(key.data(), key.size()))
+	{
+		m_writer.write(key.data(), key.size());
+		return;
+	}
+
+	this->_write_string(key);
+}
+
+void Serializer::_write_real(crypt::real_type value) {
+	if (!std::isfinite(value))
+	{
+		throw std::domain_error("can't write infinite or nan reals");
+	}
+
+	m_writer.write_real(value, true);
+}
+
+void Serializer::_write_table(const crypt::table_type &table, size_t depth) {
+	if (table.empty())
+	{
+		m_writer.write("{}");
+		return;
+	}
+
+	m_writer.put('{');
+
+	bool first = true;
+	for (const auto &[key, value] : table)
+	{
+		if (m_options.pretty)
+		{
+			this->_newline(depth + 1);
+		}
+		else
+		{
+			m_writer.write(first ? " " : ", ", first ? 1 : 2);
+		}
+
+		this->_write_key(key);
+		m_writer.write(" = ");
+		this->write_value(value, depth + 1);
+		first = false;
+	}
+
+	if (m_options.pretty)
+	{
+		this->_newline(depth);
+	}
+	else
+	{
+		m_writer.put(' ');
+	}
+
+	m_writer.put('}');
+}
+
+void Serializer::_write_list(const crypt::list_type &list, size_t depth) {
+	if (list.empty())
+	{
+		m_writer.write("{}");
+		return;
+	}
+
+	const bool multiline = m_options.pretty && !IsFlatList(list);
+
+	m_writer.put('{');
+
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		if (i > 0)
+		{
+			m_writer.put(',');
+		}
+
+		if (multiline)
+		{
+			this->_newline(depth + 1);
+		}
+		else
+		{
+			m_writer.put(' ');
+		}
+
+		this->write_value(list[i], depth + 1);
+	}
+
+	if (multiline)
+	{
+		this->_newline(depth);
+	}
+	else
+	{
+		m_writer.put(' ');
+	}
+
+	m_writer.put('}');
+}
+
+template <typename T>
+void Serializer::_write_array(crypt::Span<T> values) {
+	if (values.empty())
+	{
+		m_writer.write("{}");
+		return;
+	}
+
+	m_writer.put('{');
+
+	for (size_t i = 0; i < values.size; i++)
+	{
+		m_writer.write(i == 0 ? " " : ", ", i == 0 ? 1 : 2);
+
+		if constexpr (std::is_same_v<T, crypt::real_type>)
+		{
+			this->_write_real(values[i]);
+		}
+		else
+		{
+			m_writer.write_int(values[i]);
+		}
+	}
+
+	m_writer.write(" }");
+}
+
+void Serializer::_newline(size_t depth) {
+	m_writer.put('\n');
+	m_writer.repeat(m_options.indent_char, depth * m_options.indent_width);
+}
+
+inline CryptChar EscapeChar(CryptChar value) {
+	switch (value)
+	{
+	case '\n':
+		return 'n';
+	case '\r':
+		return 'r';
+	case '\v':
+		return 'v';
+	case '\t':
+		return 't';
+	case '\f':
+		return 'f';
+	case '"':
+		return '"';
+	case '\\':
+		return '\\';
+	default:
+		return 0;
+	}
+}
+
+inline bool IsFlatList(const crypt::list_type &list) {
+	for (const Variable &element : list)
+	{
+		if (element.get_type() == VariableType::List || element.get_type() == VariableType::Table)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,184 @@
+#include "CryptShared.hpp"
+#include "SharedMemory.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+using crypt::string_type;
+
+// the whole `/<name>` segment, advanced with release stores after a generation is fully written
+struct SharedControl
+{
+	std::atomic<uint64_t> generation;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the generation counter must be lock free to be shared");
+
+static inline string_type ControlName(const string_type &name);
+static inline string_type GenerationName(const string_type &name, uint64_t generation);
+
+static inline std::runtime_error ShmError(const char *what, const string_type &name) {
+	return std::runtime_error(string_type(what) + " '" + name + "': " + strerror(errno));
+}
+
+// how long a publisher waits for another one to size the control segment it just created
+static constexpr int ControlWaitMilliseconds = 1000;
+
+// maps the control segment, creating it zero filled (an unpublished `SharedControl`) if it doesn't exist;
+// a concurrent publisher creating it first is fine, theirs is mapped once they've sized it
+static std::shared_ptr<SharedMemory> OpenControl(const string_type &control_name) {
+	for (int waited = 0;; waited++)
+	{
+		if (std::shared_ptr<SharedMemory> memory = SharedMemory::Open(control_name.c_str(), true))
+		{
+			return memory;
+		}
+
+		if (errno != ENOENT)
+		{
+			throw ShmError("can't map shared segment", control_name);
+		}
+
+		if (std::shared_ptr<SharedMemory> memory = SharedMemory::Create(control_name.c_str(), sizeof(SharedControl)))
+		{
+			return memory;
+		}
+
+		if (errno != EEXIST)
+		{
+			throw ShmError("can't create shared segment", control_name);
+		}
+
+		// it exists but `Open()` saw it empty: created and not sized yet
+		// (a publisher that died in between leaves it like that for good)
+		if (waited == ControlWaitMilliseconds)
+		{
+			throw std::runtime_error("shared segment '" + control_name + "' was created but never sized");
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+namespace crypt
+{
+	uint64_t SharedDocument::Publish(const string_type &name, const Variable &document) {
+		const std::vector<uint8_t> image = EncodeSnapshot(document);
+		const string_type control_name = ControlName(name);
+
+		const std::shared_ptr<SharedMemory> control_memory = OpenControl(control_name);
+		SharedControl *control = static_cast<SharedControl *>(control_memory->data());
+		const uint64_t previous = control->generation.load(std::memory_order_acquire);
+
+		// claim the first free generation after the latest one
+		uint64_t generation = previous + 1;
+		std::shared_ptr<SharedMemory> segment{};
+		while (!(segment = SharedMemory::Create(GenerationName(name, generation).c_str(), image.size())))
+		{
+			if (errno != EEXIST)
+			{
+				throw ShmError("can't create shared segment", GenerationName(name, generation));
+			}
+
+			generation++;
+		}
+
+		memcpy(segment->data(), image.data(), image.size());
+
+		// only ever move forward, a concurrent publisher might already have gone past us
+		uint64_t latest = previous;
+		while (latest < generation &&
+			!control->generation.compare_exchange_weak(latest, generation, std::memory_order_acq_rel))
+		{
+		}
+
+		if (latest > generation)
+		{
+			// superseded before being published, nobody can attach to it
+			SharedMemory::Unlink(GenerationName(name, generation).c_str());
+		}
+		else if (latest != 0)
+		{
+			SharedMemory::Unlink(GenerationName(name, latest).c_str());
+		}
+
+		return generation;
+	}
+
+	SharedDocument SharedDocument::Attach(const string_type &name) {
+		// the latest generation can be unlinked by a publisher between reading the counter
+		// and opening it, retry with the newer counter then
+		for (;;)
+		{
+			const uint64_t generation = LatestGeneration(name);
+			if (generation == 0)
+			{
+				throw std::runtime_error("no document published as '" + name + "'");
+			}
+
+			const string_type segment_name = GenerationName(name, generation);
+			std::shared_ptr<SharedMemory> segment = SharedMemory::Open(segment_name.c_str(), false);
+			if (!segment)
+			{
+				if (errno != ENOENT || LatestGeneration(name) == generation)
+				{
+					throw ShmError("can't map shared segment", segment_name);
+				}
+
+				continue;
+			}
+
+			SharedDocument result{};
+			result.m_name = name;
+			result.m_generation = generation;
+			result.m_snapshot = Snapshot::FromBuffer(segment->data(), segment->size(), segment);
+			return result;
+		}
+	}
+
+	void SharedDocument::Remove(const string_type &name) {
+		const uint64_t generation = LatestGeneration(name);
+		if (generation != 0)
+		{
+			SharedMemory::Unlink(GenerationName(name, generation).c_str());
+		}
+
+		SharedMemory::Unlink(ControlName(name).c_str());
+	}
+
+	uint64_t SharedDocument::LatestGeneration(const string_type &name) {
+		const std::shared_ptr<SharedMemory> control_memory = SharedMemory::Open(ControlName(name).c_str(), false);
+		if (!control_memory)
+		{
+			return 0;
+		}
+
+		const SharedControl *control = static_cast<const SharedControl *>(control_memory->data());
+		return control->generation.load(std::memory_order_acquire);
+	}
+
+	bool SharedDocument::refresh() {
+		if (!this->is_stale())
+		{
+			return false;
+		}
+
+		*this = Attach(m_name);
+		return true;
+	}
+}
+
+inline string_type ControlName(const string_type &name) {
+	if (name.empty() || name.find('/') != string_type::npos)
+	{
+		throw std::invalid_argument("invalid shared document name '" + name + "'");
+	}
+
+	return "/" + name;
+}
+
+inline string_type GenerationName(const string_type &name, uint64_t generation) {
+	return ControlName(name) + "." + std::to_string(generation);
+}
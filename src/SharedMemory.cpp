@@ -0,0 +1,98 @@
+#include "SharedMemory.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static inline std::runtime_error ShmError(const char *what, const char *name) {
+	return std::runtime_error(std::string(what) + " '" + name + "': " + strerror(errno));
+}
+
+SharedMemory::~SharedMemory() {
+	munmap(m_data, m_size);
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::Open(const char *name, bool writable) {
+	const int fd = shm_open(name, writable ? O_RDWR : O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		// an empty segment is still being created by its owner
+		close(fd);
+		errno = ENOENT;
+		return nullptr;
+	}
+
+	const size_t size = static_cast<size_t>(info.st_size);
+	void *data = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		throw ShmError("can't map shared segment", name);
+	}
+
+	return std::make_shared<SharedMemory>(data, size);
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::Create(const char *name, size_t size) {
+	const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		const std::runtime_error error = ShmError("can't size shared segment", name);
+		close(fd);
+		shm_unlink(name);
+		throw error;
+	}
+
+	void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		const std::runtime_error error = ShmError("can't map shared segment", name);
+		shm_unlink(name);
+		throw error;
+	}
+
+	return std::make_shared<SharedMemory>(data, size);
+}
+
+void SharedMemory::Unlink(const char *name) {
+	shm_unlink(name);
+}
+
+#else
+
+SharedMemory::~SharedMemory() {
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::Open(const char *, bool) {
+	throw std::runtime_error("shared memory segments need POSIX shared memory");
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::Create(const char *, size_t) {
+	throw std::runtime_error("shared memory segments need POSIX shared memory");
+}
+
+void SharedMemory::Unlink(const char *) {
+}
+
+#endif
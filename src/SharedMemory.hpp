@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+// a POSIX shared memory segment mapped for as long as this object lives;
+// kept apart from the crypt headers since <unistd.h> declares a global `crypt()`
+class SharedMemory
+{
+public:
+	inline SharedMemory(void *data, size_t size) : m_data{data}, m_size{size} {}
+	~SharedMemory();
+
+	SharedMemory(const SharedMemory &) = delete;
+	SharedMemory &operator=(const SharedMemory &) = delete;
+
+	// maps the existing segment `name`, nullptr with errno set if it doesn't exist (ENOENT)
+	// or is still empty (also reported as ENOENT); throws std::runtime_error if mapping fails
+	static std::shared_ptr<SharedMemory> Open(const char *name, bool writable);
+	// creates and maps a zero filled segment, nullptr with errno set if it can't be created
+	// (EEXIST when it already exists); throws std::runtime_error if sizing or mapping fails
+	static std::shared_ptr<SharedMemory> Create(const char *name, size_t size);
+	static void Unlink(const char *name);
+
+	inline void *data() const noexcept { return m_data; }
+	inline size_t size() const noexcept { return m_size; }
+
+private:
+	void *m_data;
+	size_t m_size;
+};
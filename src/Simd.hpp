@@ -0,0 +1,50 @@
+#pragma once
+
+// SSE2 is the baseline (see the `simd_type` build setting), other targets use the scalar paths
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRYPT_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define CRYPT_SIMD_SSE2 0
+#endif
+
+#if CRYPT_SIMD_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace simd
+{
+	// index of the lowest set bit of a non-zero `_mm_movemask_*` result
+	static inline unsigned FirstSetBit(int mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, static_cast<unsigned long>(mask));
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctz(static_cast<unsigned>(mask)));
+#endif
+	}
+
+	static inline float HorizontalSum(__m128 value) {
+		__m128 shuffled = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(value, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sums);
+		return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+	}
+
+	static inline float HorizontalMin(__m128 value) {
+		__m128 shuffled = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 mins = _mm_min_ps(value, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, mins);
+		return _mm_cvtss_f32(_mm_min_ss(mins, shuffled));
+	}
+
+	static inline float HorizontalMax(__m128 value) {
+		__m128 shuffled = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 maxs = _mm_max_ps(value, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, maxs);
+		return _mm_cvtss_f32(_mm_max_ss(maxs, shuffled));
+	}
+}
+#endif
@@ -0,0 +1,618 @@
+#include "CryptSnapshot.hpp"
+#include "MappedFile.hpp"
+
+#include <string.h>
+#include <stdio.h>
+#include <unordered_map>
+
+using crypt::SnapshotError;
+using crypt::SnapshotSlot;
+using crypt::SnapshotTable;
+using crypt::SnapshotView;
+using crypt::Variable;
+using crypt::VariableType;
+
+static constexpr char SnapshotMagic[4] = {'C', 'R', 'Y', 'S'};
+static constexpr uint16_t SnapshotVersion = 1;
+static constexpr uint32_t SnapshotByteOrder = 0x01020304;
+
+// every region (slot arrays, entries, numbers, strings) starts at a multiple of this
+static constexpr size_t SnapshotAlignment = 8;
+
+struct SnapshotHeader
+{
+	char magic[4];
+	uint16_t version;
+	uint8_t int_size;
+	uint8_t real_size;
+	uint32_t byte_order;
+	uint32_t key_count;
+	uint64_t size;
+	uint64_t keys_offset;
+	SnapshotSlot root;
+};
+
+// entry of the interned key table, table entries refer to keys by their index in it
+struct SnapshotKey
+{
+	uint64_t offset;
+	uint32_t length;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotSlot) == 16, "snapshot slots must be packed");
+static_assert(sizeof(SnapshotTable::Entry) == 24, "snapshot table entries must be packed");
+static_assert(sizeof(SnapshotHeader) % SnapshotAlignment == 0, "snapshot header must keep the alignment");
+
+// bounds checked pointer to `count` elements of `element_size` bytes at `offset`
+static inline const void *SnapshotRegion(
+	const uint8_t *base, size_t size, uint64_t offset, uint64_t count, size_t element_size
+);
+
+class SnapshotEncoder
+{
+public:
+	std::vector<uint8_t> encode(const Variable &root);
+
+private:
+	SnapshotSlot _encode(const Variable &value);
+	SnapshotSlot _encode_list(const crypt::list_type &list);
+	SnapshotSlot _encode_table(const crypt::table_type &table);
+	template <typename T>
+	SnapshotSlot _encode_array(crypt::Span<T> values, VariableType type);
+
+	uint64_t _string(const crypt::string_type &value);
+	uint32_t _key(const crypt::string_type &key);
+
+	// appends zeroed, aligned space and returns its offset
+	uint64_t _reserve(size_t bytes);
+
+	template <typename T>
+	inline void _store(uint64_t offset, const T &value) {
+		memcpy(m_out.data() + offset, &value, sizeof(T));
+	}
+
+private:
+	std::vector<uint8_t> m_out;
+	std::unordered_map<crypt::string_type, uint64_t> m_strings;
+	std::unordered_map<crypt::string_type, uint32_t> m_key_indices;
+	std::vector<const crypt::string_type *> m_keys;
+};
+
+namespace crypt
+{
+	std::vector<uint8_t> EncodeSnapshot(const Variable &value) {
+		return SnapshotEncoder().encode(value);
+	}
+
+	void SaveSnapshot(const Variable &value, const char *path) {
+		const std::vector<uint8_t> image = EncodeSnapshot(value);
+
+		FILE *file = fopen(path, "wb");
+		if (file == nullptr)
+		{
+			throw std::runtime_error(std::string("can't open file: ") + path);
+		}
+
+		const size_t written = fwrite(image.data(), 1, image.size(), file);
+		const bool closed = fclose(file) == 0;
+
+		if (written != image.size() || !closed)
+		{
+			throw std::runtime_error(std::string("can't write file: ") + path);
+		}
+	}
+
+	Snapshot Snapshot::FromBuffer(const void *data, size_t size, std::shared_ptr<const void> owner) {
+		if (data == nullptr || size < sizeof(SnapshotHeader))
+		{
+			throw SnapshotError("snapshot is too small");
+		}
+
+		if (reinterpret_cast<uintptr_t>(data) % SnapshotAlignment != 0)
+		{
+			throw SnapshotError("snapshot isn't aligned");
+		}
+
+		const SnapshotHeader &header = *static_cast<const SnapshotHeader *>(data);
+
+		if (memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0)
+		{
+			throw SnapshotError("not a snapshot");
+		}
+
+		if (header.version != SnapshotVersion)
+		{
+			throw SnapshotError("unsupported snapshot version " + std::to_string(header.version));
+		}
+
+		if (header.byte_order != SnapshotByteOrder || header.int_size != sizeof(int_type) ||
+				header.real_size != sizeof(real_type))
+		{
+			throw SnapshotError("snapshot was written by an incompatible build");
+		}
+
+		if (header.size > size)
+		{
+			throw SnapshotError("snapshot is truncated");
+		}
+
+		const uint8_t *base = static_cast<const uint8_t *>(data);
+		SnapshotRegion(base, header.size, header.keys_offset, header.key_count, sizeof(SnapshotKey));
+
+		Snapshot snapshot{};
+		snapshot.m_data = base;
+		snapshot.m_size = header.size;
+		snapshot.m_owner = std::move(owner);
+		return snapshot;
+	}
+
+	Snapshot Snapshot::Open(const char *path) {
+		auto mapping = std::make_shared<MappedFile>(path);
+		return FromBuffer(mapping->data(), mapping->size(), mapping);
+	}
+
+	SnapshotView Snapshot::root() const {
+		if (m_data == nullptr)
+		{
+			return {};
+		}
+
+		return SnapshotView{m_data, m_size, reinterpret_cast<const SnapshotHeader *>(m_data)->root};
+	}
+
+	boolean_type SnapshotView::get_bool() const {
+		switch (get_type())
+		{
+		case VariableType::Null:
+			return false;
+		case VariableType::Bool:
+			return m_slot.payload != 0;
+		case VariableType::Int:
+			return this->_int_payload() != 0;
+		case VariableType::Real:
+			return this->_real_payload() != 0;
+		default:
+			throw VariableAccessError("boolean");
+		}
+	}
+
+	int_type SnapshotView::get_int() const {
+		switch (get_type())
+		{
+		case VariableType::Null:
+			return 0;
+		case VariableType::Bool:
+			return m_slot.payload != 0 ? 1 : 0;
+		case VariableType::Int:
+			return this->_int_payload();
+		case VariableType::Real:
+			return static_cast<int_type>(this->_real_payload());
+		default:
+			throw VariableAccessError("int");
+		}
+	}
+
+	real_type SnapshotView::get_real() const {
+		switch (get_type())
+		{
+		case VariableType::Null:
+			return 0;
+		case VariableType::Bool:
+			return static_cast<real_type>(m_slot.payload != 0 ? 1 : 0);
+		case VariableType::Int:
+			return static_cast<real_type>(this->_int_payload());
+		case VariableType::Real:
+			return this->_real_payload();
+		default:
+			throw VariableAccessError("real");
+		}
+	}
+
+	int_type SnapshotView::_int_payload() const {
+		return static_cast<int_type>(static_cast<int64_t>(m_slot.payload));
+	}
+
+	real_type SnapshotView::_real_payload() const {
+		real_type value;
+		memcpy(&value, &m_slot.payload, sizeof(value));
+		return value;
+	}
+
+	string_view_type SnapshotView::get_string() const {
+		if (get_type() != VariableType::Str)
+		{
+			throw VariableAccessError("string");
+		}
+
+		const void *chars = SnapshotRegion(m_base, m_size, m_slot.payload, m_slot.count, sizeof(char_type));
+		return string_view_type{static_cast<const char_type *>(chars), m_slot.count};
+	}
+
+	SnapshotList SnapshotView::get_list() const {
+		size_t element_size = 0;
+		switch (get_type())
+		{
+		case VariableType::List:
+			element_size = sizeof(SnapshotSlot);
+			break;
+		case VariableType::IntArray:
+			element_size = sizeof(int_type);
+			break;
+		case VariableType::RealArray:
+			element_size = sizeof(real_type);
+			break;
+		default:
+			throw VariableAccessError("list");
+		}
+
+		const void *elements = SnapshotRegion(m_base, m_size, m_slot.payload, m_slot.count, element_size);
+		return SnapshotList{m_base, m_size, m_slot, elements};
+	}
+
+	SnapshotTable SnapshotView::get_table() const {
+		if (get_type() != VariableType::Table)
+		{
+			throw VariableAccessError("table");
+		}
+
+		const void *entries = SnapshotRegion(m_base, m_size, m_slot.payload, m_slot.count, sizeof(SnapshotTable::Entry));
+		return SnapshotTable{m_base, m_size, m_slot.count, static_cast<const SnapshotTable::Entry *>(entries)};
+	}
+
+	Span<int_type> SnapshotView::get_int_array() const {
+		if (get_type() != VariableType::IntArray)
+		{
+			throw VariableAccessError("int array");
+		}
+
+		const void *values = SnapshotRegion(m_base, m_size, m_slot.payload, m_slot.count, sizeof(int_type));
+		return Span<int_type>{static_cast<const int_type *>(values), m_slot.count};
+	}
+
+	Span<real_type> SnapshotView::get_real_array() const {
+		if (get_type() != VariableType::RealArray)
+		{
+			throw VariableAccessError("real array");
+		}
+
+		const void *values = SnapshotRegion(m_base, m_size, m_slot.payload, m_slot.count, sizeof(real_type));
+		return Span<real_type>{static_cast<const real_type *>(values), m_slot.count};
+	}
+
+	Variable SnapshotView::to_variable() const {
+		switch (get_type())
+		{
+		case VariableType::Null:
+			return Variable();
+		case VariableType::Bool:
+			return Variable(this->get_bool());
+		case VariableType::Int:
+			return Variable(this->get_int());
+		case VariableType::Real:
+			return Variable(this->get_real());
+		case VariableType::Str:
+			{
+				const string_view_type value = this->get_string();
+				return Variable(string_type(value.data(), value.size()));
+			}
+		case VariableType::List:
+			{
+				const SnapshotList list = this->get_list();
+
+				list_type result{};
+				result.reserve(list.size());
+				for (const SnapshotView element : list)
+				{
+					result.emplace_back(element.to_variable());
+				}
+
+				return Variable(std::move(result));
+			}
+		case VariableType::Table:
+			{
+				const SnapshotTable table = this->get_table();
+
+				table_type result{};
+				for (auto it = table.begin(); it != table.end(); ++it)
+				{
+					const string_view_type key = it.key();
+					// entries are sorted, each one goes at the end
+					result.emplace_hint(result.end(), string_type(key.data(), key.size()), it.value().to_variable());
+				}
+
+				return Variable(std::move(result));
+			}
+		case VariableType::IntArray:
+			{
+				const Span<int_type> values = this->get_int_array();
+				return Variable(int_array_type(values.begin(), values.end()));
+			}
+		case VariableType::RealArray:
+			{
+				const Span<real_type> values = this->get_real_array();
+				return Variable(real_array_type(values.begin(), values.end()));
+			}
+		default:
+			throw SnapshotError("unknown snapshot value type " + std::to_string(m_slot.type));
+		}
+	}
+
+	SnapshotView SnapshotList::operator[](size_t index) const {
+		SnapshotSlot slot{};
+
+		switch (m_type)
+		{
+		case VariableType::IntArray:
+			{
+				const int_type value = static_cast<const int_type *>(m_elements)[index];
+				slot.type = static_cast<uint32_t>(VariableType::Int);
+				slot.payload = static_cast<uint64_t>(static_cast<int64_t>(value));
+			}
+			break;
+		case VariableType::RealArray:
+			{
+				const real_type value = static_cast<const real_type *>(m_elements)[index];
+				slot.type = static_cast<uint32_t>(VariableType::Real);
+				memcpy(&slot.payload, &value, sizeof(value));
+			}
+			break;
+		default:
+			slot = static_cast<const SnapshotSlot *>(m_elements)[index];
+			break;
+		}
+
+		return SnapshotView{m_base, m_size, slot};
+	}
+
+	SnapshotTable::iterator SnapshotTable::find(string_view_type key) const {
+		size_t low = 0;
+		size_t high = m_count;
+
+		while (low < high)
+		{
+			const size_t middle = low + (high - low) / 2;
+			const int order = this->_key(middle).compare(key);
+
+			if (order == 0)
+			{
+				return iterator{this, middle};
+			}
+
+			if (order < 0)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		return this->end();
+	}
+
+	SnapshotView SnapshotTable::at(string_view_type key) const {
+		const iterator it = this->find(key);
+		if (it == this->end())
+		{
+			throw VariableAccessError("no table entry named '" + string_type(key.data(), key.size()) + "'");
+		}
+
+		return it.value();
+	}
+
+	string_view_type SnapshotTable::_key(size_t index) const {
+		const SnapshotHeader &header = *reinterpret_cast<const SnapshotHeader *>(m_base);
+		const uint32_t key_index = m_entries[index].key;
+
+		if (key_index >= header.key_count)
+		{
+			throw SnapshotError("snapshot key index out of range");
+		}
+
+		// the key table itself was checked when the snapshot was opened
+		const SnapshotKey &key = reinterpret_cast<const SnapshotKey *>(m_base + header.keys_offset)[key_index];
+		const void *chars = SnapshotRegion(m_base, m_size, key.offset, key.length, sizeof(char_type));
+		return string_view_type{static_cast<const char_type *>(chars), key.length};
+	}
+}
+
+std::vector<uint8_t> SnapshotEncoder::encode(const Variable &root) {
+	m_out.clear();
+	m_strings.clear();
+	m_key_indices.clear();
+	m_keys.clear();
+
+	this->_reserve(sizeof(SnapshotHeader));
+
+	SnapshotHeader header{};
+	memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+	header.version = SnapshotVersion;
+	header.int_size = sizeof(crypt::int_type);
+	header.real_size = sizeof(crypt::real_type);
+	header.byte_order = SnapshotByteOrder;
+	header.root = this->_encode(root);
+
+	header.key_count = static_cast<uint32_t>(m_keys.size());
+	header.keys_offset = this->_reserve(m_keys.size() * sizeof(SnapshotKey));
+
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		SnapshotKey key{};
+		key.offset = m_strings.at(*m_keys[i]);
+		key.length = static_cast<uint32_t>(m_keys[i]->size());
+		this->_store(header.keys_offset + i * sizeof(SnapshotKey), key);
+	}
+
+	header.size = m_out.size();
+	this->_store(0, header);
+
+	return std::move(m_out);
+}
+
+SnapshotSlot SnapshotEncoder::_encode(const Variable &value) {
+	SnapshotSlot slot{};
+	slot.type = static_cast<uint32_t>(value.get_type());
+
+	switch (value.get_type())
+	{
+	case VariableType::Null:
+		break;
+	case VariableType::Bool:
+		slot.payload = value.get_bool();
+		break;
+	case VariableType::Int:
+		slot.payload = static_cast<uint64_t>(static_cast<int64_t>(value.get_int()));
+		break;
+	case VariableType::Real:
+		{
+			const crypt::real_type real = value.get_real();
+			memcpy(&slot.payload, &real, sizeof(real));
+		}
+		break;
+	case VariableType::Str:
+		{
+			const crypt::string_type &string = value.get_string();
+			if (string.size() > UINT32_MAX)
+			{
+				throw std::length_error("string is too long for a snapshot");
+			}
+
+			slot.count = static_cast<uint32_t>(string.size());
+			slot.payload = this->_string(string);
+		}
+		break;
+	case VariableType::List:
+		return this->_encode_list(value.get_list());
+	case VariableType::Table:
+		return this->_encode_table(value.get_table());
+	case VariableType::IntArray:
+		return this->_encode_array(value.get_int_array(), VariableType::IntArray);
+	case VariableType::RealArray:
+		return this->_encode_array(value.get_real_array(), VariableType::RealArray);
+	}
+
+	return slot;
+}
+
+SnapshotSlot SnapshotEncoder::_encode_list(const crypt::list_type &list) {
+	if (list.size() > UINT32_MAX)
+	{
+		throw std::length_error("list is too long for a snapshot");
+	}
+
+	SnapshotSlot slot{};
+	slot.type = static_cast<uint32_t>(VariableType::List);
+	slot.count = static_cast<uint32_t>(list.size());
+	slot.payload = this->_reserve(list.size() * sizeof(SnapshotSlot));
+
+	// the elements' own data goes after the slot array
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		const SnapshotSlot element = this->_encode(list[i]);
+		this->_store(slot.payload + i * sizeof(SnapshotSlot), element);
+	}
+
+	return slot;
+}
+
+SnapshotSlot SnapshotEncoder::_encode_table(const crypt::table_type &table) {
+	if (table.size() > UINT32_MAX)
+	{
+		throw std::length_error("table is too large for a snapshot");
+	}
+
+	SnapshotSlot slot{};
+	slot.type = static_cast<uint32_t>(VariableType::Table);
+	slot.count = static_cast<uint32_t>(table.size());
+	slot.payload = this->_reserve(table.size() * sizeof(SnapshotTable::Entry));
+
+	// std::map iterates in key order, the order `SnapshotTable::find()` searches in
+	size_t index = 0;
+	for (const auto &[key, value] : table)
+	{
+		SnapshotTable::Entry entry{};
+		entry.key = this->_key(key);
+		entry.value = this->_encode(value);
+		this->_store(slot.payload + index * sizeof(SnapshotTable::Entry), entry);
+		index++;
+	}
+
+	return slot;
+}
+
+template <typename T>
+SnapshotSlot SnapshotEncoder::_encode_array(crypt::Span<T> values, VariableType type) {
+	if (values.size > UINT32_MAX)
+	{
+		throw std::length_error("array is too long for a snapshot");
+	}
+
+	SnapshotSlot slot{};
+	slot.type = static_cast<uint32_t>(type);
+	slot.count = static_cast<uint32_t>(values.size);
+	slot.payload = this->_reserve(values.size * sizeof(T));
+
+	if (!values.empty())
+	{
+		memcpy(m_out.data() + slot.payload, values.data, values.size * sizeof(T));
+	}
+
+	return slot;
+}
+
+uint64_t SnapshotEncoder::_string(const crypt::string_type &value) {
+	const auto found = m_strings.find(value);
+	if (found != m_strings.end())
+	{
+		return found->second;
+	}
+
+	// null terminated, so the chars can be handed to C apis as is
+	const uint64_t offset = this->_reserve((value.size() + 1) * sizeof(crypt::char_type));
+	memcpy(m_out.data() + offset, value.data(), value.size() * sizeof(crypt::char_type));
+
+	m_strings.emplace(value, offset);
+	return offset;
+}
+
+uint32_t SnapshotEncoder::_key(const crypt::string_type &key) {
+	const auto found = m_key_indices.find(key);
+	if (found != m_key_indices.end())
+	{
+		return found->second;
+	}
+
+	this->_string(key);
+
+	const uint32_t index = static_cast<uint32_t>(m_keys.size());
+	const auto inserted = m_key_indices.emplace(key, index);
+	m_keys.push_back(&inserted.first->first);
+	return index;
+}
+
+uint64_t SnapshotEncoder::_reserve(size_t bytes) {
+	const size_t offset = m_out.size();
+	const size_t padded = (bytes + SnapshotAlignment - 1) & ~(SnapshotAlignment - 1);
+
+	m_out.resize(offset + padded, 0);
+	return offset;
+}
+
+inline const void *SnapshotRegion(
+	const uint8_t *base, size_t size, uint64_t offset, uint64_t count, size_t element_size
+) {
+	// counts are 32-bit and elements small, the product can't overflow
+	if (offset > size || count * element_size > size - offset)
+	{
+		throw SnapshotError("snapshot offset out of range");
+	}
+
+	if (offset % alignof(SnapshotSlot) != 0 && element_size > 1)
+	{
+		throw SnapshotError("misaligned snapshot offset");
+	}
+
+	return base + offset;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "CryptSerialize.hpp"
+#include "Common.hpp"
+
+#include <string.h>
+#include <charconv>
+#include <stdexcept>
+
+// buffers small writes before handing them to a sink in large chunks
+class TextWriter
+{
+public:
+	static constexpr size_t BufferSize = 4096;
+
+	inline TextWriter(crypt::Sink &sink) : m_sink{sink} {}
+	inline ~TextWriter() { this->flush(); }
+
+	inline void put(CryptChar value) {
+		if (m_used == BufferSize)
+		{
+			this->flush();
+		}
+
+		m_buffer[m_used++] = value;
+	}
+
+	inline void write(const CryptChar *data, size_t length) {
+		if (length > BufferSize - m_used)
+		{
+			this->flush();
+
+			// too big to be worth buffering
+			if (length > BufferSize)
+			{
+				m_sink.write(data, length);
+				return;
+			}
+		}
+
+		memcpy(m_buffer + m_used, data, length);
+		m_used += length;
+	}
+
+	template <size_t N>
+	inline void write(const CryptChar (&literal)[N]) {
+		this->write(literal, N - 1);
+	}
+
+	inline void repeat(CryptChar value, size_t count) {
+		for (size_t i = 0; i < count; i++)
+		{
+			this->put(value);
+		}
+	}
+
+	template <typename T>
+	inline void write_int(T value) {
+		CryptChar digits[24];
+		const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+		this->write(digits, result.ptr - digits);
+	}
+
+	// shortest form that reads back to the same value, in fixed notation unless `exponents`
+	// allows the scientific one (the crypt tokenizer doesn't read exponents);
+	// `force_dot` keeps whole values from reading back as ints ("3.0", but "1e+20" as is)
+	inline void write_real(crypt::real_type value, bool force_dot, bool exponents = false) {
+		CryptChar digits[64];
+		const std::to_chars_result result = exponents
+			? std::to_chars(digits, digits + sizeof(digits), value)
+			: std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed);
+
+		if (result.ec != std::errc())
+		{
+			throw std::domain_error("real too long to write");
+		}
+
+		const size_t length = result.ptr - digits;
+		this->write(digits, length);
+
+		if (force_dot && memchr(digits, '.', length) == nullptr && memchr(digits, 'e', length) == nullptr)
+		{
+			this->write(".0");
+		}
+	}
+
+	inline void flush() {
+		if (m_used > 0)
+		{
+			m_sink.write(m_buffer, m_used);
+			m_used = 0;
+		}
+	}
+
+private:
+	crypt::Sink &m_sink;
+	size_t m_used = 0;
+	CryptChar m_buffer[BufferSize];
+};
@@ -2,7 +2,6 @@
 #include "Tools.hpp"
 #include "ArrayString.hpp"
 
-#include <iostream>
 #include <limits>
 
 
@@ -33,6 +32,8 @@ static constexpr KeywordName CryptKeywords[] = {
 	{ TokenType::KW_BlockBegin, "do" },
 	{ TokenType::KW_BlockBegin, "then" },
 	{ TokenType::KW_BlockEnd, "end" },
+	{ TokenType::KW_Return, "return" },
+	{ TokenType::KW_While, "while" },
 
 	{ TokenType::AndOp, "and" },
 	{ TokenType::OrOp, "or" },
@@ -41,6 +42,8 @@ static constexpr KeywordName CryptKeywords[] = {
 
 // specializes the token to a keyword token or boolean token or ...
 static TokenType IdentifierTokenSpecialtyType(const Token &token);
+// the token's content is exactly `name` (not just a prefix of it)
+static inline bool IsTokenNamed(const Token &token, const CryptChar *name);
 
 constexpr CryptChar StringChar = '"';
 
@@ -128,16 +131,15 @@ errno_t Tokenizer::_parse_token() {
 		return EOF;
 	}
 
-	if (token.content_length == 0)
+	// (only strings can be empty)
+	if (token.type == TokenType::Unknown || m_position == pre_read_pos)
 	{
-		return EBADF;
-	}
+		if (*token.content == StringChar)
+		{
+			throw TokenError("unterminated string", token.pos);
+		}
 
-	// debug
-	if (m_position - pre_read_pos == 0)
-	{
-		std::cout << "ERROR! at token " << pre_read_pos << "\n";
-		return EFAULT;
+		throw TokenError(std::string("unexpected character '") + *token.content + "'", token.pos);
 	}
 
 	if (token.type == TokenType::Newline)
@@ -199,15 +201,25 @@ Token Tokenizer::_read_token() {
 		return _read_number();
 	}
 
+	//* comments, never tokenized
+
+	if (current_char == '#')
+	{
+		return _read_continues(
+			TokenType::CommentPrefix,
+			[](CryptChar value) { return !IsNewline(value); }
+		);
+	}
+
 	//* basic symbols
 
 	constexpr std::pair<CryptChar, TokenType> SimpleCharTokenMap[] = {
 		{ ',', TokenType::Comma },
+		{ '.', TokenType::Dot },
 		{ '{', TokenType::BraceOpen },
 		{ '}', TokenType::BraceClose },
 		{ '(', TokenType::ParenthesisOpen },
-		{ ')', TokenType::ParenthesisClose },
-		{ '#', TokenType::CommentPrefix }
+		{ ')', TokenType::ParenthesisClose }
 	};
 
 	for (size_t i = 0; i < std::size(SimpleCharTokenMap); i++)
@@ -244,6 +256,8 @@ Token Tokenizer::_read_token() {
 
 		{ '=', TokenType::AssignOp, TokenType::EqualityOp },
 		{ '!', TokenType::NotOp, TokenType::InEqualityOp },
+		{ '<', TokenType::LessOp, TokenType::LessEqOp },
+		{ '>', TokenType::GreaterOp, TokenType::GreaterEqOp },
 
 		// logic operators can only be compound ('&&' and '||') 
 		{ '&', TokenType::Unknown, TokenType::AndOp, '&' },
@@ -294,7 +308,8 @@ Token Tokenizer::_read_token() {
 		return token;
 	}
 
-	if (IsIdentifierStart(current_char))
+	// a lone '@' isn't a name
+	if (IsIdentifierStart(current_char) && (current_char != '@' || (space_left > 1 && IsIdentifier(get_current_string()[1]))))
 	{
 		Token token = _read_continues(
 			TokenType::Identifier,
@@ -306,7 +321,6 @@ Token Tokenizer::_read_token() {
 	}
 
 	// unknown token
-	this->_advance();
 	return {TokenType::Unknown, get_current_string(), 1};
 }
 
@@ -320,7 +334,7 @@ Token Tokenizer::_read_number() {
 		index = 1;
 	}
 
-	for (; index < get_source_length(); index++)
+	for (; index < get_space_left(); index++)
 	{
 		const CryptChar cur_chr = get_current_string()[index];
 		if (IsDigit(cur_chr))
@@ -368,6 +382,11 @@ Token Tokenizer::_read_string() {
 		}
 	}
 
+	if (index >= space_left)
+	{
+		return {TokenType::Unknown, current_str, space_left};
+	}
+
 	this->_advance(index + 1);
 	return {
 		TokenType::String,
@@ -443,15 +462,37 @@ inline bool IsIdentifier(CryptChar value) {
 	return IsIdentifierStart(value) || IsDigit(value);
 }
 
+bool IsPlainIdentifier(const CryptChar *content, size_t length) {
+	if (length == 0 || !IsIdentifierStart(content[0]) || (length == 1 && content[0] == '@'))
+	{
+		return false;
+	}
+
+	for (size_t i = 1; i < length; i++)
+	{
+		if (!IsIdentifier(content[i]))
+		{
+			return false;
+		}
+	}
+
+	const Token token = {TokenType::Identifier, content, length};
+	return IdentifierTokenSpecialtyType(token) == TokenType::Identifier;
+}
+
+inline bool IsTokenNamed(const Token &token, const CryptChar *name) {
+	return StringEqual(name, token.content, token.content_length) && name[token.content_length] == 0;
+}
+
 TokenType IdentifierTokenSpecialtyType(const Token &token) {
-	if (StringEqual(CryptNull, token.content, token.content_length))
+	if (IsTokenNamed(token, CryptNull))
 	{
 		return TokenType::Null;
 	}
 
 	for (size_t i = 0; i < std::size(BooleanNames); i++)
 	{
-		if (StringEqual(BooleanNames[i], token.content, token.content_length))
+		if (IsTokenNamed(token, BooleanNames[i]))
 		{
 			return TokenType::Boolean;
 		}
@@ -459,7 +500,7 @@ TokenType IdentifierTokenSpecialtyType(const Token &token) {
 
 	for (size_t i = 0; i < std::size(CryptKeywords); i++)
 	{
-		if (StringEqual(CryptKeywords[i].name, token.content, token.content_length))
+		if (IsTokenNamed(token, CryptKeywords[i].name))
 		{
 			return CryptKeywords[i].type;
 		}
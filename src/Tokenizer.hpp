@@ -3,6 +3,8 @@
 #include "Tools.hpp"
 
 #include <vector>
+#include <stdexcept>
+#include <string>
 #include <inttypes.h>
 
 enum class TokenType : uint8_t
@@ -24,6 +26,8 @@ enum class TokenType : uint8_t
 	KW_Else,
 	KW_BlockBegin,
 	KW_BlockEnd,
+	KW_Return,
+	KW_While,
 
 	String,
 	Identifier,
@@ -47,6 +51,11 @@ enum class TokenType : uint8_t
 	NotOp,
 	InEqualityOp,
 
+	LessOp,
+	LessEqOp,
+	GreaterOp,
+	GreaterEqOp,
+
 	AndOp,
 	OrOp,
 
@@ -64,7 +73,8 @@ enum class TokenType : uint8_t
 	BraceOpen,
 	BraceClose,
 
-	Comma
+	Comma,
+	Dot
 };
 
 struct TextPosition
@@ -82,6 +92,19 @@ struct Token
 
 	TextPosition pos = {};
 
+	// throws TokenError on text that isn't a token (unterminated strings, stray characters);
+	// comments are a single token running to the end of their line
 	static void Parse(const CryptChar *source, size_t length, std::vector<Token> &out_tokens);
 };
 
+// a tokenizing failure at `pos` (0-based, like the tokens')
+class TokenError : public std::runtime_error
+{
+public:
+	inline TokenError(const std::string &msg, const TextPosition &pos) : std::runtime_error(msg), pos{pos} {}
+
+	TextPosition pos;
+};
+
+// whether `content` reads back as a single identifier token (not a keyword/null/boolean)
+bool IsPlainIdentifier(const CryptChar *content, size_t length);
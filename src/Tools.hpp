@@ -20,7 +20,7 @@ namespace tools
 	// returns the index of the first match, returning `end_index` if no match is found
 	template <typename T, typename _Pred>
 	static constexpr size_t find(T begin, size_t start_index, size_t end_index, _Pred &&pred) {
-		for (size_t i = start_index; i < start_index; i++)
+		for (size_t i = start_index; i < end_index; i++)
 		{
 			if (pred(begin[i]))
 			{
@@ -0,0 +1,875 @@
+#include "VM.hpp"
+#include "Operators.hpp"
+#include "CryptScript.hpp"
+
+// direct threading through the labels-as-values extension where available,
+// each handler then jumps straight to the next one instead of going through a switch
+#ifndef CRYPT_VM_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define CRYPT_VM_COMPUTED_GOTO 1
+#else
+#define CRYPT_VM_COMPUTED_GOTO 0
+#endif
+#endif
+
+using crypt::Program;
+using crypt::Variable;
+using crypt::VariableType;
+
+// deeper recursion is reported as a stack overflow
+static constexpr size_t MaxCallDepth = 1024;
+
+static inline bool IsIntPair(const Variable &left, const Variable &right) {
+	return left.get_type() == VariableType::Int && right.get_type() == VariableType::Int;
+}
+
+// scalars are copied in place, skipping the out-of-line payload handling of `Variable::operator=`
+static inline void Assign(Variable &target, const Variable &source) {
+	switch (source.get_type())
+	{
+	case VariableType::Null:
+		target.set_null();
+		break;
+	case VariableType::Bool:
+		target.set_bool(source.get_bool_unchecked());
+		break;
+	case VariableType::Int:
+		target.set_int(source.get_int_unchecked());
+		break;
+	case VariableType::Real:
+		target.set_real(source.get_real_unchecked());
+		break;
+	default:
+		target = source;
+		break;
+	}
+}
+
+// leaves `source` null
+static inline void MoveAssign(Variable &target, Variable &source) {
+	if (source.get_type() > VariableType::Real)
+	{
+		target = std::move(source);
+		return;
+	}
+
+	Assign(target, source);
+	source.set_null();
+}
+
+// the field through the instruction's inline cache, so tables read before (and unchanged since)
+// skip the lookup; nullptr when missing
+static inline const Variable *ReadField(FieldCache &cache, const Variable &table, const CryptString &key) {
+	if (table.get_type() != VariableType::Table)
+	{
+		return FindField(table, key);
+	}
+
+	// no stamp, the table can change without one
+	const uint64_t stamp = table.get_stamp();
+	if (stamp == 0)
+	{
+		return FindField(table, key);
+	}
+
+	if (const Variable *cached = cache.find(stamp))
+	{
+		return cached;
+	}
+
+	const Variable *field = FindField(table, key);
+	if (field != nullptr)
+	{
+		cache.remember(stamp, field);
+	}
+
+	return field;
+}
+
+static inline bool Truthy(const Variable &value) {
+	return value.get_type() == VariableType::Bool ? value.get_bool() : IsTruthy(value);
+}
+
+// builds the executable form of the bytecode, once per program,
+// `handlers` are the handler addresses on computed-goto builds and null otherwise
+static void PrepareProgram(const Program &program, const void *const *handlers) {
+	const size_t count = program.code.size();
+	program.executable = std::make_unique<ExecutableInstruction[]>(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const size_t op = static_cast<size_t>(GetOpCode(program.code[i]));
+		const uintptr_t dispatch = handlers ? reinterpret_cast<uintptr_t>(handlers[op]) : op;
+
+		program.executable[i].dispatch.store(dispatch, std::memory_order_relaxed);
+		program.executable[i].operand = GetOperand(program.code[i]);
+	}
+}
+
+// the form a quickenable binary op (`Add` through `GreaterEqual` but the bitwise/equality ones)
+// specializes to for these operand types
+static OpCode SpecializeBinary(OpCode op, VariableType left, VariableType right) {
+	const bool ints = left == VariableType::Int && right == VariableType::Int;
+	const bool reals = left == VariableType::Real && right == VariableType::Real;
+
+#define VM_SPECIALIZE(name) \
+	case OpCode::name: \
+		return ints ? OpCode::name##Int : (reals ? OpCode::name##Real : OpCode::name##Generic)
+
+	switch (op)
+	{
+	case OpCode::Add:
+		if (left == VariableType::Str && right == VariableType::Str)
+		{
+			return OpCode::AddString;
+		}
+		return ints ? OpCode::AddInt : (reals ? OpCode::AddReal : OpCode::AddGeneric);
+	VM_SPECIALIZE(Sub);
+	VM_SPECIALIZE(Mul);
+	VM_SPECIALIZE(Div);
+	VM_SPECIALIZE(Less);
+	VM_SPECIALIZE(LessEqual);
+	VM_SPECIALIZE(Greater);
+	VM_SPECIALIZE(GreaterEqual);
+	default:
+		throw std::logic_error("opcode can not be quickened");
+	}
+
+#undef VM_SPECIALIZE
+}
+
+static inline CryptInt DivideInt(CryptInt left, CryptInt right) {
+	if (right == 0)
+	{
+		throw std::domain_error("int division by zero");
+	}
+
+	// the one overflowing division wraps like the other ops
+	return right == -1 ? WrapSub(0, left) : static_cast<CryptInt>(left / right);
+}
+
+// keeps at most this many programs' caches in an execution state
+static constexpr size_t MaxCachedPrograms = 64;
+
+FieldCache *InlineCaches::fields(const std::shared_ptr<const Program> &program) {
+	for (ProgramCaches &caches : m_programs)
+	{
+		if (caches.program == program)
+		{
+			return caches.fields.get();
+		}
+	}
+
+	if (m_programs.size() >= MaxCachedPrograms)
+	{
+		m_programs.erase(m_programs.begin());
+	}
+
+	ProgramCaches &caches = m_programs.emplace_back();
+	caches.program = program;
+	caches.fields = std::make_unique<FieldCache[]>(program->field_keys.size());
+	return caches.fields.get();
+}
+
+// restores the null slots invariant after a run failed
+static void ClearStack(Variable *bottom, Variable *top) {
+	while (top > bottom)
+	{
+		(--top)->set_null();
+	}
+}
+
+// `Profiling` runs count every instruction into `counts`; on computed-goto builds they dispatch from
+// `Program::code` without quickening, the executable form holds the other instantiation's handlers
+template <bool Profiling>
+static Variable Run(
+	const Program &program, Variable *globals, ExecutionState &state, FieldCache *field_caches, uint64_t &budget,
+	OpcodeCounts *counts
+) {
+	std::vector<Variable> &stack = state.stack;
+	std::vector<Frame> &frames = state.frames;
+
+	Variable *locals;
+	Variable *sp;
+	uint32_t pc;
+	uint32_t operand = 0;
+
+	if (state.suspended)
+	{
+		state.suspended = false;
+		locals = stack.data() + state.base;
+		sp = stack.data() + state.top;
+		pc = state.pc;
+	}
+	else
+	{
+		frames.clear();
+		if (stack.size() <= program.functions[0].max_stack)
+		{
+			stack.resize(program.functions[0].max_stack + 1);
+		}
+
+		locals = stack.data();
+		sp = locals;
+		pc = 0;
+
+		if constexpr (Profiling)
+		{
+			counts->restart();
+		}
+	}
+
+	// the budget is charged at each jump, call and return with the straight run of instructions
+	// since the previous one (starting at `segment`), which keeps the counting off the other
+	// instructions but lets a run overshoot its budget by one such stretch
+	uint64_t remaining = budget;
+	uint32_t segment = pc;
+
+	const Variable *const constants = program.constants.data();
+	// superinstructions read the operands of the instructions they stand for from here
+	const Instruction *const code = program.code.data();
+
+#if CRYPT_VM_COMPUTED_GOTO
+	// in `OpCode` order
+	static const void *const Handlers[] = {
+		&&op_Nop,
+		&&op_PushConst, &&op_PushNull, &&op_PushTrue, &&op_PushFalse, &&op_PushInt, &&op_Pop,
+		&&op_LoadGlobal, &&op_StoreGlobal, &&op_LoadLocal, &&op_StoreLocal,
+		&&op_GetField, &&op_StoreField,
+		&&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_BitAnd, &&op_BitOr,
+		&&op_Equal, &&op_NotEqual, &&op_Less, &&op_LessEqual, &&op_Greater, &&op_GreaterEqual,
+		&&op_Negate, &&op_Not, &&op_BitNot,
+		&&op_Jump, &&op_JumpIfFalse, &&op_JumpIfFalseOrPop, &&op_JumpIfTrueOrPop,
+		&&op_Call, &&op_CallNative, &&op_Return, &&op_ReturnNull,
+		&&op_LoadLocal2, &&op_StoreLocalKeep, &&op_StoreGlobalKeep, &&op_AddImmediate, &&op_SubImmediate,
+		&&op_EqualJumpIfFalse, &&op_NotEqualJumpIfFalse, &&op_LessJumpIfFalse, &&op_LessEqualJumpIfFalse,
+		&&op_GreaterJumpIfFalse, &&op_GreaterEqualJumpIfFalse,
+		&&op_IncrementLocal, &&op_DecrementLocal, &&op_IncrementGlobal, &&op_DecrementGlobal,
+		&&op_AddInt, &&op_AddReal, &&op_AddString, &&op_AddGeneric,
+		&&op_SubInt, &&op_SubReal, &&op_SubGeneric,
+		&&op_MulInt, &&op_MulReal, &&op_MulGeneric,
+		&&op_DivInt, &&op_DivReal, &&op_DivGeneric,
+		&&op_LessInt, &&op_LessReal, &&op_LessGeneric,
+		&&op_LessEqualInt, &&op_LessEqualReal, &&op_LessEqualGeneric,
+		&&op_GreaterInt, &&op_GreaterReal, &&op_GreaterGeneric,
+		&&op_GreaterEqualInt, &&op_GreaterEqualReal, &&op_GreaterEqualGeneric,
+	};
+
+	static_assert(std::size(Handlers) == static_cast<size_t>(OpCode::_Count), "every opcode needs a handler");
+
+	ExecutableInstruction *executable = nullptr;
+	if constexpr (!Profiling)
+	{
+		std::call_once(program.executable_once, PrepareProgram, std::cref(program), Handlers);
+		executable = program.executable.get();
+	}
+
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() \
+	do \
+	{ \
+		if constexpr (Profiling) \
+		{ \
+			const OpCode next_op = GetOpCode(code[pc]); \
+			operand = GetOperand(code[pc++]); \
+			counts->record(next_op); \
+			goto *Handlers[static_cast<size_t>(next_op)]; \
+		} \
+		operand = executable[pc].operand; \
+		goto *reinterpret_cast<const void *>(executable[pc++].dispatch.load(std::memory_order_relaxed)); \
+	} while (0)
+#define VM_DISPATCH_OF(op) reinterpret_cast<uintptr_t>(Handlers[static_cast<size_t>(op)])
+#else
+	std::call_once(program.executable_once, PrepareProgram, std::cref(program), nullptr);
+	ExecutableInstruction *const executable = program.executable.get();
+	// a rewritten instruction runs again without being counted twice
+	bool rewritten = false;
+
+#define VM_CASE(name) case OpCode::name:
+#define VM_NEXT() continue
+#define VM_DISPATCH_OF(op) static_cast<uintptr_t>(op)
+#endif
+
+// moves to `target` (the instructions up to and including the current one ran),
+// suspending there when that spends the budget
+#define VM_TRANSFER(target) \
+	{ \
+		const uint64_t ran = pc - segment; \
+		pc = (target); \
+		segment = pc; \
+		if (ran >= remaining) \
+		{ \
+			remaining = 0; \
+			goto suspend; \
+		} \
+		remaining -= ran; \
+	}
+
+// charges the last stretch of a run that ends
+#define VM_CHARGE_END() (remaining -= std::min<uint64_t>(remaining, pc - segment))
+
+// rewrites the current instruction into `op` and runs it again,
+// profiled runs go straight to `op` instead
+#if CRYPT_VM_COMPUTED_GOTO
+#define VM_REWRITE(op) \
+	{ \
+		if constexpr (Profiling) \
+		{ \
+			goto *Handlers[static_cast<size_t>(op)]; \
+		} \
+		executable[pc - 1].dispatch.store(VM_DISPATCH_OF(op), std::memory_order_relaxed); \
+		pc--; \
+		VM_NEXT(); \
+	}
+#else
+#define VM_REWRITE(op) \
+	{ \
+		executable[pc - 1].dispatch.store(VM_DISPATCH_OF(op), std::memory_order_relaxed); \
+		pc--; \
+		rewritten = Profiling; \
+		VM_NEXT(); \
+	}
+#endif
+
+// int fast path, everything else goes through the shared operator semantics
+#define VM_BINARY(name, int_expression) \
+	VM_CASE(name) \
+	{ \
+		Variable &left = sp[-2]; \
+		Variable &right = sp[-1]; \
+		if (IsIntPair(left, right)) \
+		{ \
+			const CryptInt a = left.get_int(); \
+			const CryptInt b = right.get_int(); \
+			left = Variable(int_expression); \
+		} \
+		else \
+		{ \
+			left = ApplyBinary(OpCode::name, left, right); \
+		} \
+		(--sp)->set_null(); \
+		VM_NEXT(); \
+	}
+
+#define VM_BINARY_GENERIC(label, name) \
+	VM_CASE(label) \
+	{ \
+		sp[-2] = ApplyBinary(OpCode::name, sp[-2], sp[-1]); \
+		(--sp)->set_null(); \
+		VM_NEXT(); \
+	}
+
+// the first run picks the specialized form
+#define VM_QUICKENING(name) \
+	VM_CASE(name) \
+	{ \
+		VM_REWRITE(SpecializeBinary(OpCode::name, sp[-2].get_type(), sp[-1].get_type())); \
+	}
+
+// the scalar operands are overwritten in place, deoptimizing when the operand types stop matching
+#define VM_SPECIALIZED(name, form, type, read, write, expression) \
+	VM_CASE(name##form) \
+	{ \
+		Variable &left = sp[-2]; \
+		Variable &right = sp[-1]; \
+		if (left.get_type() != VariableType::type || right.get_type() != VariableType::type) \
+		{ \
+			VM_REWRITE(OpCode::name##Generic); \
+		} \
+		const auto a = left.read(); \
+		const auto b = right.read(); \
+		left.write(expression); \
+		(--sp)->set_null(); \
+		VM_NEXT(); \
+	}
+
+#define VM_ARITHMETIC(name, int_expression, real_expression) \
+	VM_QUICKENING(name) \
+	VM_SPECIALIZED(name, Int, Int, get_int_unchecked, set_int, int_expression) \
+	VM_SPECIALIZED(name, Real, Real, get_real_unchecked, set_real, real_expression) \
+	VM_BINARY_GENERIC(name##Generic, name)
+
+#define VM_COMPARISON(name, expression) \
+	VM_QUICKENING(name) \
+	VM_SPECIALIZED(name, Int, Int, get_int_unchecked, set_bool, expression) \
+	VM_SPECIALIZED(name, Real, Real, get_real_unchecked, set_bool, expression) \
+	VM_BINARY_GENERIC(name##Generic, name)
+
+// superinstructions move `pc` past the instructions they stand for, up to the one that can fail
+// first so errors are reported at it
+
+// `PushInt`, then `Add`/`Sub`: the int fast path, everything else through the shared semantics
+#define VM_IMMEDIATE(name, int_expression) \
+	VM_CASE(name##Immediate) \
+	{ \
+		Variable &left = sp[-1]; \
+		const CryptInt b = SignExtendOperand(operand); \
+		pc++; \
+		if (left.get_type() == VariableType::Int) \
+		{ \
+			const CryptInt a = left.get_int_unchecked(); \
+			left.set_int(int_expression); \
+		} \
+		else \
+		{ \
+			left = ApplyBinary(OpCode::name, left, Variable(b)); \
+		} \
+		VM_NEXT(); \
+	}
+
+// a comparison, then `JumpIfFalse`; `reals` adds the real fast path of the ordering comparisons
+#define VM_COMPARE_JUMP(name, expression, reals) \
+	VM_CASE(name##JumpIfFalse) \
+	{ \
+		const Variable &left = sp[-2]; \
+		const Variable &right = sp[-1]; \
+		bool condition; \
+		if (IsIntPair(left, right)) \
+		{ \
+			const CryptInt a = left.get_int_unchecked(); \
+			const CryptInt b = right.get_int_unchecked(); \
+			condition = expression; \
+		} \
+		else if (reals && left.get_type() == VariableType::Real && right.get_type() == VariableType::Real) \
+		{ \
+			const auto a = left.get_real_unchecked(); \
+			const auto b = right.get_real_unchecked(); \
+			condition = expression; \
+		} \
+		else \
+		{ \
+			condition = Truthy(ApplyBinary(OpCode::name, left, right)); \
+		} \
+		(--sp)->set_null(); \
+		(--sp)->set_null(); \
+		const uint32_t target = GetOperand(code[pc++]); \
+		if (!condition) \
+		{ \
+			VM_TRANSFER(target); \
+		} \
+		VM_NEXT(); \
+	}
+
+// `Load*`, `PushInt`, `Add`/`Sub`, `Store*` of the same slot, with nothing left on the stack
+#define VM_INCREMENT(name, slots, op, int_expression) \
+	VM_CASE(name) \
+	{ \
+		Variable &slot = slots[operand]; \
+		const CryptInt b = SignExtendOperand(GetOperand(code[pc])); \
+		if (slot.get_type() == VariableType::Int) \
+		{ \
+			const CryptInt a = slot.get_int_unchecked(); \
+			slot.set_int(int_expression); \
+			pc += 3; \
+		} \
+		else \
+		{ \
+			pc += 2; \
+			slot = ApplyBinary(OpCode::op, slot, Variable(b)); \
+			pc++; \
+		} \
+		VM_NEXT(); \
+	}
+
+	try
+	{
+#if CRYPT_VM_COMPUTED_GOTO
+		VM_NEXT();
+#else
+		for (;;)
+		{
+			if constexpr (Profiling)
+			{
+				if (!rewritten)
+				{
+					counts->record(GetOpCode(code[pc]));
+				}
+				rewritten = false;
+			}
+
+			const ExecutableInstruction &instruction = executable[pc++];
+			operand = instruction.operand;
+
+			switch (static_cast<OpCode>(instruction.dispatch.load(std::memory_order_relaxed)))
+			{
+#endif
+
+		VM_CASE(Nop)
+		{
+			VM_NEXT();
+		}
+
+		VM_CASE(PushConst)
+		{
+			Assign(*sp++, constants[operand]);
+			VM_NEXT();
+		}
+
+		VM_CASE(PushNull)
+		{
+			sp++;
+			VM_NEXT();
+		}
+
+		VM_CASE(PushTrue)
+		{
+			(sp++)->set_bool(true);
+			VM_NEXT();
+		}
+
+		VM_CASE(PushFalse)
+		{
+			(sp++)->set_bool(false);
+			VM_NEXT();
+		}
+
+		VM_CASE(PushInt)
+		{
+			(sp++)->set_int(SignExtendOperand(operand));
+			VM_NEXT();
+		}
+
+		VM_CASE(Pop)
+		{
+			(--sp)->set_null();
+			VM_NEXT();
+		}
+
+		VM_CASE(LoadGlobal)
+		{
+			Assign(*sp++, globals[operand]);
+			VM_NEXT();
+		}
+
+		VM_CASE(StoreGlobal)
+		{
+			MoveAssign(globals[operand], *--sp);
+			VM_NEXT();
+		}
+
+		VM_CASE(LoadLocal)
+		{
+			Assign(*sp++, locals[operand]);
+			VM_NEXT();
+		}
+
+		VM_CASE(StoreLocal)
+		{
+			MoveAssign(locals[operand], *--sp);
+			VM_NEXT();
+		}
+
+		VM_CASE(GetField)
+		{
+			const Variable *field = ReadField(field_caches[operand], sp[-1], program.field_keys[operand]);
+
+			// the field might live in the table being replaced, `Assign` reads it first
+			if (field != nullptr)
+			{
+				Assign(sp[-1], *field);
+			}
+			else
+			{
+				sp[-1].set_null();
+			}
+			VM_NEXT();
+		}
+
+		VM_CASE(StoreField)
+		{
+			const FieldTarget &target = program.field_targets[operand];
+			Variable &root = target.global ? globals[target.slot] : locals[target.slot];
+
+			// the value stays on the stack until the path is known to be writable
+			Variable &field = WriteField(root, target.keys);
+			MoveAssign(field, *--sp);
+			VM_NEXT();
+		}
+
+		VM_ARITHMETIC(Add, WrapAdd(a, b), a + b)
+		VM_ARITHMETIC(Sub, WrapSub(a, b), a - b)
+		VM_ARITHMETIC(Mul, WrapMul(a, b), a * b)
+		VM_ARITHMETIC(Div, DivideInt(a, b), a / b)
+		VM_BINARY(BitAnd, static_cast<CryptInt>(a & b))
+		VM_BINARY(BitOr, static_cast<CryptInt>(a | b))
+
+		VM_BINARY(Equal, a == b)
+		VM_BINARY(NotEqual, a != b)
+		VM_COMPARISON(Less, a < b)
+		VM_COMPARISON(LessEqual, a <= b)
+		VM_COMPARISON(Greater, a > b)
+		VM_COMPARISON(GreaterEqual, a >= b)
+
+		VM_CASE(AddString)
+		{
+			Variable &left = sp[-2];
+			const Variable &right = sp[-1];
+			if (left.get_type() != VariableType::Str || right.get_type() != VariableType::Str)
+			{
+				VM_REWRITE(OpCode::AddGeneric);
+			}
+
+			// appends in place when the left string isn't shared
+			left._edit_string().append(right.get_string());
+			(--sp)->set_null();
+			VM_NEXT();
+		}
+
+		VM_CASE(Negate)
+		{
+			if (sp[-1].get_type() == VariableType::Int)
+			{
+				sp[-1] = Variable(WrapSub(0, sp[-1].get_int()));
+			}
+			else
+			{
+				sp[-1] = ApplyUnary(OpCode::Negate, sp[-1]);
+			}
+			VM_NEXT();
+		}
+
+		VM_CASE(Not)
+		{
+			sp[-1] = Variable(!Truthy(sp[-1]));
+			VM_NEXT();
+		}
+
+		VM_CASE(BitNot)
+		{
+			sp[-1] = ApplyUnary(OpCode::BitNot, sp[-1]);
+			VM_NEXT();
+		}
+
+		VM_CASE(Jump)
+		{
+			VM_TRANSFER(operand);
+			VM_NEXT();
+		}
+
+		VM_CASE(JumpIfFalse)
+		{
+			const bool condition = Truthy(sp[-1]);
+			(--sp)->set_null();
+
+			if (!condition)
+			{
+				VM_TRANSFER(operand);
+			}
+			VM_NEXT();
+		}
+
+		VM_CASE(JumpIfFalseOrPop)
+		{
+			if (!Truthy(sp[-1]))
+			{
+				VM_TRANSFER(operand);
+			}
+			else
+			{
+				(--sp)->set_null();
+			}
+			VM_NEXT();
+		}
+
+		VM_CASE(JumpIfTrueOrPop)
+		{
+			if (Truthy(sp[-1]))
+			{
+				VM_TRANSFER(operand);
+			}
+			else
+			{
+				(--sp)->set_null();
+			}
+			VM_NEXT();
+		}
+
+		VM_CASE(Call)
+		{
+			const FunctionInfo &callee = program.functions[operand];
+
+			if (frames.size() >= MaxCallDepth)
+			{
+				throw std::runtime_error("stack overflow");
+			}
+
+			frames.push_back({pc, static_cast<uint32_t>(locals - stack.data())});
+
+			// the arguments already on the stack become the first locals
+			const size_t base = (sp - stack.data()) - callee.param_count;
+			const size_t needed = base + callee.local_count + callee.max_stack + 1;
+
+			if (needed > stack.size())
+			{
+				stack.resize(std::max(needed, stack.size() * 2));
+			}
+
+			locals = stack.data() + base;
+			sp = locals + callee.local_count;
+			VM_TRANSFER(callee.entry);
+			VM_NEXT();
+		}
+
+		VM_CASE(CallNative)
+		{
+			const crypt::NativeFunction &native = program.natives[operand];
+			Variable *args = sp - native.param_count;
+
+			Variable result = native.invoke(native.target.get(), args);
+			while (sp > args)
+			{
+				(--sp)->set_null();
+			}
+
+			*sp++ = std::move(result);
+			VM_NEXT();
+		}
+
+		VM_CASE(Return)
+		{
+			Variable result = std::move(*--sp);
+
+			// release the frame's locals and leftovers
+			while (sp > locals)
+			{
+				(--sp)->set_null();
+			}
+
+			if (frames.empty())
+			{
+				VM_CHARGE_END();
+				budget = remaining;
+				return result;
+			}
+
+			const Frame frame = frames.back();
+			frames.pop_back();
+
+			locals = stack.data() + frame.base;
+			*sp++ = std::move(result);
+			VM_TRANSFER(frame.return_pc);
+			VM_NEXT();
+		}
+
+		VM_CASE(ReturnNull)
+		{
+			while (sp > locals)
+			{
+				(--sp)->set_null();
+			}
+
+			if (frames.empty())
+			{
+				VM_CHARGE_END();
+				budget = remaining;
+				return Variable();
+			}
+
+			const Frame frame = frames.back();
+			frames.pop_back();
+
+			locals = stack.data() + frame.base;
+			sp++;
+			VM_TRANSFER(frame.return_pc);
+			VM_NEXT();
+		}
+
+		VM_CASE(LoadLocal2)
+		{
+			Assign(*sp++, locals[operand]);
+			Assign(*sp++, locals[GetOperand(code[pc++])]);
+			VM_NEXT();
+		}
+
+		VM_CASE(StoreLocalKeep)
+		{
+			Assign(locals[operand], sp[-1]);
+			pc++;
+			VM_NEXT();
+		}
+
+		VM_CASE(StoreGlobalKeep)
+		{
+			Assign(globals[operand], sp[-1]);
+			pc++;
+			VM_NEXT();
+		}
+
+		VM_IMMEDIATE(Add, WrapAdd(a, b))
+		VM_IMMEDIATE(Sub, WrapSub(a, b))
+
+		VM_COMPARE_JUMP(Equal, a == b, false)
+		VM_COMPARE_JUMP(NotEqual, a != b, false)
+		VM_COMPARE_JUMP(Less, a < b, true)
+		VM_COMPARE_JUMP(LessEqual, a <= b, true)
+		VM_COMPARE_JUMP(Greater, a > b, true)
+		VM_COMPARE_JUMP(GreaterEqual, a >= b, true)
+
+		VM_INCREMENT(IncrementLocal, locals, Add, WrapAdd(a, b))
+		VM_INCREMENT(DecrementLocal, locals, Sub, WrapSub(a, b))
+		VM_INCREMENT(IncrementGlobal, globals, Add, WrapAdd(a, b))
+		VM_INCREMENT(DecrementGlobal, globals, Sub, WrapSub(a, b))
+
+#if !CRYPT_VM_COMPUTED_GOTO
+			default:
+				throw std::logic_error("invalid opcode");
+			}
+		}
+#endif
+	}
+	catch (const crypt::ScriptError &)
+	{
+		VM_CHARGE_END();
+		budget = remaining;
+		ClearStack(stack.data(), sp);
+		throw;
+	}
+	catch (const std::exception &error)
+	{
+		VM_CHARGE_END();
+		budget = remaining;
+		ClearStack(stack.data(), sp);
+
+		// `pc` is already past the failing instruction
+		const TextPosition &pos = program.positions[pc - 1];
+		throw crypt::ScriptError(error.what(), pos.line + 1, pos.column + 1);
+	}
+
+suspend:
+	// the budget ran out, the run continues at instruction `pc`
+	budget = 0;
+	state.suspended = true;
+	state.pc = pc;
+	state.base = static_cast<uint32_t>(locals - stack.data());
+	state.top = static_cast<uint32_t>(sp - stack.data());
+	return Variable();
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_DISPATCH_OF
+#undef VM_REWRITE
+#undef VM_TRANSFER
+#undef VM_CHARGE_END
+#undef VM_BINARY
+#undef VM_BINARY_GENERIC
+#undef VM_QUICKENING
+#undef VM_SPECIALIZED
+#undef VM_ARITHMETIC
+#undef VM_COMPARISON
+#undef VM_IMMEDIATE
+#undef VM_COMPARE_JUMP
+#undef VM_INCREMENT
+}
+
+Variable Execute(
+	const Program &program, Variable *globals, ExecutionState &state, FieldCache *field_caches, uint64_t &budget
+) {
+	return Run<false>(program, globals, state, field_caches, budget, nullptr);
+}
+
+Variable ExecuteProfiled(
+	const Program &program, Variable *globals, ExecutionState &state, FieldCache *field_caches, OpcodeCounts &counts
+) {
+	uint64_t budget = UnlimitedBudget;
+	return Run<true>(program, globals, state, field_caches, budget, &counts);
+}
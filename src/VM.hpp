@@ -0,0 +1,114 @@
+#pragma once
+#include "Bytecode.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+struct Frame
+{
+	uint32_t return_pc;
+	// stack index of the caller's locals
+	uint32_t base;
+};
+
+// the inline caches of the programs run by one context/thread, single threaded;
+// the caches are only hints checked against the tables they are used on,
+// so a suspended run can continue with another thread's caches
+class InlineCaches
+{
+public:
+	// the caches of `program`, created on its first run with these caches
+	FieldCache *fields(const std::shared_ptr<const crypt::Program> &program);
+
+private:
+	struct ProgramCaches
+	{
+		// held so the program's address can't be reused by another one
+		std::shared_ptr<const crypt::Program> program;
+		std::unique_ptr<FieldCache[]> fields;
+	};
+
+	std::vector<ProgramCaches> m_programs;
+};
+
+// what a run needs besides the (shared, immutable) program, kept by an execution context
+// between runs so that warm runs don't allocate; single threaded
+struct ExecutionState
+{
+	// slots above the top of the stack are null between runs
+	std::vector<crypt::Variable> stack;
+	std::vector<Frame> frames;
+	// one per `Program::globals` of the running program
+	std::vector<crypt::Variable> globals;
+
+	InlineCaches caches;
+
+	// a run is in progress, a nested run (from a callback) needs its own state
+	bool running = false;
+
+	// where a run that ran out of budget continues (see `Execute()`)
+	bool suspended = false;
+	uint32_t pc = 0;
+	// stack indices of the current frame's locals and of the top
+	uint32_t base = 0;
+	uint32_t top = 0;
+};
+
+// what a `crypt::OpcodeProfile` counted: how often each instruction (by its `Program::code` opcode,
+// superinstructions included and quickening ignored) ran right after the previous one or two
+struct OpcodeCounts
+{
+	static constexpr size_t OpCodeCount = static_cast<size_t>(OpCode::_Count);
+
+	inline void record(OpCode op) {
+		const uint32_t index = static_cast<uint32_t>(op);
+		executed++;
+
+		if (last < OpCodeCount)
+		{
+			pairs[last * OpCodeCount + index]++;
+			if (before_last < OpCodeCount)
+			{
+				triples[TripleKey(before_last, last, index)]++;
+			}
+		}
+
+		before_last = last;
+		last = index;
+	}
+
+	// a new run doesn't continue the sequence of the last one
+	inline void restart() { last = before_last = OpCodeCount; }
+
+	static inline constexpr uint32_t TripleKey(uint32_t first, uint32_t second, uint32_t third) {
+		return first | (second << 8) | (third << 16);
+	}
+
+	uint64_t executed = 0;
+	// `first * OpCodeCount + second`
+	uint64_t pairs[OpCodeCount * OpCodeCount] = {};
+	// by `TripleKey()`, most triples never run
+	std::unordered_map<uint32_t, uint64_t> triples;
+
+	// the opcodes of the last two instructions run, `OpCodeCount` for none
+	uint32_t last = OpCodeCount;
+	uint32_t before_last = OpCodeCount;
+};
+
+// no budget, see `Execute()`
+static constexpr uint64_t UnlimitedBudget = ~uint64_t(0);
+
+// runs the top-level code of `program` against `globals` (one per `program.globals`)
+// and returns what it returned, throws crypt::ScriptError on runtime errors;
+// runs about `budget` instructions (decremented by the ones run, checked at jumps, calls and returns),
+// suspending the run in `state` when it runs out, the next call with the suspended state continues it
+crypt::Variable Execute(
+	const crypt::Program &program, crypt::Variable *globals, ExecutionState &state, FieldCache *field_caches,
+	uint64_t &budget
+);
+
+// runs like `Execute()` without a budget, recording every instruction run into `counts` (slower)
+crypt::Variable ExecuteProfiled(
+	const crypt::Program &program, crypt::Variable *globals, ExecutionState &state, FieldCache *field_caches,
+	OpcodeCounts &counts
+);
@@ -0,0 +1,91 @@
+// counts the heap allocations `crypt::Load()` makes per value, by type
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc tests/allocations.cpp src/*.cpp -o allocations
+#include "Crypt.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <string>
+
+static std::atomic<size_t> Allocations{0};
+
+void *operator new(size_t size) {
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *block = malloc(size ? size : 1))
+	{
+		return block;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *block) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+
+// `count` entries of `value` (keys short enough to stay inline in the strings)
+static std::string Document(size_t count, const char *value) {
+	std::string document{};
+	for (size_t i = 0; i < count; i++)
+	{
+		document += "k" + std::to_string(i) + " = " + value + "\n";
+	}
+	return document;
+}
+
+static size_t CountLoad(const std::string &document) {
+	const size_t before = Allocations.load();
+	const crypt::Variable value = crypt::Load(document.c_str(), document.size());
+	return Allocations.load() - before;
+}
+
+// the allocations of one more entry, the growth of the token storage averaged out
+static size_t PerValue(const char *value) {
+	constexpr size_t Count = 1000;
+	return (CountLoad(Document(2 * Count, value)) - CountLoad(Document(Count, value))) / Count;
+}
+
+int main() {
+	struct Case
+	{
+		const char *name;
+		const char *value;
+		// the table node, plus the value's own allocations
+		size_t expected;
+	};
+
+	const Case cases[] = {
+		{ "null", "null", 1 },
+		{ "bool", "true", 1 },
+		{ "int", "42", 1 },
+		{ "real", "69.420", 1 },
+		// payload (the characters fit inline)
+		{ "short string", "\"to\"", 2 },
+		// payload and characters
+		{ "long string", "\"i need quotes cuz im a value\"", 3 },
+		// payload and the packed values
+		{ "int list", "{ 412, 51, 65 }", 3 },
+		// payload, the elements (grown once for the second) and the string's payload
+		{ "mixed list", "{ \"burden\", 42 }", 5 },
+		// payload and a node per entry
+		{ "table", "{ first = 41, third = false }", 4 },
+	};
+
+	int failures = 0;
+	for (const Case &test : cases)
+	{
+		const size_t actual = PerValue(test.value);
+		printf("%-14s %zu allocations per value (expected %zu)\n", test.name, actual, test.expected);
+
+		if (actual != test.expected)
+		{
+			failures++;
+		}
+	}
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
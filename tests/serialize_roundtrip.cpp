@@ -0,0 +1,67 @@
+// checks that `Serialize()` output reads back through `Load()` to an equal document
+// build: g++ -std=c++17 -O2 -Iinclude -Isrc tests/serialize_roundtrip.cpp src/*.cpp -o serialize_roundtrip
+#include "CryptSerialize.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+using crypt::Variable;
+
+static int Failures = 0;
+
+static void Check(bool condition, const char *what) {
+	if (!condition)
+	{
+		printf("failed: %s\n", what);
+		Failures++;
+	}
+}
+
+static const Variable &Field(const Variable &document, const char *key) {
+	return document.get_table().at(key);
+}
+
+static void RoundTrip(const Variable &document, const crypt::SerializeOptions &options, const char *what) {
+	const crypt::string_type text = crypt::Serialize(document, options);
+	Check(crypt::Load(text.c_str(), text.size()) == document, what);
+}
+
+int main(int argc, char **argv) {
+	std::ifstream file(argc > 1 ? argv[1] : "tests/values.txt");
+	std::stringstream source{};
+	source << file.rdbuf();
+
+	const crypt::string_type text = source.str();
+	const Variable values = crypt::Load(text.c_str(), text.size());
+
+	crypt::SerializeOptions pretty{};
+	pretty.pretty = true;
+
+	RoundTrip(values, {}, "values.txt, compact");
+	RoundTrip(values, pretty, "values.txt, pretty");
+
+	// empty objects are both written as `{}`
+	crypt::table_type empties{};
+	empties["list"] = Variable(crypt::list_type{});
+	empties["table"] = Variable(crypt::table_type{});
+
+	const crypt::string_type written = crypt::Serialize(Variable(empties));
+	const Variable read = crypt::Load(written.c_str(), written.size());
+
+	Check(Field(read, "list").is_list() && Field(read, "list").get_list().empty(), "empty list reads back as a list");
+	Check(Field(read, "table").is_list() && Field(read, "table").get_list().empty(), "empty table reads back as a list");
+
+	crypt::table_type lists{};
+	lists["list"] = Variable(crypt::list_type{});
+	RoundTrip(Variable(lists), {}, "empty list, compact");
+	RoundTrip(Variable(lists), pretty, "empty list, pretty");
+
+	if (Failures == 0)
+	{
+		printf("ok\n");
+	}
+
+	return Failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}